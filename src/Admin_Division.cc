@@ -24,6 +24,9 @@
 //
 
 #include "Admin_Division.h"
+#include "Block_Group.h"
+#include "Census_Tract.h"
+#include "County.h"
 #include "Place.h"
 
 Admin_Division::~Admin_Division() {
@@ -34,6 +37,7 @@ Admin_Division::Admin_Division(long long int _admin_code) {
   this->households.clear();
   this->subdivisions.clear();
   this->higher = NULL;
+  this->index = -1;
 }
 
 void Admin_Division::setup() {
@@ -61,5 +65,44 @@ int Admin_Division::get_population_size() {
   return popsize;
 }
 
+int Admin_Division::get_number_of_admin_divisions(int level) {
+  switch (level) {
+  case Admin_Level::COUNTY:
+    return County::get_number_of_counties();
+  case Admin_Level::CENSUS_TRACT:
+    return Census_Tract::get_number_of_census_tracts();
+  case Admin_Level::BLOCK_GROUP:
+    return Block_Group::get_number_of_block_groups();
+  }
+  return 0;
+}
+
+Admin_Division* Admin_Division::get_admin_division_with_index(int level, int n) {
+  switch (level) {
+  case Admin_Level::COUNTY:
+    return County::get_county_with_index(n);
+  case Admin_Level::CENSUS_TRACT:
+    return Census_Tract::get_census_tract_with_index(n);
+  case Admin_Level::BLOCK_GROUP:
+    return Block_Group::get_block_group_with_index(n);
+  }
+  return NULL;
+}
 
+static const char* admin_level_name[Admin_Level::ADMIN_LEVELS] = {
+  "county", "census_tract", "block_group"
+};
 
+const char* Admin_Division::get_admin_level_name(int level) {
+  assert(0 <= level && level < Admin_Level::ADMIN_LEVELS);
+  return admin_level_name[level];
+}
+
+int Admin_Division::get_admin_level(const char* name) {
+  for (int level = 0; level < Admin_Level::ADMIN_LEVELS; level++) {
+    if (strcmp(name, admin_level_name[level]) == 0) {
+      return level;
+    }
+  }
+  return -1;
+}
@@ -32,6 +32,16 @@ using namespace std;
 
 class Place;
 
+// levels of admin divisions below the state
+namespace Admin_Level {
+  enum e {
+    COUNTY,
+    CENSUS_TRACT,
+    BLOCK_GROUP,
+    ADMIN_LEVELS
+  };
+};
+
 class Admin_Division {
 public:
 
@@ -66,6 +76,15 @@ public:
     return this->admin_code;
   }
 
+  // position of this division among the divisions of its level
+  int get_index() {
+    return this->index;
+  }
+
+  void set_index(int _index) {
+    this->index = _index;
+  }
+
   int get_number_of_households() {
     return (int) this->households.size();
   }
@@ -74,8 +93,14 @@ public:
 
   int get_population_size();
 
+  static int get_number_of_admin_divisions(int level);
+  static Admin_Division* get_admin_division_with_index(int level, int n);
+  static const char* get_admin_level_name(int level);
+  static int get_admin_level(const char* name);
+
 protected:
   long long int admin_code;
+  int index;
 
   // pointers to households
   std::vector<Place*> households;
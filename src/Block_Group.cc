@@ -69,6 +69,7 @@ Block_Group* Block_Group::get_block_group_with_admin_code(long long int block_gr
   if (itr == Block_Group::lookup_map.end()) {
     // this is a new block group
     block_group = new Block_Group(block_group_admin_code);
+    block_group->set_index(Block_Group::block_groups.size());
     Block_Group::block_groups.push_back(block_group);
     Block_Group::lookup_map[block_group_admin_code] = block_group;
   }
@@ -259,6 +259,7 @@ Census_Tract* Census_Tract::get_census_tract_with_admin_code(long long int censu
   itr = Census_Tract::lookup_map.find(census_tract_admin_code);
   if (itr == Census_Tract::lookup_map.end()) {
     census_tract = new Census_Tract(census_tract_admin_code);
+    census_tract->set_index(Census_Tract::census_tracts.size());
     Census_Tract::census_tracts.push_back(census_tract);
     Census_Tract::lookup_map[census_tract_admin_code] = census_tract;
   }
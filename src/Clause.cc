@@ -19,6 +19,7 @@
  */
 
 #include "Clause.h"
+#include "Factor.h"
 #include "Person.h"
 #include "Predicate.h"
 
@@ -110,5 +111,13 @@ bool Clause::get_value(Person* person, Person* other) {
   return true;
 }
 
+int Clause::get_covariates() {
+  int covariates = Covariate::NONE;
+  for (int i = 0; i < this->predicates.size(); i++) {
+    covariates |= this->predicates[i]->get_covariates();
+  }
+  return covariates;
+}
+
 
 
@@ -35,6 +35,7 @@ public:
   string get_name();
   bool parse();
   bool get_value(Person* person, Person* other = NULL);
+  int get_covariates();
   bool is_warning() {
     return this->warning;
   }
@@ -0,0 +1,440 @@
+/*
+ * This file is part of the FRED system.
+ *
+ * Copyright (c) 2010-2012, University of Pittsburgh, John Grefenstette, Shawn Brown, 
+ * Roni Rosenfield, Alona Fyshe, David Galloway, Nathan Stone, Jay DePasse, 
+ * Anuroop Sriram, and Donald Burke
+ * All rights reserved.
+ *
+ * Copyright (c) 2013-2019, University of Pittsburgh, John Grefenstette, Robert Frankeny,
+ * David Galloway, Mary Krauland, Michael Lann, David Sinclair, and Donald Burke
+ * All rights reserved.
+ *
+ * FRED is distributed on the condition that users fully understand and agree to all terms of the 
+ * End User License Agreement.
+ *
+ * FRED is intended FOR NON-COMMERCIAL, EDUCATIONAL OR RESEARCH PURPOSES ONLY.
+ *
+ * See the file "LICENSE" for more information.
+ */
+
+//
+//
+// File: Compressed_Stream.cc
+//
+// Compressed streams are stdio streams with custom read, write and close
+// functions (fopencookie, or funopen on BSD systems). The data pass
+// between the caller and the compression threads in blocks through a
+// bounded queue, so that compression and decompression overlap with the
+// caller's own work and memory use stays bounded.
+//
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include "Compressed_Stream.h"
+
+// size of the blocks passed to and from the compression threads, and
+// the number of blocks queued for each thread
+#define STREAM_BLOCK_SIZE (1 << 20)
+#define STREAM_QUEUE_BLOCKS 4
+
+int Compressed_Stream::threads = 4;
+
+typedef struct {
+  long seq;
+  std::vector<char> data;
+} stream_block_t;
+
+// a bounded first-in, first-out queue of blocks. Once closed, push()
+// fails and pop() returns the remaining blocks and then NULL.
+class Block_Queue {
+public:
+  Block_Queue(int _capacity) {
+    this->capacity = _capacity;
+    this->closed = false;
+  }
+
+  bool push(stream_block_t* block) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (this->blocks.size() >= this->capacity && this->closed == false) {
+      this->not_full.wait(lock);
+    }
+    if (this->closed) {
+      return false;
+    }
+    this->blocks.push_back(block);
+    this->not_empty.notify_one();
+    return true;
+  }
+
+  stream_block_t* pop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (this->blocks.empty() && this->closed == false) {
+      this->not_empty.wait(lock);
+    }
+    if (this->blocks.empty()) {
+      return NULL;
+    }
+    stream_block_t* block = this->blocks.front();
+    this->blocks.pop_front();
+    this->not_full.notify_one();
+    return block;
+  }
+
+  void close() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->closed = true;
+    this->not_empty.notify_all();
+    this->not_full.notify_all();
+  }
+
+private:
+  std::deque<stream_block_t*> blocks;
+  int capacity;
+  bool closed;
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+};
+
+//////////////////////////////////////////////////////
+//
+// READING
+//
+
+typedef struct {
+  gzFile gz;
+  Block_Queue* queue;
+  std::thread* thread;
+  stream_block_t* block;
+  size_t pos;
+  bool failed;
+} stream_reader_t;
+
+// decompress the file ahead of the reader until it ends or the reader
+// closes the stream. A read error, or a file that ends inside a gzip
+// member, marks the reader as failed.
+static void read_ahead(stream_reader_t* reader) {
+  for (;;) {
+    stream_block_t* block = new stream_block_t;
+    block->data.resize(STREAM_BLOCK_SIZE);
+    int n = gzread(reader->gz, block->data.data(), STREAM_BLOCK_SIZE);
+    if (n <= 0) {
+      int status = Z_OK;
+      gzerror(reader->gz, &status);
+      reader->failed = (n < 0 || status != Z_OK);
+      delete block;
+      break;
+    }
+    block->data.resize(n);
+    if (reader->queue->push(block) == false) {
+      delete block;
+      break;
+    }
+  }
+  reader->queue->close();
+}
+
+// returns -1 once the data before a failure have been read, so that
+// the stream reports the error
+static long read_stream(void* cookie, char* buf, size_t size) {
+  stream_reader_t* reader = (stream_reader_t*) cookie;
+  size_t done = 0;
+  while (done < size) {
+    if (reader->block == NULL || reader->pos == reader->block->data.size()) {
+      delete reader->block;
+      reader->pos = 0;
+      reader->block = reader->queue->pop();
+      if (reader->block == NULL) {
+	if (done == 0 && reader->failed) {
+	  return -1;
+	}
+	break;
+      }
+    }
+    size_t n = std::min(size - done, reader->block->data.size() - reader->pos);
+    memcpy(buf + done, reader->block->data.data() + reader->pos, n);
+    reader->pos += n;
+    done += n;
+  }
+  return done;
+}
+
+static int close_reader(void* cookie) {
+  stream_reader_t* reader = (stream_reader_t*) cookie;
+  // stop the read-ahead thread if the file was not read to the end
+  reader->queue->close();
+  stream_block_t* block;
+  while ((block = reader->queue->pop()) != NULL) {
+    delete block;
+  }
+  reader->thread->join();
+  delete reader->thread;
+  delete reader->queue;
+  delete reader->block;
+  int status = gzclose(reader->gz);
+  bool failed = reader->failed;
+  delete reader;
+  return (status == Z_OK && failed == false) ? 0 : EOF;
+}
+
+//////////////////////////////////////////////////////
+//
+// WRITING
+//
+
+typedef struct {
+  int method;
+  gzFile gz;
+  FILE* fp;
+  Block_Queue* queue;
+  std::vector<std::thread*> workers;
+  stream_block_t* block;
+  long blocks;
+  long next_write;
+  std::atomic<bool> failed;
+  std::mutex mutex;
+  std::condition_variable written;
+} stream_writer_t;
+
+// GZIP: compress the blocks in order as one stream
+static void write_gzip(stream_writer_t* writer) {
+  stream_block_t* block;
+  while ((block = writer->queue->pop()) != NULL) {
+    if (gzwrite(writer->gz, block->data.data(), block->data.size()) != (int) block->data.size()) {
+      writer->failed = true;
+    }
+    delete block;
+  }
+}
+
+// BLOCK: compress each block as a gzip member and write the members in
+// the order of the blocks
+static void write_blocks(stream_writer_t* writer) {
+  std::vector<unsigned char> out;
+  stream_block_t* block;
+  while ((block = writer->queue->pop()) != NULL) {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    out.resize(deflateBound(&z, block->data.size()));
+    z.next_in = (unsigned char*) block->data.data();
+    z.avail_in = block->data.size();
+    z.next_out = out.data();
+    z.avail_out = out.size();
+    int status = deflate(&z, Z_FINISH);
+    size_t size = out.size() - z.avail_out;
+    deflateEnd(&z);
+
+    std::unique_lock<std::mutex> lock(writer->mutex);
+    while (writer->next_write != block->seq) {
+      writer->written.wait(lock);
+    }
+    if (status != Z_STREAM_END || fwrite(out.data(), 1, size, writer->fp) != size) {
+      writer->failed = true;
+    }
+    writer->next_write++;
+    writer->written.notify_all();
+    lock.unlock();
+    delete block;
+  }
+}
+
+static void submit_block(stream_writer_t* writer) {
+  if (writer->block != NULL && writer->block->data.empty() == false) {
+    writer->block->seq = writer->blocks++;
+    writer->queue->push(writer->block);
+    writer->block = NULL;
+  }
+}
+
+// returns -1 once a compression thread has failed to write, so that
+// the stream reports the error
+static long write_stream(void* cookie, const char* buf, size_t size) {
+  stream_writer_t* writer = (stream_writer_t*) cookie;
+  if (writer->failed) {
+    return -1;
+  }
+  size_t done = 0;
+  while (done < size) {
+    if (writer->block == NULL) {
+      writer->block = new stream_block_t;
+      writer->block->data.reserve(STREAM_BLOCK_SIZE);
+    }
+    size_t n = std::min(size - done, STREAM_BLOCK_SIZE - writer->block->data.size());
+    writer->block->data.insert(writer->block->data.end(), buf + done, buf + done + n);
+    done += n;
+    if (writer->block->data.size() == STREAM_BLOCK_SIZE) {
+      submit_block(writer);
+    }
+  }
+  return size;
+}
+
+static int close_writer(void* cookie) {
+  stream_writer_t* writer = (stream_writer_t*) cookie;
+  submit_block(writer);
+  delete writer->block;
+  writer->queue->close();
+  for (int i = 0; i < writer->workers.size(); ++i) {
+    writer->workers[i]->join();
+    delete writer->workers[i];
+  }
+  delete writer->queue;
+  bool failed = writer->failed.load();
+  if (writer->method == Compression::GZIP) {
+    failed |= (gzclose(writer->gz) != Z_OK);
+  }
+  else {
+    failed |= (fclose(writer->fp) != 0);
+  }
+  delete writer;
+  return failed ? EOF : 0;
+}
+
+//////////////////////////////////////////////////////
+//
+// STREAMS
+//
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+
+static int funopen_read(void* cookie, char* buf, int size) {
+  return (int) read_stream(cookie, buf, size);
+}
+
+static int funopen_write(void* cookie, const char* buf, int size) {
+  return (int) write_stream(cookie, buf, size);
+}
+
+static FILE* make_reader(stream_reader_t* reader) {
+  return funopen(reader, funopen_read, NULL, NULL, close_reader);
+}
+
+static FILE* make_writer(stream_writer_t* writer) {
+  return funopen(writer, NULL, funopen_write, NULL, close_writer);
+}
+
+#else
+
+static ssize_t cookie_read(void* cookie, char* buf, size_t size) {
+  return read_stream(cookie, buf, size);
+}
+
+static ssize_t cookie_write(void* cookie, const char* buf, size_t size) {
+  return write_stream(cookie, buf, size);
+}
+
+static FILE* make_reader(stream_reader_t* reader) {
+  cookie_io_functions_t io = { cookie_read, NULL, NULL, close_reader };
+  return fopencookie(reader, "r", io);
+}
+
+static FILE* make_writer(stream_writer_t* writer) {
+  cookie_io_functions_t io = { NULL, cookie_write, NULL, close_writer };
+  return fopencookie(writer, "w", io);
+}
+
+#endif
+
+FILE* Compressed_Stream::open_for_reading(const char* filename) {
+  std::string name = filename;
+  FILE* fp = fopen(name.c_str(), "r");
+  if (fp == NULL) {
+    name += ".gz";
+    fp = fopen(name.c_str(), "r");
+    if (fp == NULL) {
+      return NULL;
+    }
+  }
+
+  // plain files are read directly
+  unsigned char magic[2] = { 0, 0 };
+  size_t n = fread(magic, 1, 2, fp);
+  if (n < 2 || magic[0] != 0x1f || magic[1] != 0x8b) {
+    rewind(fp);
+    return fp;
+  }
+  fclose(fp);
+
+  stream_reader_t* reader = new stream_reader_t;
+  reader->gz = gzopen(name.c_str(), "rb");
+  if (reader->gz == NULL) {
+    delete reader;
+    return NULL;
+  }
+  gzbuffer(reader->gz, 1 << 18);
+  reader->queue = new Block_Queue(STREAM_QUEUE_BLOCKS);
+  reader->block = NULL;
+  reader->pos = 0;
+  reader->failed = false;
+  reader->thread = new std::thread(read_ahead, reader);
+  fp = make_reader(reader);
+  if (fp == NULL) {
+    close_reader(reader);
+  }
+  return fp;
+}
+
+FILE* Compressed_Stream::open_for_writing(const char* filename, int method, const char* mode) {
+  if (method != Compression::GZIP && method != Compression::BLOCK) {
+    return fopen(filename, mode);
+  }
+  std::string name = std::string(filename) + ".gz";
+  bool append = (mode[0] == 'a');
+
+  stream_writer_t* writer = new stream_writer_t;
+  writer->method = method;
+  writer->gz = NULL;
+  writer->fp = NULL;
+  if (method == Compression::GZIP) {
+    writer->gz = gzopen(name.c_str(), append ? "ab" : "wb");
+    if (writer->gz == NULL) {
+      delete writer;
+      return NULL;
+    }
+  }
+  else {
+    writer->fp = fopen(name.c_str(), append ? "ab" : "wb");
+    if (writer->fp == NULL) {
+      delete writer;
+      return NULL;
+    }
+  }
+  int workers = (method == Compression::GZIP) ? 1 : Compressed_Stream::threads;
+  writer->queue = new Block_Queue(STREAM_QUEUE_BLOCKS * workers);
+  writer->block = NULL;
+  writer->blocks = 0;
+  writer->next_write = 0;
+  writer->failed = false;
+  for (int i = 0; i < workers; ++i) {
+    writer->workers.push_back(new std::thread(method == Compression::GZIP ? write_gzip : write_blocks, writer));
+  }
+  FILE* fp = make_writer(writer);
+  if (fp == NULL) {
+    close_writer(writer);
+  }
+  return fp;
+}
+
+int Compressed_Stream::get_compression_method(const char* name) {
+  if (strcmp(name, "none") == 0) {
+    return Compression::NONE;
+  }
+  if (strcmp(name, "gzip") == 0) {
+    return Compression::GZIP;
+  }
+  if (strcmp(name, "block") == 0) {
+    return Compression::BLOCK;
+  }
+  return -1;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the FRED system.
+ *
+ * Copyright (c) 2010-2012, University of Pittsburgh, John Grefenstette, Shawn Brown, 
+ * Roni Rosenfield, Alona Fyshe, David Galloway, Nathan Stone, Jay DePasse, 
+ * Anuroop Sriram, and Donald Burke
+ * All rights reserved.
+ *
+ * Copyright (c) 2013-2019, University of Pittsburgh, John Grefenstette, Robert Frankeny,
+ * David Galloway, Mary Krauland, Michael Lann, David Sinclair, and Donald Burke
+ * All rights reserved.
+ *
+ * FRED is distributed on the condition that users fully understand and agree to all terms of the 
+ * End User License Agreement.
+ *
+ * FRED is intended FOR NON-COMMERCIAL, EDUCATIONAL OR RESEARCH PURPOSES ONLY.
+ *
+ * See the file "LICENSE" for more information.
+ */
+
+//
+//
+// File: Compressed_Stream.h
+//
+
+#ifndef _FRED_COMPRESSED_STREAM_H
+#define _FRED_COMPRESSED_STREAM_H
+
+#include <stdio.h>
+
+// Compression methods for output files. Both write gzip files that
+// gunzip and zcat read. GZIP compresses the file as a single stream in
+// a background thread. BLOCK compresses independent blocks, each a
+// complete gzip member, in a pool of threads and writes them in order.
+namespace Compression {
+  enum e {
+    NONE,
+    GZIP,
+    BLOCK
+  };
+};
+
+// Input and output files that are compressed transparently. Streams are
+// ordinary FILE pointers, so the callers read and write them with the
+// usual stdio functions and close them with fclose. A read or write
+// error, including a gzip file that ends early, sets the error indicator
+// of the stream (see ferror) and makes fclose return EOF.
+
+class Compressed_Stream {
+public:
+
+  // Open a file for reading. gzip input is detected by its contents and
+  // is decompressed ahead of the reader in a background thread. If the
+  // file does not exist but filename.gz does, that file is read instead.
+  // Compressed streams cannot seek. Returns NULL if neither file exists.
+  static FILE* open_for_reading(const char* filename);
+
+  // Open a file for writing ("w") or appending ("a") with the given
+  // compression method. With compression, ".gz" is appended to the
+  // file name. Returns NULL if the file can't be opened.
+  static FILE* open_for_writing(const char* filename, int method, const char* mode = "w");
+
+  // the method named "none", "gzip" or "block", or -1
+  static int get_compression_method(const char* name);
+
+  static void set_number_of_threads(int n) {
+    Compressed_Stream::threads = (n > 0) ? n : 1;
+  }
+
+private:
+  static int threads;
+};
+
+#endif // _FRED_COMPRESSED_STREAM_H
@@ -23,10 +23,13 @@
 // File: Condition.cc
 //
 
+#include <climits>
+
 #include "Condition.h"
 #include "Date.h"
 #include "Epidemic.h"
 #include "Global.h"
+#include "Group_Type.h"
 #include "Household.h"
 #include "Natural_History.h"
 #include "Neighborhood_Patch.h"
@@ -127,6 +130,11 @@ void Condition::prepare() {
   // final prep for natural history model
   this->natural_history->prepare();
 
+  // final prep for transmission model
+  if (this->transmissibility > 0.0) {
+    this->transmission->prepare();
+  }
+
   // final prep for epidemic
   this->epidemic->prepare();
 
@@ -245,6 +253,11 @@ bool Condition::is_closed(int state, int group_type_id) {
 std::vector <Condition*> Condition::conditions;
 std::vector<string> Condition::condition_names;
 int Condition::number_of_conditions = 0;
+int_vector_t Condition::serial_conditions;
+std::vector<int_vector_t> Condition::condition_sets;
+RNG* Condition::condition_set_rng = NULL;
+int Condition::open_hours_day = -1;
+bool Condition::open_hours[24];
 
 
 void Condition::get_condition_properties() {
@@ -358,3 +371,322 @@ void Condition::decrement_group_state_count(int group_type_id, Group* group, int
 
 
 
+
+void Condition::increment_group_state_counts(Person* person, int group_type_id, Group* group) {
+  if (group == NULL) {
+    return;
+  }
+  for(int condition_id = 0; condition_id < Condition::number_of_conditions; ++condition_id) {
+    int state = person->get_state(condition_id);
+    Condition::conditions[condition_id]->epidemic->increment_group_state_count(group_type_id, group, state);
+  }
+}
+
+void Condition::decrement_group_state_counts(Person* person, int group_type_id, Group* group) {
+  if (group == NULL) {
+    return;
+  }
+  for(int condition_id = 0; condition_id < Condition::number_of_conditions; ++condition_id) {
+    int state = person->get_state(condition_id);
+    Condition::conditions[condition_id]->epidemic->decrement_group_state_count(group_type_id, group, state);
+  }
+}
+
+
+//////////////////////////
+// CONCURRENT CONDITION UPDATES
+
+// Is the name mentioned in the rule text? Names may be embedded in factor
+// names such as current_count_of_<cond>.<state>_in_<group>, so only letters
+// and digits count as part of a longer name.
+static bool rule_mentions_name(const string &text, const string &name) {
+  size_t pos = text.find(name);
+  while (pos != string::npos) {
+    size_t end = pos + name.length();
+    if ((pos == 0 || !isalnum(text[pos-1])) && (end == text.length() || !isalnum(text[end]))) {
+      return true;
+    }
+    pos = text.find(name, pos + 1);
+  }
+  return false;
+}
+
+static int find_condition_set(int_vector_t &parent, int c) {
+  while (parent[c] != c) {
+    parent[c] = parent[parent[c]];
+    c = parent[c];
+  }
+  return c;
+}
+
+void Condition::prepare_condition_sets() {
+
+  Condition::serial_conditions.clear();
+  Condition::condition_sets.clear();
+  if (Global::Enable_Concurrent_Condition_Updates == false || Condition::number_of_conditions < 2) {
+    return;
+  }
+
+  // The data read or modified by conditions: the states of each condition,
+  // each var and list var, group membership and the health records file.
+  int n = Condition::number_of_conditions;
+  string_vector_t resource_name;
+  for (int c = 0; c < n; ++c) {
+    resource_name.push_back(Condition::get_name(c));
+  }
+  for (int i = 0; i < Person::get_number_of_vars(); ++i) {
+    resource_name.push_back(Person::get_var_name(i));
+  }
+  for (int i = 0; i < Person::get_number_of_global_vars(); ++i) {
+    resource_name.push_back(Person::get_global_var_name(i));
+  }
+  for (int i = 0; i < Person::get_number_of_list_vars(); ++i) {
+    resource_name.push_back(Person::get_list_var_name(i));
+  }
+  for (int i = 0; i < Person::get_number_of_global_list_vars(); ++i) {
+    resource_name.push_back(Person::get_global_list_var_name(i));
+  }
+  int membership = resource_name.size();
+  int records = membership + 1;
+  std::vector<int_vector_t> readers(records + 1);
+  std::vector<int_vector_t> writers(records + 1);
+  std::vector<bool> is_serial(n, false);
+
+  for (int c = 0; c < n; ++c) {
+    Condition* condition = Condition::conditions[c];
+    Natural_History* natural_history = condition->get_natural_history();
+    writers[c].push_back(c);
+    for (int state = 0; state < condition->get_number_of_states(); ++state) {
+      // deaths remove people from all conditions
+      if (natural_history->is_fatal_state(state)) {
+	is_serial[c] = true;
+      }
+      int other = natural_history->get_condition_to_transmit(state);
+      if (0 <= other && other != c) {
+	writers[other].push_back(c);
+      }
+    }
+    // transmitted places change group membership for all conditions
+    if (0 <= natural_history->get_place_type_to_transmit()) {
+      is_serial[c] = true;
+    }
+    // transmission updates the activities of the people it visits,
+    // which changes their schedules and draws random numbers
+    if (condition->get_transmissibility() > 0.0 || condition->get_transmission_network() != NULL) {
+      writers[membership].push_back(c);
+    }
+    if (Global::Enable_Records) {
+      writers[records].push_back(c);
+    }
+  }
+
+  for (int i = 0; i < Rule::get_number_of_compiled_rules(); ++i) {
+    Rule* rule = Rule::get_compiled_rule(i);
+    int c = rule->get_cond_id();
+    if (c < 0) {
+      continue;
+    }
+    string text = rule->get_name();
+    switch (rule->get_action_id()) {
+    case Rule_Action::GIVE_BIRTH :
+    case Rule_Action::DIE :
+    case Rule_Action::DIE_OLD :
+    case Rule_Action::JOIN :
+    case Rule_Action::QUIT :
+    case Rule_Action::REPORT :
+    case Rule_Action::RANDOMIZE_NETWORK :
+    case Rule_Action::IMPORT_COUNT :
+    case Rule_Action::IMPORT_PER_CAPITA :
+    case Rule_Action::IMPORT_LOCATION :
+    case Rule_Action::IMPORT_CENSUS_TRACT :
+    case Rule_Action::IMPORT_AGES :
+    case Rule_Action::COUNT_ALL_IMPORT_ATTEMPTS :
+    case Rule_Action::IMPORT_LIST :
+      is_serial[c] = true;
+      break;
+    case Rule_Action::ADD_EDGE_FROM :
+    case Rule_Action::ADD_EDGE_TO :
+    case Rule_Action::DELETE_EDGE_FROM :
+    case Rule_Action::DELETE_EDGE_TO :
+    case Rule_Action::SET_WEIGHT :
+    case Rule_Action::ABSENT :
+    case Rule_Action::PRESENT :
+    case Rule_Action::CLOSE :
+      writers[membership].push_back(c);
+      break;
+    default:
+      break;
+    }
+
+    // the var assigned by the rule
+    string var = "";
+    if (rule->get_action_id() == Rule_Action::SET) {
+      var = rule->get_var();
+    }
+    if (rule->get_action_id() == Rule_Action::SET_LIST) {
+      var = rule->get_list_var();
+    }
+
+    // any condition named in a rule may be read or changed by it
+    for (int r = 0; r < membership; ++r) {
+      if (resource_name[r] == var) {
+	writers[r].push_back(c);
+      }
+      else if (rule_mentions_name(text, resource_name[r])) {
+	if (r < n) {
+	  writers[r].push_back(c);
+	}
+	else {
+	  readers[r].push_back(c);
+	}
+      }
+    }
+    for (int g = 0; g < Group_Type::get_number_of_group_types(); ++g) {
+      if (rule_mentions_name(text, Group_Type::get_group_type_name(g))) {
+	readers[membership].push_back(c);
+      }
+    }
+  }
+
+  // conditions that share modified data belong to the same set
+  int_vector_t parent(n);
+  for (int c = 0; c < n; ++c) {
+    parent[c] = c;
+  }
+  for (int r = 0; r <= records; ++r) {
+    if (writers[r].empty()) {
+      continue;
+    }
+    int first = -1;
+    for (int k = 0; k < writers[r].size() + readers[r].size(); ++k) {
+      int c = k < writers[r].size() ? writers[r][k] : readers[r][k - writers[r].size()];
+      if (is_serial[c]) {
+	continue;
+      }
+      if (first < 0) {
+	first = find_condition_set(parent, c);
+      }
+      else {
+	parent[find_condition_set(parent, c)] = first;
+	first = find_condition_set(parent, first);
+      }
+    }
+  }
+
+  int_vector_t set_of_root(n, -1);
+  for (int c = 0; c < n; ++c) {
+    if (is_serial[c]) {
+      Condition::serial_conditions.push_back(c);
+      continue;
+    }
+    int root = find_condition_set(parent, c);
+    if (set_of_root[root] < 0) {
+      set_of_root[root] = Condition::condition_sets.size();
+      Condition::condition_sets.push_back(int_vector_t());
+    }
+    Condition::condition_sets[set_of_root[root]].push_back(c);
+  }
+
+  if (Condition::condition_sets.size() < 2) {
+    // nothing to run concurrently
+    FRED_VERBOSE(0, "CONDITION SETS: no independent sets of conditions found\n");
+    Condition::serial_conditions.clear();
+    Condition::condition_sets.clear();
+    return;
+  }
+
+  Condition::condition_set_rng = new RNG [Condition::condition_sets.size()];
+  for (int c = 0; c < Condition::serial_conditions.size(); ++c) {
+    FRED_VERBOSE(0, "CONDITION SETS: serial %s\n", Condition::get_name(Condition::serial_conditions[c]).c_str());
+  }
+  for (int i = 0; i < Condition::condition_sets.size(); ++i) {
+    string names = "";
+    for (int c = 0; c < Condition::condition_sets[i].size(); ++c) {
+      names += " " + Condition::get_name(Condition::condition_sets[i][c]);
+    }
+    FRED_VERBOSE(0, "CONDITION SETS: set %d:%s\n", i, names.c_str());
+  }
+}
+
+void Condition::update_condition_sets(int day, int hour) {
+
+  // order of condition updates within the serial phase and within each set
+  int_vector_t serial = Condition::serial_conditions;
+  std::vector<int_vector_t> order = Condition::condition_sets;
+  int sets = order.size();
+  if (!Global::Enable_Fixed_Order_Condition_Updates) {
+    FYShuffle<int>(serial);
+    for (int i = 0; i < sets; ++i) {
+      FYShuffle<int>(order[i]);
+    }
+  }
+
+  for (int k = 0; k < serial.size(); ++k) {
+    Condition::conditions[serial[k]]->update(day, hour);
+  }
+
+  // seed the stream of each set from the main stream, so that the results
+  // do not depend on the number of threads
+  for (int i = 0; i < sets; ++i) {
+    Condition::condition_set_rng[i].set_seed(Random::draw_random_int(0, INT_MAX - 1));
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < sets; ++i) {
+    Random::use_stream(&Condition::condition_set_rng[i]);
+    for (int k = 0; k < order[i].size(); ++k) {
+      Condition::conditions[order[i][k]]->update(day, hour);
+    }
+    Random::use_stream(NULL);
+  }
+}
+
+int Condition::get_next_update_hour(int day, int hour) {
+
+  // find the hours at which transmission may occur today
+  if (Condition::open_hours_day != day) {
+    bool transmits_in_groups = false;
+    for (int d = 0; d < Condition::number_of_conditions; ++d) {
+      char* mode = Condition::conditions[d]->get_transmission_mode();
+      if (strcmp(mode, "proximity")==0 || strcmp(mode, "respiratory")==0 || strcmp(mode, "network")==0
+	  || strcmp(mode, "environmental")==0) {
+	transmits_in_groups = true;
+      }
+    }
+    int number_of_group_types = Group_Type::get_number_of_group_types();
+    for (int h = 0; h < 24; ++h) {
+      Condition::open_hours[h] = false;
+      for (int type = 0; transmits_in_groups && type < number_of_group_types; ++type) {
+	if (Group_Type::get_group_type(type)->get_time_block(day, h) > 0) {
+	  Condition::open_hours[h] = true;
+	  break;
+	}
+      }
+    }
+    Condition::open_hours_day = day;
+  }
+
+  // the serial update shuffles the conditions at every hour; consume the
+  // same random numbers for each skipped hour so results are unchanged
+  bool shuffled = (Condition::number_of_conditions > 1
+		   && !Global::Enable_Fixed_Order_Condition_Updates
+		   && Condition::condition_sets.size() <= 1);
+
+  for (int next = hour + 1; next < 24; ++next) {
+    if (Condition::open_hours[next]) {
+      return next;
+    }
+    int step = 24 * day + next;
+    for (int d = 0; d < Condition::number_of_conditions; ++d) {
+      if (Condition::conditions[d]->epidemic->has_events(step)) {
+	return next;
+      }
+    }
+    if (shuffled) {
+      for (int d = 0; d < Condition::number_of_conditions; ++d) {
+	Random::draw_random();
+      }
+    }
+  }
+  return 24;
+}
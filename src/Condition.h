@@ -35,6 +35,7 @@ class Network;
 class Person;
 class Preference;
 class Place;
+class RNG;
 class Rule;
 class Transmission;
 
@@ -99,6 +100,14 @@ public:
 
   void decrement_group_state_count(int pgroup_type_id, Group* place, int state);
 
+  /**
+   * Update the group state counts of all conditions for a person
+   * joining or leaving the given group.
+   */
+  static void increment_group_state_counts(Person* person, int group_type_id, Group* group);
+
+  static void decrement_group_state_counts(Person* person, int group_type_id, Group* group);
+
   /**
    * @return the probability that agent's will stay home
    */
@@ -220,6 +229,16 @@ public:
 
   static void finish_conditions();
 
+  static void prepare_condition_sets();
+
+  static int get_number_of_condition_sets() {
+    return Condition::condition_sets.size();
+  }
+
+  static void update_condition_sets(int day, int hour);
+
+  static int get_next_update_hour(int day, int hour);
+
 private:
 
   // condition identifiers
@@ -246,6 +265,18 @@ private:
   static std::vector <Condition*> conditions;
   static std::vector<string> condition_names;
   static int number_of_conditions;
+
+  // for concurrent updates: conditions that affect all others are updated
+  // serially, then the independent sets of the remaining conditions are
+  // updated concurrently, each with its own random number stream
+  static int_vector_t serial_conditions;
+  static std::vector<int_vector_t> condition_sets;
+  static RNG* condition_set_rng;
+
+  // hours of the current day at which some group type opens, for
+  // skipping hours with no scheduled events
+  static int open_hours_day;
+  static bool open_hours[24];
 };
 
 #endif // _FRED_Condition_H
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <limits>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "County.h"
 #include "Date.h"
@@ -48,6 +49,10 @@ int*** County::female_migrants = NULL;
 std::vector<int> County::migration_admin_code;
 string County::projection_directory = "state";
 
+bool County::enable_resident_index = false;
+std::unordered_map<int, std::vector<int> > County::residents_born_on;
+int County::days_to_age[Demographics::MAX_AGE+1];
+
 std::random_device County::rd;
 std::mt19937_64 County::mt_engine(County::rd());
 
@@ -391,9 +396,6 @@ void County::update(int day) {
 
   if(Date::get_month() == 6 && Date::get_day_of_month() == 30) {
     
-    // prepare to select people to migrate out
-    this->group_population_by_sex_and_age(0);
-    
     if(County::enable_migration_to_target_popsize) {
       // migration to/from outside state
       this->migrate_to_target_popsize();
@@ -1877,8 +1879,8 @@ void County::county_to_county_migration() {
       int current_males = 0;
       int current_females = 0;
       for(int age = lower_age; age <= upper_age; ++age) {
-        current_males += this->males_of_age[age].size();
-        current_females += this->females_of_age[age].size();
+        current_males += this->eligible_males_of_age[age];
+        current_females += this->eligible_females_of_age[age];
       }
       // FRED_VERBOSE(0, "current males = %d current females = %d\n", current_males, current_females);
       assert(current_males >= 0);
@@ -2395,38 +2397,32 @@ void County::select_migrants(int day, int migrants, int lower_age, int upper_age
     target = County::get_county_with_admin_code(dest);
   }
 
-  person_vector_t people_to_migrate;
-  people_to_migrate.clear();
-
-  // add all the current county residents of the desired age and sex
-  // except those that have already been marked for migration today
-  if(sex == 'M') {
-    for(int age = lower_age; age <= upper_age; ++age) {
-      int size = this->males_of_age[age].size();
-      for(int i = 0; i < size ; ++i) {
-        Person* person = this->males_of_age[age][i];
-        if(person->is_eligible_to_migrate() || person->get_household()->is_group_quarters()) {
-          people_to_migrate.push_back(person);
-        }
-      }
-    }
-  } else {
-    for(int age = lower_age; age <= upper_age; ++age) {
-      int size = this->females_of_age[age].size();
-      for(int i = 0; i < size ; ++i) {
-        Person* person = this->females_of_age[age][i];
-        if(person->is_eligible_to_migrate() || person->get_household()->is_group_quarters()) {
-          people_to_migrate.push_back(person);
-        }
-      }
-    }
+  if(lower_age < 0) {
+    lower_age = 0;
+  }
+  if(upper_age > Demographics::MAX_AGE) {
+    upper_age = Demographics::MAX_AGE;
   }
 
-  std::shuffle(people_to_migrate.begin(), people_to_migrate.end(), County::mt_engine);
-
+  // draw residents of the desired age and sex at random from the index,
+  // skipping those that have already been marked for migration today.
+  // Residents of group quarters are never marked, so they remain
+  // candidates, but each is selected at most once here.
+  std::unordered_set<Person*> selected;
+  int candidates = this->get_number_of_residents(lower_age, upper_age, sex);
   int count = 0;
-  for(int i = 0; i < migrants && i < people_to_migrate.size(); ++i) {
-    Person* person = people_to_migrate[i];
+  int attempts = 0;
+  int max_attempts = 4 * migrants + 100;
+  while(count < migrants && attempts < max_attempts && candidates > 0) {
+    ++attempts;
+    Person* person = this->select_random_resident(lower_age, upper_age, sex);
+    if(person->is_deceased()) {
+      continue;
+    }
+    if(person->is_eligible_to_migrate() == false
+       && (person->get_household()->is_group_quarters() == false || selected.count(person) > 0)) {
+      continue;
+    }
     FRED_VERBOSE(1, "MIGRATE select_migrant person %d age %d sex %c\n",person->get_id(),person->get_age(),sex);
     if(target == NULL) {
       Person::prepare_to_migrate(day, person);
@@ -2434,13 +2430,43 @@ void County::select_migrants(int day, int migrants, int lower_age, int upper_age
       target->add_immigrant(person);
     }
     person->unset_eligible_to_migrate();
+    selected.insert(person);
     ++count;
   }
 
+  // if most residents are ineligible, list the remaining candidates
+  if(count < migrants && candidates > 0) {
+    person_vector_t people_to_migrate;
+    for(int age = lower_age; age <= upper_age; ++age) {
+      person_vector_t & residents = (sex == 'M' ? this->males_of_age[age] : this->females_of_age[age]);
+      for(int i = 0; i < residents.size(); ++i) {
+        Person* person = residents[i];
+        if(person->is_deceased() || selected.count(person) > 0) {
+          continue;
+        }
+        if(person->is_eligible_to_migrate() || person->get_household()->is_group_quarters()) {
+          people_to_migrate.push_back(person);
+        }
+      }
+    }
+    std::shuffle(people_to_migrate.begin(), people_to_migrate.end(), County::mt_engine);
+    for(int i = 0; count < migrants && i < people_to_migrate.size(); ++i) {
+      Person* person = people_to_migrate[i];
+      FRED_VERBOSE(1, "MIGRATE select_migrant person %d age %d sex %c\n",person->get_id(),person->get_age(),sex);
+      if(target == NULL) {
+        Person::prepare_to_migrate(day, person);
+      } else {
+        target->add_immigrant(person);
+      }
+      person->unset_eligible_to_migrate();
+      ++count;
+    }
+  }
+
   if(migrants != count) {
     FRED_VERBOSE(0, "MIGRATE select_migrants from %d to %d: wanted %d people found %d candidates between %d and %d sex %c, got %d\n",
         (int)this->get_admin_division_code(), dest, migrants,
-        people_to_migrate.size(), lower_age, upper_age, sex, count);
+        candidates, lower_age, upper_age, sex, count);
   }
 }
 
@@ -2498,65 +2524,174 @@ int County::get_current_popsize(int age_min, int age_max, char sex) {
 
 void County::recompute_county_popsize() {
   for(int i = 0; i <= Demographics::MAX_AGE; ++i) {
-    this->female_popsize[i] = 0;
-    this->male_popsize[i] = 0;
+    this->female_popsize[i] = this->females_of_age[i].size();
+    this->male_popsize[i] = this->males_of_age[i].size();
   }
-  for (int i = 0; i < this->number_of_households; ++i) {
-    Household* hh = get_hh(i);
-    int hh_size = hh->get_size();
-    for (int j = 0; j < hh_size; j++) {
-      Person* person = hh->get_member(j);
-      int age = person->get_age();
-      if(age > Demographics::MAX_AGE) {
-        age = Demographics::MAX_AGE;
+}
+
+void County::group_population_by_sex_and_age(int reset) {
+  // count the residents of each age and sex who are eligible to migrate
+  for(int age = 0; age <= Demographics::MAX_AGE; ++age) {
+    for(int s = 0; s < 2; ++s) {
+      person_vector_t & residents = (s == 0 ? this->males_of_age[age] : this->females_of_age[age]);
+      int eligible = 0;
+      for(int i = 0; i < residents.size(); ++i) {
+        Person* person = residents[i];
+        if(person->is_deceased()) {
+          continue;
+        }
+        if(reset && (person->get_household()->is_group_quarters() == false)) {
+          person->set_eligible_to_migrate();
+        }
+        if(person->is_eligible_to_migrate()) {
+          ++eligible;
+        }
       }
-      char sex = person->get_sex();
-      if(sex == 'M') {
-        this->male_popsize[age]++;
+      if(s == 0) {
+        this->eligible_males_of_age[age] = eligible;
       } else {
-        this->female_popsize[age]++;
+        this->eligible_females_of_age[age] = eligible;
       }
     }
   }
 }
 
-void County::group_population_by_sex_and_age(int reset) {
-  int day = Global::Simulation_Day;
-  // FRED_VERBOSE(0, "County group_pop : FIPS = %d reset = %d\n", (int) get_admin_division_code(), reset);
-  for(int i = 0; i <= Demographics::MAX_AGE; ++i) {
-    this->males_of_age[i].clear();
-    this->females_of_age[i].clear();
+void County::add_resident(Person* person) {
+  int age = person->get_age();
+  if(age > Demographics::MAX_AGE) {
+    age = Demographics::MAX_AGE;
   }
-  // FRED_VERBOSE(0, "County group_pop : FIPS = %d households = %d\n", (int) get_admin_division_code(), this->number_of_households);
-  for (int i = 0; i < this->number_of_households; ++i) {
-    Household* hh = get_hh(i);
-    assert(hh != NULL);
-    int hh_size = hh->get_size();
-    for (int j = 0; j < hh_size; j++) {
-      Person* person = hh->get_member(j);
-      assert(person != NULL);
-      if(person->is_deceased()) {
-        continue;
-      }
-      if(reset && (hh->is_group_quarters() == false)) {
-        person->set_eligible_to_migrate();
+  person_vector_t & residents = (person->get_sex() == 'M' ? this->males_of_age[age] : this->females_of_age[age]);
+  person->set_county_index(this->index, age, residents.size());
+  residents.push_back(person);
+}
+
+void County::remove_resident(Person* person) {
+  int age = person->get_county_index_age();
+  int pos = person->get_county_index_pos();
+  person_vector_t & residents = (person->get_sex() == 'M' ? this->males_of_age[age] : this->females_of_age[age]);
+  assert(residents[pos] == person);
+  // move the last resident into this position
+  Person* last = residents.back();
+  residents[pos] = last;
+  last->set_county_index(this->index, age, pos);
+  residents.pop_back();
+  person->set_county_index(-1, -1, -1);
+}
+
+int County::get_number_of_residents(int lower_age, int upper_age, char sex) {
+  int count = 0;
+  for(int age = lower_age; age <= upper_age; ++age) {
+    count += (sex == 'M' ? this->males_of_age[age].size() : this->females_of_age[age].size());
+  }
+  return count;
+}
+
+Person* County::select_random_resident(int lower_age, int upper_age, char sex) {
+  int count = this->get_number_of_residents(lower_age, upper_age, sex);
+  if(count == 0) {
+    return NULL;
+  }
+  int n = Random::draw_random_int(0, count-1);
+  for(int age = lower_age; age <= upper_age; ++age) {
+    person_vector_t & residents = (sex == 'M' ? this->males_of_age[age] : this->females_of_age[age]);
+    if(n < residents.size()) {
+      return residents[n];
+    }
+    n -= residents.size();
+  }
+  return NULL;
+}
+
+void County::setup_resident_index() {
+  // the number of days after birth on which each age is reached
+  for(int age = 0; age <= Demographics::MAX_AGE; ++age) {
+    int days = (int)(365.25 * age);
+    while(days > 0 && (int)(double(days - 1) / 365.25) >= age) {
+      --days;
+    }
+    while((int)(double(days) / 365.25) < age) {
+      ++days;
+    }
+    County::days_to_age[age] = days;
+  }
+
+  County::residents_born_on.clear();
+  County::enable_resident_index = true;
+  for(int i = 0; i < County::get_number_of_counties(); ++i) {
+    County* county = County::counties[i];
+    for(int j = 0; j < county->get_number_of_households(); ++j) {
+      Household* hh = county->get_hh(j);
+      int hh_size = hh->get_size();
+      for(int k = 0; k < hh_size; ++k) {
+        County::add_to_resident_index(hh->get_member(k));
       }
-      if(person->is_eligible_to_migrate() == false) {
+    }
+  }
+}
+
+void County::add_to_resident_index(Person* person) {
+  if(County::enable_resident_index == false || person->get_county_index_pos() >= 0) {
+    return;
+  }
+  Place* house = person->get_household();
+  if(house == NULL) {
+    return;
+  }
+  County* county = County::get_county_with_admin_code(house->get_county_admin_code());
+  county->add_resident(person);
+  County::residents_born_on[person->get_birthday_sim_day()].push_back(person->get_id());
+}
+
+void County::remove_from_resident_index(Person* person) {
+  if(County::enable_resident_index == false || person->get_county_index_pos() < 0) {
+    return;
+  }
+  County::counties[person->get_county_index_county()]->remove_resident(person);
+}
+
+void County::move_in_resident_index(Person* person, Place* house) {
+  if(County::enable_resident_index == false || person->get_county_index_pos() < 0) {
+    return;
+  }
+  County* county = County::get_county_with_admin_code(house->get_county_admin_code());
+  if(county->index != person->get_county_index_county()) {
+    County::counties[person->get_county_index_county()]->remove_resident(person);
+    county->add_resident(person);
+  }
+}
+
+void County::update_resident_index(int day) {
+  if(County::enable_resident_index == false) {
+    return;
+  }
+  // move the residents who have a birthday today to their new age,
+  // dropping anyone who is no longer in the population
+  for(int age = 1; age <= Demographics::MAX_AGE; ++age) {
+    std::unordered_map<int, std::vector<int> >::iterator itr;
+    itr = County::residents_born_on.find(day - County::days_to_age[age]);
+    if(itr == County::residents_born_on.end()) {
+      continue;
+    }
+    std::vector<int> & ids = itr->second;
+    int n = 0;
+    for(int i = 0; i < ids.size(); ++i) {
+      Person* person = Person::get_person_with_id(ids[i]);
+      if(person == NULL) {
         continue;
       }
-      int age = person->get_age();
-      if(age > Demographics::MAX_AGE) {
-        age = Demographics::MAX_AGE;
-      }
-      char sex = person->get_sex();
-      if(sex == 'M') {
-        this->males_of_age[age].push_back(person);;
-      } else {
-        this->females_of_age[age].push_back(person);;
+      ids[n++] = ids[i];
+      if(person->get_county_index_pos() >= 0 && person->get_county_index_age() == age - 1) {
+        County* county = County::counties[person->get_county_index_county()];
+        county->remove_resident(person);
+        county->add_resident(person);
       }
     }
+    ids.resize(n);
+    if(n == 0) {
+      County::residents_born_on.erase(itr);
+    }
   }
-  // FRED_VERBOSE(0, "County group_pop finished : FIPS = %d reset = %d\n", (int) get_admin_division_code(), reset);
 }
 
 void County::report() {
@@ -2665,6 +2800,7 @@ County* County::get_county_with_admin_code(int county_admin_code) {
   itr = County::lookup_map.find(county_admin_code);
   if(itr == County::lookup_map.end()) {
     county = new County(county_admin_code);
+    county->index = County::counties.size();
     County::counties.push_back(county);
     County::lookup_map[county_admin_code] = county;
   } else {
@@ -2678,6 +2814,9 @@ void County::setup_counties() {
   for(int i = 0; i < County::get_number_of_counties(); ++i) {
     County::counties[i]->setup();
   }
+  if(Global::Enable_Population_Dynamics) {
+    County::setup_resident_index();
+  }
 }
 
 void County::move_students_in_counties() {
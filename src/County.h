@@ -156,6 +156,17 @@ class County : public Admin_Division {
   void read_migration_properties();
   double get_migration_rate(int sex, int age, int src, int dst);
   void group_population_by_sex_and_age(int reset);
+
+  // index of residents by sex and age
+  void add_resident(Person* person);
+  void remove_resident(Person* person);
+  int get_number_of_residents(int lower_age, int upper_age, char sex);
+  Person* select_random_resident(int lower_age, int upper_age, char sex);
+  static void setup_resident_index();
+  static void add_to_resident_index(Person* person);
+  static void remove_from_resident_index(Person* person);
+  static void move_in_resident_index(Person* person, Place* house);
+  static void update_resident_index(int day);
   void report();
   void move_students();
 
@@ -196,8 +207,12 @@ class County : public Admin_Division {
   std::vector< pair<Person*, int> > ready_to_move;
   int target_males[AGE_GROUPS][TARGET_YEARS];
   int target_females[AGE_GROUPS][TARGET_YEARS];
+  // residents of each age, kept up to date as people are born, die,
+  // move and have birthdays
   person_vector_t males_of_age[Demographics::MAX_AGE+1];
   person_vector_t females_of_age[Demographics::MAX_AGE+1];
+  int eligible_males_of_age[Demographics::MAX_AGE+1];
+  int eligible_females_of_age[Demographics::MAX_AGE+1];
   int number_of_households;
 
   // pointers to nursing homes
@@ -231,6 +246,9 @@ class County : public Admin_Division {
   static std::mt19937_64 mt_engine;
 
   static std::vector<County*> counties;
+  static bool enable_resident_index;
+  static std::unordered_map<int, std::vector<int> > residents_born_on;
+  static int days_to_age[Demographics::MAX_AGE+1];
   static std::unordered_map<int,County*> lookup_map;
 
 };
@@ -0,0 +1,369 @@
+/*
+ * This file is part of the FRED system.
+ *
+ * Copyright (c) 2010-2012, University of Pittsburgh, John Grefenstette, Shawn Brown, 
+ * Roni Rosenfield, Alona Fyshe, David Galloway, Nathan Stone, Jay DePasse, 
+ * Anuroop Sriram, and Donald Burke
+ * All rights reserved.
+ *
+ * Copyright (c) 2013-2019, University of Pittsburgh, John Grefenstette, Robert Frankeny,
+ * David Galloway, Mary Krauland, Michael Lann, David Sinclair, and Donald Burke
+ * All rights reserved.
+ *
+ * FRED is distributed on the condition that users fully understand and agree to all terms of the 
+ * End User License Agreement.
+ *
+ * FRED is intended FOR NON-COMMERCIAL, EDUCATIONAL OR RESEARCH PURPOSES ONLY.
+ *
+ * See the file "LICENSE" for more information.
+ */
+
+//
+//
+// File: Elevation_Layer.cc
+//
+
+#include <cmath>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Elevation_Layer.h"
+#include "Place.h"
+#include "Place_Type.h"
+#include "Utils.h"
+
+// header of an elevation cache file, followed by rows * cols floats
+typedef struct {
+  int magic;
+  int cells_per_degree;
+  int row0;
+  int col0;
+  int rows;
+  int cols;
+  int sites;
+  int unused;
+  unsigned long long source;
+} elevation_cache_header_t;
+
+static const int ELEVATION_CACHE_MAGIC = 0x56454c45;
+
+// how far (in raster nodes) to look for data around a point whose four
+// surrounding nodes have no elevation sites
+static const int ELEVATION_SEARCH_RADIUS = 8;
+
+
+Elevation_Layer::Elevation_Layer(fred::geo minlon, fred::geo minlat, fred::geo maxlon, fred::geo maxlat, int cells_per_degree) {
+  this->cells_per_degree = cells_per_degree;
+
+  // nodes are at multiples of 1/cells_per_degree degrees, with a margin
+  // of one node around the region
+  this->row0 = (int) floor((minlat + 90.0) * cells_per_degree) - 1;
+  this->col0 = (int) floor((minlon + 180.0) * cells_per_degree) - 1;
+  this->rows = (int) ceil((maxlat + 90.0) * cells_per_degree) + 2 - this->row0;
+  this->cols = (int) ceil((maxlon + 180.0) * cells_per_degree) + 2 - this->col0;
+  this->sites = 0;
+  this->source = 0;
+  this->elevation = NULL;
+  this->count = NULL;
+  this->mapped = NULL;
+  this->mapped_size = 0;
+
+  FRED_VERBOSE(0, "Elevation_Layer: %d cells per degree rows %d cols %d\n",
+	       this->cells_per_degree, this->rows, this->cols);
+}
+
+Elevation_Layer::~Elevation_Layer() {
+  if (this->mapped != NULL) {
+    munmap(this->mapped, this->mapped_size);
+  }
+  else if (this->elevation != NULL) {
+    delete[] this->elevation;
+  }
+  if (this->count != NULL) {
+    delete[] this->count;
+  }
+}
+
+void Elevation_Layer::set_source(const char* data_dir, const std::vector<std::string> &files) {
+  // FNV-1a hash of the directory and the name, size and modification
+  // time of each file
+  unsigned long long hash = 14695981039346656037ULL;
+  std::string key = data_dir;
+  for (size_t i = 0; i < files.size(); ++i) {
+    struct stat st;
+    long long size = -1;
+    long long mtime = -1;
+    if (stat(files[i].c_str(), &st) == 0) {
+      size = st.st_size;
+      mtime = st.st_mtime;
+    }
+    key += "|" + files[i] + "|" + std::to_string(size) + "|" + std::to_string(mtime);
+  }
+  for (size_t i = 0; i < key.size(); ++i) {
+    hash ^= (unsigned char) key[i];
+    hash *= 1099511628211ULL;
+  }
+  this->source = hash;
+}
+
+void Elevation_Layer::get_cache_file(const char* cache_dir, char* cache_file) {
+  snprintf(cache_file, FRED_STRING_SIZE, "%s/elevation_%d_%d_%d_%d_%d_%016llx.bin", cache_dir,
+	   this->cells_per_degree, this->row0, this->col0, this->rows, this->cols, this->source);
+}
+
+bool Elevation_Layer::load_cache(const char* cache_dir) {
+  char cache_file[FRED_STRING_SIZE];
+  get_cache_file(cache_dir, cache_file);
+
+  int fd = open(cache_file, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  size_t size = sizeof(elevation_cache_header_t) + sizeof(float) * (size_t) this->rows * this->cols;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size != size) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  elevation_cache_header_t* header = (elevation_cache_header_t*) map;
+  if (header->magic != ELEVATION_CACHE_MAGIC
+      || header->cells_per_degree != this->cells_per_degree
+      || header->row0 != this->row0 || header->col0 != this->col0
+      || header->rows != this->rows || header->cols != this->cols
+      || header->source != this->source) {
+    munmap(map, size);
+    return false;
+  }
+
+  this->mapped = map;
+  this->mapped_size = size;
+  this->sites = header->sites;
+  this->elevation = (float*) ((char*) map + sizeof(elevation_cache_header_t));
+  FRED_VERBOSE(0, "Elevation_Layer: mapped cache file %s\n", cache_file);
+  return true;
+}
+
+void Elevation_Layer::save_cache(const char* cache_dir) {
+  if (this->elevation == NULL || this->mapped != NULL) {
+    return;
+  }
+  char cache_file[FRED_STRING_SIZE];
+  char tmp_file[FRED_STRING_SIZE];
+  get_cache_file(cache_dir, cache_file);
+
+  // write to a temporary file first so that concurrent runs never map a
+  // partially written cache
+  if (snprintf(tmp_file, FRED_STRING_SIZE, "%s.%d", cache_file, (int) getpid()) >= FRED_STRING_SIZE) {
+    FRED_VERBOSE(0, "Elevation_Layer: cache file name %s is too long\n", cache_file);
+    return;
+  }
+  FILE* fp = fopen(tmp_file, "wb");
+  if (fp == NULL) {
+    FRED_VERBOSE(0, "Elevation_Layer: can't write cache file %s\n", tmp_file);
+    return;
+  }
+  elevation_cache_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic = ELEVATION_CACHE_MAGIC;
+  header.cells_per_degree = this->cells_per_degree;
+  header.row0 = this->row0;
+  header.col0 = this->col0;
+  header.rows = this->rows;
+  header.cols = this->cols;
+  header.sites = this->sites;
+  header.source = this->source;
+  size_t cells = (size_t) this->rows * this->cols;
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+    && fwrite(this->elevation, sizeof(float), cells, fp) == cells;
+  ok = (fclose(fp) == 0) && ok;
+  if (ok && rename(tmp_file, cache_file) == 0) {
+    FRED_VERBOSE(0, "Elevation_Layer: wrote cache file %s\n", cache_file);
+  }
+  else {
+    unlink(tmp_file);
+  }
+}
+
+int Elevation_Layer::get_cells_per_degree_of_file(const char* filename) {
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL) {
+    return 0;
+  }
+
+  // the site spacing is the smallest nonzero step between successive sites
+  double x, y, elev;
+  double last_x = 0.0;
+  double last_y = 0.0;
+  double spacing = 1.0;
+  int n = 0;
+  while (n < 100000 && fscanf(fp, "%lf %lf %lf ", &x, &y, &elev) == 3) {
+    if (n > 0) {
+      double dx = fabs(x - last_x);
+      double dy = fabs(y - last_y);
+      if (1e-7 < dx && dx < spacing) {
+	spacing = dx;
+      }
+      if (1e-7 < dy && dy < spacing) {
+	spacing = dy;
+      }
+    }
+    last_x = x;
+    last_y = y;
+    n++;
+  }
+  fclose(fp);
+
+  int cells_per_degree = (int) lround(1.0 / spacing);
+  if (cells_per_degree < 1) {
+    cells_per_degree = 1;
+  }
+  if (cells_per_degree > 3600) {
+    cells_per_degree = 3600;
+  }
+  return cells_per_degree;
+}
+
+int Elevation_Layer::read_elevation_file(const char* filename) {
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL) {
+    return -1;
+  }
+  int n = 0;
+  double x, y, elev;
+  while (fscanf(fp, "%lf %lf %lf ", &x, &y, &elev) == 3) {
+    add_elevation_site(y, x, elev);
+    n++;
+  }
+  fclose(fp);
+  return n;
+}
+
+void Elevation_Layer::add_elevation_site(fred::geo lat, fred::geo lon, double elev) {
+  int row = (int) lround((lat + 90.0) * this->cells_per_degree) - this->row0;
+  int col = (int) lround((lon + 180.0) * this->cells_per_degree) - this->col0;
+  if (row < 0 || col < 0 || row >= this->rows || col >= this->cols) {
+    return;
+  }
+  if (this->count == NULL) {
+    size_t cells = (size_t) this->rows * this->cols;
+    this->elevation = new float[cells];
+    this->count = new int[cells];
+    for (size_t i = 0; i < cells; ++i) {
+      this->elevation[i] = 0.0;
+      this->count[i] = 0;
+    }
+  }
+  // sites falling on the same node are averaged
+  size_t i = (size_t) row * this->cols + col;
+  this->elevation[i] += elev;
+  this->count[i]++;
+  this->sites++;
+}
+
+void Elevation_Layer::finish_elevation_sites() {
+  if (this->count == NULL) {
+    return;
+  }
+  size_t cells = (size_t) this->rows * this->cols;
+  for (size_t i = 0; i < cells; ++i) {
+    if (this->count[i] > 0) {
+      this->elevation[i] /= this->count[i];
+    }
+    else {
+      this->elevation[i] = NAN;
+    }
+  }
+  delete[] this->count;
+  this->count = NULL;
+  FRED_VERBOSE(0, "Elevation_Layer: %d elevation sites\n", this->sites);
+}
+
+double Elevation_Layer::get_elevation(fred::geo lat, fred::geo lon) {
+  if (this->elevation == NULL) {
+    return 0.0;
+  }
+  double y = (lat + 90.0) * this->cells_per_degree - this->row0;
+  double x = (lon + 180.0) * this->cells_per_degree - this->col0;
+  int row = (int) floor(y);
+  int col = (int) floor(x);
+  if (row < 0 || col < 0 || row + 1 >= this->rows || col + 1 >= this->cols) {
+    return 0.0;
+  }
+
+  // bilinear interpolation among the surrounding nodes that have data
+  double t = y - row;
+  double u = x - col;
+  double weight[4] = { (1.0 - t) * (1.0 - u), (1.0 - t) * u, t * (1.0 - u), t * u };
+  const float* node = this->elevation + (size_t) row * this->cols + col;
+  float value[4] = { node[0], node[1], node[this->cols], node[this->cols + 1] };
+  double sum = 0.0;
+  double total_weight = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    if (!std::isnan(value[i])) {
+      sum += weight[i] * value[i];
+      total_weight += weight[i];
+    }
+  }
+  if (total_weight > 0.0) {
+    return sum / total_weight;
+  }
+  for (int i = 0; i < 4; ++i) {
+    if (!std::isnan(value[i])) {
+      return value[i];
+    }
+  }
+
+  // no data at the surrounding nodes: use the nearest node with data
+  row = (int) lround(y);
+  col = (int) lround(x);
+  for (int radius = 1; radius <= ELEVATION_SEARCH_RADIUS; ++radius) {
+    double min_dist = -1.0;
+    double elev = 0.0;
+    for (int r = row - radius; r <= row + radius; ++r) {
+      for (int c = col - radius; c <= col + radius; ++c) {
+	if (r < 0 || c < 0 || r >= this->rows || c >= this->cols) {
+	  continue;
+	}
+	float e = this->elevation[(size_t) r * this->cols + c];
+	if (std::isnan(e)) {
+	  continue;
+	}
+	double dist = (r - y) * (r - y) + (c - x) * (c - x);
+	if (min_dist < 0.0 || dist < min_dist) {
+	  min_dist = dist;
+	  elev = e;
+	}
+      }
+    }
+    if (min_dist >= 0.0) {
+      return elev;
+    }
+  }
+  return 0.0;
+}
+
+void Elevation_Layer::set_elevations(Place_Type* place_type) {
+  int n = place_type->get_number_of_places();
+#pragma omp parallel for
+  for (int p = 0; p < n; ++p) {
+    Place* place = place_type->get_place(p);
+    fred::geo lat = place->get_latitude();
+    fred::geo lon = place->get_longitude();
+    double y = (lat + 90.0) * this->cells_per_degree - this->row0;
+    double x = (lon + 180.0) * this->cells_per_degree - this->col0;
+    // places outside the raster keep the elevation from the input file
+    if (0.0 <= y && y < this->rows && 0.0 <= x && x < this->cols) {
+      place->set_elevation(get_elevation(lat, lon));
+    }
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the FRED system.
+ *
+ * Copyright (c) 2010-2012, University of Pittsburgh, John Grefenstette, Shawn Brown, 
+ * Roni Rosenfield, Alona Fyshe, David Galloway, Nathan Stone, Jay DePasse, 
+ * Anuroop Sriram, and Donald Burke
+ * All rights reserved.
+ *
+ * Copyright (c) 2013-2019, University of Pittsburgh, John Grefenstette, Robert Frankeny,
+ * David Galloway, Mary Krauland, Michael Lann, David Sinclair, and Donald Burke
+ * All rights reserved.
+ *
+ * FRED is distributed on the condition that users fully understand and agree to all terms of the 
+ * End User License Agreement.
+ *
+ * FRED is intended FOR NON-COMMERCIAL, EDUCATIONAL OR RESEARCH PURPOSES ONLY.
+ *
+ * See the file "LICENSE" for more information.
+ */
+
+//
+//
+// File: Elevation_Layer.h
+//
+
+#ifndef _FRED_ELEVATION_LAYER_H
+#define _FRED_ELEVATION_LAYER_H
+
+#include <string>
+#include <vector>
+
+#include "Global.h"
+
+class Place_Type;
+
+// A regular raster of elevations (in meters) covering the simulation
+// region. Elevation sites are snapped to the nearest raster node and
+// elevations at arbitrary points are obtained by bilinear interpolation
+// among the four surrounding nodes, so each lookup takes constant time.
+//
+// The raster for a given region, resolution and source data can be
+// cached as a binary file, which later runs map directly into memory
+// instead of re-reading the elevation data files.
+
+class Elevation_Layer {
+ public:
+  Elevation_Layer(fred::geo minlon, fred::geo minlat, fred::geo maxlon, fred::geo maxlat, int cells_per_degree);
+  ~Elevation_Layer();
+
+  // identify the data files the raster is built from, for the cache
+  void set_source(const char* data_dir, const std::vector<std::string> &files);
+  bool load_cache(const char* cache_dir);
+  void save_cache(const char* cache_dir);
+  int read_elevation_file(const char* filename);
+  void add_elevation_site(fred::geo lat, fred::geo lon, double elev);
+  void finish_elevation_sites();
+  double get_elevation(fred::geo lat, fred::geo lon);
+  void set_elevations(Place_Type* place_type);
+
+  int get_cells_per_degree() {
+    return this->cells_per_degree;
+  }
+
+  int get_number_of_sites() {
+    return this->sites;
+  }
+
+  static int get_cells_per_degree_of_file(const char* filename);
+
+ private:
+  void get_cache_file(const char* cache_dir, char* cache_file);
+
+  int cells_per_degree;
+  int row0;		// global row of the first raster row
+  int col0;		// global col of the first raster col
+  int rows;
+  int cols;
+  int sites;
+  unsigned long long source;	// hash of the data files, see set_source
+  float* elevation;	// [rows * cols], NAN where no data
+  int* count;		// number of sites at each node while loading
+  void* mapped;		// non-NULL if the raster is mapped from a cache file
+  size_t mapped_size;
+};
+
+#endif // _FRED_ELEVATION_LAYER_H
@@ -23,8 +23,17 @@
 // File: Environmental_Transmission.cc
 //
 
+#include <math.h>
+
 #include "Environmental_Transmission.h"
 #include "Condition.h"
+#include "Global.h"
+#include "Group.h"
+#include "Person.h"
+#include "Place.h"
+#include "Place_Type.h"
+#include "Property.h"
+#include "Random.h"
 
 //////////////////////////////////////////////////////////
 //
@@ -32,6 +41,196 @@
 //
 //////////////////////////////////////////////////////////
 
+Environmental_Transmission::Environmental_Transmission() {
+  this->condition = NULL;
+  this->shedding_rate = 1.0;
+  this->decay_rate = 0.0;
+  this->uptake_rate = 1.0;
+  this->min_load = 0.001;
+}
+
 void Environmental_Transmission::setup(Condition* condition) {
+  this->condition = condition;
+  const char* name = condition->get_name();
+
+  // optional properties
+  Property::disable_abort_on_failure();
+  Property::get_property(name, "shedding_rate", &this->shedding_rate);
+  Property::get_property(name, "decay_rate", &this->decay_rate);
+  Property::get_property(name, "uptake_rate", &this->uptake_rate);
+  Property::get_property(name, "min_load", &this->min_load);
+
+  // ventilation may be set for each place type
+  double ventilation = 0.0;
+  Property::get_property(name, "ventilation_rate", &ventilation);
+  int number_of_place_types = Place_Type::get_number_of_place_types();
+  this->ventilation_rate.assign(number_of_place_types, ventilation);
+  for (int type = 0; type < number_of_place_types; type++) {
+    string type_name = Place_Type::get_place_type(type)->get_name();
+    Property::get_property(name, type_name, "ventilation_rate", &this->ventilation_rate[type]);
+  }
+
+  // so may the volume over which the load is diluted; without one, the
+  // load is shared among the members of the place
+  double volume = 0.0;
+  Property::get_property(name, "volume", &volume);
+  this->volume.assign(number_of_place_types, volume);
+  for (int type = 0; type < number_of_place_types; type++) {
+    string type_name = Place_Type::get_place_type(type)->get_name();
+    Property::get_property(name, type_name, "volume", &this->volume[type]);
+  }
+  Property::set_abort_on_failure();
+
+  FRED_VERBOSE(0, "environmental transmission for %s shedding %f decay %f uptake %f min_load %f\n",
+	       name, this->shedding_rate, this->decay_rate, this->uptake_rate, this->min_load);
+}
+
+void Environmental_Transmission::prepare() {
+  // the reservoirs are allocated once all places are available
+  int number_of_place_types = Place_Type::get_number_of_place_types();
+  this->load.resize(number_of_place_types);
+  this->condition_to_transmit.resize(number_of_place_types);
+  this->contaminated.resize(number_of_place_types);
+  this->last_update_step.assign(number_of_place_types, 0);
+  this->has_load.assign(number_of_place_types, false);
+  for (int type = 0; type < number_of_place_types; type++) {
+    int n = Place_Type::get_place_type(type)->get_number_of_places();
+    this->load[type].assign(n, 0.0);
+    this->condition_to_transmit[type].assign(n, this->condition->get_id());
+    this->contaminated[type].clear();
+  }
+}
+
+double Environmental_Transmission::get_load(Place* place) {
+  int type = place->get_type_id();
+  int index = place->get_index();
+  if (index < this->load[type].size()) {
+    return this->load[type][index];
+  }
+  return 0.0;
+}
+
+void Environmental_Transmission::update_reservoirs(int day, int hour, int place_type_id) {
+
+  // apply decay and ventilation for the hours since the last update, and
+  // list the places that are still contaminated
+
+  int step = 24*day + hour;
+  int hours = step - this->last_update_step[place_type_id];
+  if (hours <= 0) {
+    return;
+  }
+  this->last_update_step[place_type_id] = step;
+  if (this->has_load[place_type_id] == false) {
+    return;
+  }
+
+  double retention = pow((1.0 - this->decay_rate) * (1.0 - this->ventilation_rate[place_type_id]), hours);
+  double threshold = this->min_load;
+  double_vector_t & reservoir = this->load[place_type_id];
+  double* x = reservoir.data();
+  int n = reservoir.size();
+  for (int i = 0; i < n; i++) {
+    double y = x[i] * retention;
+    x[i] = (y < threshold) ? 0.0 : y;
+  }
+
+  Place_Type* place_type = Place_Type::get_place_type(place_type_id);
+  place_vector_t & places = this->contaminated[place_type_id];
+  places.clear();
+  for (int i = 0; i < n; i++) {
+    if (x[i] > 0.0) {
+      places.push_back(place_type->get_place(i));
+    }
+  }
+  this->has_load[place_type_id] = (places.size() > 0);
 }
 
+void Environmental_Transmission::transmission(int day, int hour, int condition_id, Group* group, int time_block) {
+
+  // Environmental_Transmission must occur on a Place type
+  if (group==NULL || group->is_a_place()==false) {
+    return;
+  }
+
+  Place* place = static_cast<Place*>(group);
+  int type = place->get_type_id();
+  int index = place->get_index();
+  if (index >= this->load[type].size()) {
+    // a place added after the reservoirs were allocated
+    this->load[type].resize(index+1, 0.0);
+    this->condition_to_transmit[type].resize(index+1, condition_id);
+  }
+
+  FRED_VERBOSE(1, "environmental transmission day %d condition %d place %d %s load %f\n",
+	       day, condition_id, place->get_id(), place->get_label(), this->load[type][index]);
+
+  // have place record first and last day of possible transmission
+  place->record_transmissible_days(day, condition_id);
+
+  // transmissible people present shed into the reservoir
+  person_vector_t* transmissibles = place->get_transmissible_people(condition_id);
+  int number_of_transmissibles = transmissibles->size();
+  double shed = 0.0;
+  for (int n = 0; n < number_of_transmissibles; ++n) {
+    Person* source = (*transmissibles)[n];
+    if (source->is_transmissible(condition_id)) {
+      shed += source->get_transmissibility(condition_id);
+      this->condition_to_transmit[type][index] = this->condition->get_condition_to_transmit(source->get_state(condition_id));
+    }
+  }
+  if (shed > 0.0) {
+    this->load[type][index] += this->shedding_rate * shed * time_block;
+    this->has_load[type] = true;
+  }
+
+  double load = this->load[type][index];
+  if (load < this->min_load || place->get_size() == 0) {
+    return;
+  }
+
+  // probability of exposure of each susceptible present during the time
+  // block, from the concentration of the load in the place
+  double volume = (this->volume[type] > 0.0) ? this->volume[type] : place->get_size();
+  double dose = this->condition->get_transmissibility() * this->uptake_rate * (load / volume) * time_block;
+  double transmission_prob = 1.0 - exp(-dose);
+  if (transmission_prob <= 0.0) {
+    return;
+  }
+
+  // exposures are attributed to a transmissible person present, if any,
+  // and otherwise to the environment
+  RNG* previous_stream = Random::get_stream();
+  if (Global::Enable_Common_Random_Numbers) {
+    use_keyed_stream(RANDOM_SITE_ENVIRONMENTAL_SOURCE, place->get_id(), condition_id, day, hour, 0);
+  }
+  Person* source = Person::get_import_agent();
+  if (number_of_transmissibles > 0) {
+    source = (*transmissibles)[Random::draw_random_int(0, number_of_transmissibles - 1)];
+  }
+  int condition_to_transmit = this->condition_to_transmit[type][index];
+
+  int size = place->get_size();
+  for (int i = 0; i < size; i++) {
+    Person* host = place->get_member(i);
+    if (host == source) {
+      continue;
+    }
+    if (host->is_susceptible(condition_to_transmit) == false) {
+      continue;
+    }
+    host->update_activities(day);
+    if (!host->is_present(day, place)) {
+      continue;
+    }
+    if (Global::Enable_Common_Random_Numbers) {
+      // each host's exposure is keyed by the host and the place
+      use_keyed_stream(RANDOM_SITE_ENVIRONMENTAL_HOST, host->get_id(), condition_id, day, hour, place->get_id());
+    }
+    Transmission::attempt_transmission(transmission_prob, source, host, condition_id, condition_to_transmit, day, hour, place);
+  }
+  Random::use_stream(previous_stream);
+
+  FRED_VERBOSE(1, "environmental transmission finished day %d condition %d place %d %s\n",
+	       day, condition_id, place->get_id(), place->get_label());
+}
@@ -30,15 +30,43 @@
 
 class Condition;
 
+// Transmissible people shed into a reservoir in each place they attend.
+// The load decays and is ventilated each hour, and susceptible people
+// present in a contaminated place are exposed in proportion to its
+// concentration: the load divided by the volume of the place type, or by
+// the number of members of the place if no volume is given.
+// The reservoirs are kept in one array per place type, indexed by the
+// index of the place within its type.
+
 class Environmental_Transmission: public Transmission {
 
 public:
-  Environmental_Transmission() {}
+  Environmental_Transmission();
   ~Environmental_Transmission() {}
   void setup(Condition* condition);
-  void transmission(int day, int hour, int condition_id, Group* group, int time_block) {}
+  void prepare();
+  void transmission(int day, int hour, int condition_id, Group* group, int time_block);
+  void update_reservoirs(int day, int hour, int place_type_id);
+  place_vector_t* get_contaminated_places(int place_type_id) {
+    return &(this->contaminated[place_type_id]);
+  }
+  double get_load(Place* place);
 
 private:
+  Condition* condition;
+  double shedding_rate;		// load shed per hour by a transmissible person
+  double decay_rate;		// fraction of the load inactivated per hour
+  double uptake_rate;		// exposure hazard per unit concentration per hour
+  double min_load;		// smaller loads are cleared
+  double_vector_t ventilation_rate; // fraction removed per hour, by place type
+  double_vector_t volume;	// dilution volume by place type, or 0 for size
+
+  // reservoirs by place type and place index
+  std::vector<double_vector_t> load;
+  std::vector<int_vector_t> condition_to_transmit;
+  std::vector<place_vector_t> contaminated;
+  int_vector_t last_update_step;
+  std::vector<bool> has_load;
 };
 
 #endif // _FRED_ENVIRONMENTAL_TRANSMISSION_H
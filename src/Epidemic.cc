@@ -33,8 +33,11 @@
 
 using namespace std;
 
+#include "Admin_Division.h"
+#include "Compressed_Stream.h"
 #include "Condition.h"
 #include "Date.h"
+#include "Environmental_Transmission.h"
 #include "Epidemic.h"
 #include "Events.h"
 #include "Expression.h"
@@ -63,6 +66,9 @@ using namespace std;
  * specific Epidemic Model and return a pointer to it.
  */
 
+thread_local std::vector<RNG*> Epidemic::keyed_rng;
+thread_local int Epidemic::update_depth = 0;
+
 Epidemic* Epidemic::get_epidemic(Condition* condition) {
   return new Epidemic(condition);
 }
@@ -100,8 +106,10 @@ Epidemic::Epidemic(Condition* _condition) {
   this->new_exposed_people_list.clear();
   this->active_people_list.clear();
   this->transmissible_people_list.clear();
-  this->group_state_count.clear();
-  this->total_group_state_count.clear();
+  this->group_state_counter = NULL;
+  this->track_counts_for_group_state = NULL;
+  this->tracked_group_types = NULL;
+  this->dense_group_state_count_limit = 10000000;
   this->susceptible_count = 0;
 
   this->vis_case_fatality_loc_list.clear();
@@ -109,8 +117,15 @@ Epidemic::Epidemic(Condition* _condition) {
 }
 
 Epidemic::~Epidemic() {
-  this->group_state_count.clear();
-  this->total_group_state_count.clear();
+  if (this->group_state_counter != NULL) {
+    for (int state = 0; state < this->number_of_states; state++) {
+      delete[] this->group_state_counter[state];
+      delete[] this->track_counts_for_group_state[state];
+    }
+    delete[] this->group_state_counter;
+    delete[] this->track_counts_for_group_state;
+    delete[] this->tracked_group_types;
+  }
 }
 
 //////////////////////////////////////////////////////
@@ -133,24 +148,28 @@ void Epidemic::setup() {
   Property::get_property(this->name, "enable_health_records", &temp);
   this->enable_health_records = temp;
 
+  // group types with more groups than this use sparse group state counters
+  Property::get_property(this->name, "dense_group_state_count_limit", &this->dense_group_state_count_limit);
+
+  // admin levels with dense state counters, e.g. "county census_tract"
+  this->admin_state_count_levels.clear();
+  string levels = "";
+  Property::get_property(this->name, "admin_state_counts", &levels);
+  string_vector_t level_vec = Utils::get_string_vector(levels, ' ');
+  for (int i = 0; i < level_vec.size(); i++) {
+    int level = Admin_Division::get_admin_level(level_vec[i].c_str());
+    if (level < 0) {
+      Utils::fred_abort("Unknown admin level %s in %s.admin_state_counts\n", level_vec[i].c_str(), this->name);
+    }
+    this->admin_state_count_levels.push_back(level);
+  }
+
   // initialize state specific-variables here:
   this->natural_history = this->condition->get_natural_history();
 
   this->number_of_states = this->natural_history->get_number_of_states();
   // FRED_VERBOSE(0, "Epidemic::setup states = %d\n", this->number_of_states);
 
-  //vectors of group state counts, size to number of states
-  this->group_state_count.reserve(this->number_of_states);
-  for (int i=0; i < this->number_of_states; i++) {
-    group_counter_t new_counter;
-    this->group_state_count.push_back(new_counter);
-  }
-  this->total_group_state_count.reserve(this->number_of_states);
-  for (int i=0; i < this->number_of_states; i++) {
-    group_counter_t new_counter;
-    this->total_group_state_count.push_back(new_counter);
-  }
-
   // initialize state counters
   this->incidence_count = new int [this->number_of_states];
   this->total_count = new int [this->number_of_states];
@@ -234,12 +253,37 @@ void Epidemic::setup() {
 
 void Epidemic::prepare_to_track_counts() {
   this->track_counts_for_group_state = new bool* [this->number_of_states];
+  this->group_state_counter = new group_state_counter_t* [this->number_of_states];
+  this->tracked_group_types = new int_vector_t [this->number_of_states];
   int number_of_group_types = Group_Type::get_number_of_group_types();
+  int number_of_place_types = Place_Type::get_number_of_place_types();
   for (int state = 0; state < this->number_of_states; state++) {
     this->track_counts_for_group_state[state] = new bool [number_of_group_types];
+    this->group_state_counter[state] = new group_state_counter_t [number_of_group_types];
     for (int type = 0; type < number_of_group_types; type++) {
       this->track_counts_for_group_state[state][type] = false;
+      // places have an index within their type; networks do not
+      group_state_counter_t* counter = &(this->group_state_counter[state][type]);
+      counter->is_dense = (type < number_of_place_types &&
+			   Place_Type::get_place_type(type)->get_number_of_places() <= this->dense_group_state_count_limit);
+    }
+    this->tracked_group_types[state].clear();
+  }
+
+  // the admin divisions are known once the households are set up
+  this->admin_state_counter.clear();
+  for (int i = 0; i < this->admin_state_count_levels.size(); i++) {
+    admin_state_counter_t counter;
+    counter.level = this->admin_state_count_levels[i];
+    counter.divisions = Admin_Division::get_number_of_admin_divisions(counter.level);
+    int size = (Global::Simulation_Days + 1) * counter.divisions * this->number_of_states;
+    counter.daily_incidence = new int [size];
+    counter.daily_current = new int [size];
+    for (int k = 0; k < size; k++) {
+      counter.daily_incidence[k] = 0;
+      counter.daily_current[k] = 0;
     }
+    this->admin_state_counter.push_back(counter);
   }
 }
 
@@ -388,6 +432,10 @@ void Epidemic::update(int day, int hour) {
     if (strcmp(this->condition->get_transmission_mode(), "network")==0) {
       update_network_transmissions(day, hour);
     }
+
+    if (strcmp(this->condition->get_transmission_mode(), "environmental")==0) {
+      update_environmental_transmissions(day, hour);
+    }
   }
 
   // FRED_VERBOSE(0, "epidemic update finished for condition %d day %d\n", id, day);
@@ -489,6 +537,32 @@ void Epidemic::update_network_transmissions(int day, int hour) {
 }
 
 
+void Epidemic::update_environmental_transmissions(int day, int hour) {
+
+  // transmissible people shed into the places they attend, and people in
+  // contaminated places are exposed even if no one transmissible is there
+
+  Environmental_Transmission* environment = static_cast<Environmental_Transmission*>(this->condition->get_transmission());
+  int number_of_place_types = Place_Type::get_number_of_place_types();
+  for(int type = 0; type < number_of_place_types; ++type) {
+    environment->update_reservoirs(day, hour, type);
+    Place_Type* place_type = Place_Type::get_place_type(type);
+    int time_block = place_type->get_time_block(day, hour);
+    if (time_block > 0) {
+      find_active_places_of_type(day, hour, type);
+      place_vector_t* contaminated = environment->get_contaminated_places(type);
+      for (int i = 0; i < contaminated->size(); i++) {
+	Place* place = (*contaminated)[i];
+	if (place->has_admin_closure() == false) {
+	  this->active_places_list.insert(place);
+	}
+      }
+      transmission_in_active_places(day, hour, time_block);
+    }
+  }
+}
+
+
 void Epidemic::prepare_for_new_day(int day) {
 
   FRED_VERBOSE(1, "epidemic %s prepare for new day %d\n", this->name, day);
@@ -627,6 +701,7 @@ void Epidemic::terminate_person(Person* person, int day) {
   if (0 <= state && this->natural_history->is_fatal_state(state)==false) {
     current_count[state]--;
     daily_current_count[state][day]--;
+    update_admin_state_count(person, day, state, -1);
     FRED_VERBOSE(1, "EPIDEMIC TERMINATE person %d day %d %s removed from state %d\n",
 		 person->get_id(), day, Date::get_date_string().c_str(), state);
   }
@@ -685,6 +760,11 @@ void Epidemic::print_stats(int day) {
       this->incidence_count[i] = 0;
       this->daily_current_count[i][day+1] = this->daily_current_count[i][day];
     }
+    for (int i = 0; i < this->admin_state_counter.size(); ++i) {
+      admin_state_counter_t* counter = &(this->admin_state_counter[i]);
+      int size = counter->divisions * this->number_of_states;
+      memcpy(counter->daily_current + (day+1) * size, counter->daily_current + day * size, size * sizeof(int));
+    }
   }
 
   FRED_VERBOSE(1, "epidemic finished print stats for condition %d day %d\n", id, day);
@@ -771,13 +851,13 @@ void Epidemic::print_visualization_data(int day) {
 	      this->name,
 	      this->natural_history->get_state_name(i).c_str(),
 	      day);
-      newstatefp[i] = fopen(filename, "w");
+      newstatefp[i] = Compressed_Stream::open_for_writing(filename, Global::Visualization_Compression);
       sprintf(filename, "%s/%s.%s/loc-%d.txt",
 	      Global::Visualization_directory,
 	      this->name,
 	      this->natural_history->get_state_name(i).c_str(),
 	      day);
-      statefp[i] = fopen(filename, "w");
+      statefp[i] = Compressed_Stream::open_for_writing(filename, Global::Visualization_Compression);
     }
   }
 
@@ -839,11 +919,13 @@ void Epidemic::print_visualization_data(int day) {
 
   // close file pointers for each state
   for (int i = 0; i < this->number_of_states; i++) {
-    if (statefp[i] != NULL) {
-      fclose(statefp[i]);
+    if (statefp[i] != NULL && fclose(statefp[i]) != 0) {
+      Utils::fred_abort("Help! visualization file for %s.%s could not be written\n",
+			this->name, this->natural_history->get_state_name(i).c_str());
     }
-    if (newstatefp[i] != NULL) {
-      fclose(newstatefp[i]);
+    if (newstatefp[i] != NULL && fclose(newstatefp[i]) != 0) {
+      Utils::fred_abort("Help! visualization file for %s.new%s could not be written\n",
+			this->name, this->natural_history->get_state_name(i).c_str());
     }
   }
 
@@ -877,6 +959,21 @@ void Epidemic::update_state(Person* person, int day, int hour, int new_state, in
   int step = 24*day + hour;
   int old_state = person->get_state(this->id);
 
+  // under common random numbers, the draws of this call come from a
+  // stream keyed by the person, the step, the state requested and the
+  // depth of nested calls, so they do not depend on earlier draws
+  RNG* previous_stream = NULL;
+  if (Global::Enable_Common_Random_Numbers) {
+    if (Epidemic::update_depth == (int) Epidemic::keyed_rng.size()) {
+      Epidemic::keyed_rng.push_back(new RNG);
+    }
+    RNG* rng = Epidemic::keyed_rng[Epidemic::update_depth];
+    Random::set_key(rng, RANDOM_SITE_TRANSITION, person->get_id(), this->id, step, new_state, Epidemic::update_depth);
+    Epidemic::update_depth++;
+    previous_stream = Random::get_stream();
+    Random::use_stream(rng);
+  }
+
   double age = person->get_real_age();
 
   FRED_VERBOSE(1, "UPDATE_STATE ENTERED condition %s day %d hour %d person %d age %0.2f old_state %s new_state %s\n", 
@@ -1005,6 +1102,7 @@ void Epidemic::update_state(Person* person, int day, int hour, int new_state, in
       inc_state_count(person, new_state);
       // FRED_VERBOSE(0, "Modified counters for new_state %d\n", new_state);
     }
+    update_admin_state_count(person, day, old_state, new_state);
 
     // note: person's health state is still old_state
 
@@ -1098,7 +1196,7 @@ void Epidemic::update_state(Person* person, int day, int hour, int new_state, in
   bool was_transmissible = person->is_transmissible(this->id);
 
   // action rules
-  person->run_action_rules(this->id, new_state, this->natural_history->get_action_rules(new_state));
+  person->run_action_rules(this->id, new_state, this->natural_history->get_action_plan(new_state));
 
   // new status
   bool is_now_susceptible = person->is_susceptible(this->id);
@@ -1159,6 +1257,10 @@ void Epidemic::update_state(Person* person, int day, int hour, int new_state, in
     }
   }
 
+  if (Global::Enable_Common_Random_Numbers) {
+    Epidemic::update_depth--;
+    Random::use_stream(previous_stream);
+  }
 }
 
 void Epidemic::finish() {
@@ -1215,6 +1317,11 @@ void Epidemic::finish() {
     fclose(fp);
   }
 
+  // dense admin state counts
+  for (int i = 0; i < this->admin_state_counter.size(); i++) {
+    write_admin_state_counts(&(this->admin_state_counter[i]));
+  }
+
   // reproductive rate
   sprintf(outfile, "%s/%s.RR.txt",
 	  dir,
@@ -1300,63 +1407,189 @@ double Epidemic::get_attack_rate() {
 }
 
 void Epidemic::inc_state_count(Person* person, int state){
-
-  for (int type_id = 0; type_id < Group_Type::get_number_of_group_types(); type_id++) {
-    if (this->track_counts_for_group_state[state][type_id]) {
-      Group* group = person->get_group_of_type(type_id);
-      if (group != NULL) {
-	if ( this->group_state_count[state].find(group) == this->group_state_count[state].end() ) {
-	  // not present so insert with count of one
-	  std::pair<Group*,int> new_count(group,1);
-	  this->group_state_count[state].insert(new_count);
-	  this->total_group_state_count[state].insert(new_count);
-	}
-	else { // present so increment count
-	  this->group_state_count[state][group]++;
-	  this->total_group_state_count[state][group]++;
-	}  
-	FRED_VERBOSE(1, "inc_state_count person %d group %s cond %s state %s count %d total_count %d\n",
-		     person->get_id(), group->get_label(), this->name,
-		     this->natural_history->get_state_name(state).c_str(),
-		     this->group_state_count[state][group],
-		     this->total_group_state_count[state][group]); 
-      }
+  int types = this->tracked_group_types[state].size();
+  for (int i = 0; i < types; i++) {
+    int type_id = this->tracked_group_types[state][i];
+    Group* group = person->get_group_of_type(type_id);
+    if (group != NULL) {
+      add_to_group_state_count(&(this->group_state_counter[state][group->get_type_id()]), group);
+      FRED_VERBOSE(1, "inc_state_count person %d group %s cond %s state %s count %d total_count %d\n",
+		   person->get_id(), group->get_label(), this->name,
+		   this->natural_history->get_state_name(state).c_str(),
+		   get_group_state_count(group, state),
+		   get_total_group_state_count(group, state));
     }
   }
 }
 
 void Epidemic::dec_state_count(Person* person, int state){
-  for (int type_id = 0; type_id < Group_Type::get_number_of_group_types(); type_id++) {
-    if (this->track_counts_for_group_state[state][type_id]) {
-      Group* group = person->get_group_of_type(type_id);
-      if (group != NULL) {
-	if ( this->group_state_count[state].find(group) != this->group_state_count[state].end() ) {
-	  this->group_state_count[state][group]--;
-	  FRED_VERBOSE(1, "dec_state_count person %d group %s cond %s state %s count %d\n",
-		       person->get_id(), group->get_label(), this->name,
-		       this->natural_history->get_state_name(state).c_str(),
-		       this->group_state_count[state][group]); 
-	}  
-      }
+  int types = this->tracked_group_types[state].size();
+  for (int i = 0; i < types; i++) {
+    int type_id = this->tracked_group_types[state][i];
+    Group* group = person->get_group_of_type(type_id);
+    if (group != NULL) {
+      remove_from_group_state_count(&(this->group_state_counter[state][group->get_type_id()]), group);
+      FRED_VERBOSE(1, "dec_state_count person %d group %s cond %s state %s count %d\n",
+		   person->get_id(), group->get_label(), this->name,
+		   this->natural_history->get_state_name(state).c_str(),
+		   get_group_state_count(group, state));
+    }
+  }
+}
+
+
+// The old state is removed from the divisions it was counted in, which
+// the person records on entering a state, since the person may have
+// moved or be traveling since then. The new state is counted in the
+// divisions of the current household.
+
+void Epidemic::update_admin_state_count(Person* person, int day, int old_state, int new_state) {
+  if (this->admin_state_counter.empty()) {
+    return;
+  }
+  int counted = person->get_counted_household(this->id);
+  if (0 <= old_state && 0 <= counted) {
+    add_admin_state_count(Place::get_household(counted), day, old_state, -1, false);
+  }
+  Household* household = (0 <= new_state) ? person->get_household() : NULL;
+  person->set_counted_household(this->id, household != NULL ? household->get_index() : -1);
+  if (household != NULL) {
+    add_admin_state_count(household, day, new_state, 1, true);
+  }
+}
+
+// called when the person changes household: the current state is now
+// counted in the divisions of the new household
+void Epidemic::move_admin_state_count(Person* person, int day) {
+  if (this->admin_state_counter.empty()) {
+    return;
+  }
+  int state = person->get_state(this->id);
+  Household* household = person->get_household();
+  int counted = person->get_counted_household(this->id);
+  if (state < 0 || household == NULL || household->get_index() == counted) {
+    return;
+  }
+  if (0 <= counted) {
+    add_admin_state_count(Place::get_household(counted), day, state, -1, false);
+  }
+  add_admin_state_count(household, day, state, 1, false);
+  person->set_counted_household(this->id, household->get_index());
+}
+
+void Epidemic::add_admin_state_count(Household* household, int day, int state, int delta, bool entered) {
+  int states = this->number_of_states;
+  for (int i = 0; i < this->admin_state_counter.size(); i++) {
+    admin_state_counter_t* counter = &(this->admin_state_counter[i]);
+    int division = household->get_admin_division_index(counter->level);
+    if (division < 0) {
+      continue;
+    }
+    int offset = (day * counter->divisions + division) * states;
+    counter->daily_current[offset + state] += delta;
+    if (entered) {
+      counter->daily_incidence[offset + state] += delta;
     }
   }
 }
 
+// write RUN<n>/<condition>.<level>.csv, with one row for each day and
+// admin division and the new, current and total counts of each state
+void Epidemic::write_admin_state_counts(admin_state_counter_t* counter) {
+  char outfile[FRED_STRING_SIZE];
+  sprintf(outfile, "%s/RUN%d/%s.%s.csv",
+	  Global::Simulation_directory,
+	  Global::Simulation_run_number,
+	  this->name,
+	  Admin_Division::get_admin_level_name(counter->level));
+  FILE* fp = fopen(outfile, "w");
+  if (fp == NULL) {
+    Utils::fred_abort("Fred: can open file %s\n", outfile);
+  }
+  fprintf(fp, "Day,AdminCode");
+  for (int i = 0; i < this->number_of_states; i++) {
+    string state = this->natural_history->get_state_name(i);
+    fprintf(fp, ",%s.new%s,%s.%s,%s.tot%s", this->name, state.c_str(), this->name, state.c_str(), this->name, state.c_str());
+  }
+  fprintf(fp, "\n");
+
+  int states = this->number_of_states;
+  int_vector_t total(counter->divisions * states, 0);
+  for (int day = 0; day < Global::Simulation_Days; day++) {
+    for (int d = 0; d < counter->divisions; d++) {
+      int offset = (day * counter->divisions + d) * states;
+      fprintf(fp, "%d,%lld", day, Admin_Division::get_admin_division_with_index(counter->level, d)->get_admin_division_code());
+      for (int i = 0; i < states; i++) {
+	total[d * states + i] += counter->daily_incidence[offset + i];
+	fprintf(fp, ",%d,%d,%d", counter->daily_incidence[offset + i], counter->daily_current[offset + i], total[d * states + i]);
+      }
+      fprintf(fp, "\n");
+    }
+  }
+  fclose(fp);
+}
 
 int Epidemic::get_group_state_count(Group* place, int state) {
-  int count = 0;
-  if( this->group_state_count[state].find(place) != this->group_state_count[state].end() ){
-    count = this->group_state_count[state][place];
+  if (place == NULL || this->group_state_counter == NULL) {
+    return 0;
+  }
+  group_state_counter_t* counter = &(this->group_state_counter[state][place->get_type_id()]);
+  int index = place->get_index();
+  if (counter->is_dense && 0 <= index) {
+    return index < counter->current.size() ? counter->current[index] : 0;
   }
-  return count;
+  group_counter_t::const_iterator found = counter->sparse_current.find(place);
+  return found != counter->sparse_current.end() ? found->second : 0;
 }
 
 int Epidemic::get_total_group_state_count(Group* place, int state) {
-  int count = 0;
-  if( this->total_group_state_count[state].find(place) != this->total_group_state_count[state].end() ){
-    count = this->total_group_state_count[state][place];
+  if (place == NULL || this->group_state_counter == NULL) {
+    return 0;
+  }
+  group_state_counter_t* counter = &(this->group_state_counter[state][place->get_type_id()]);
+  int index = place->get_index();
+  if (counter->is_dense && 0 <= index) {
+    return index < counter->total.size() ? counter->total[index] : 0;
+  }
+  group_counter_t::const_iterator found = counter->sparse_total.find(place);
+  return found != counter->sparse_total.end() ? found->second : 0;
+}
+
+void Epidemic::add_to_group_state_count(group_state_counter_t* counter, Group* group) {
+  int index = group->get_index();
+  if (counter->is_dense && 0 <= index) {
+    if (index >= counter->current.size()) {
+      // grow to cover all places of this type, including newly generated ones
+      int size = Place_Type::get_place_type(group->get_type_id())->get_number_of_places();
+      if (size <= index) {
+	size = index + 1;
+      }
+      counter->current.resize(size, 0);
+      counter->total.resize(size, 0);
+    }
+    counter->current[index]++;
+    counter->total[index]++;
+  }
+  else {
+    counter->sparse_current[group]++;
+    counter->sparse_total[group]++;
+  }
+}
+
+void Epidemic::remove_from_group_state_count(group_state_counter_t* counter, Group* group) {
+  // only groups that have been counted before are decremented
+  int index = group->get_index();
+  if (counter->is_dense && 0 <= index) {
+    if (index < counter->total.size() && counter->total[index] > 0) {
+      counter->current[index]--;
+    }
+  }
+  else {
+    group_counter_t::iterator found = counter->sparse_current.find(group);
+    if (found != counter->sparse_current.end()) {
+      found->second--;
+    }
   }
-  return count;
 }
 
 
@@ -1399,6 +1632,9 @@ void Epidemic::select_imported_cases(int day, int max_imported, double per_cap,
   int hour = Global::Simulation_Hour;
   hour = 0;
 
+  // under common random numbers, these draws come from the keyed stream
+  // of the import agent's update_state() call that requested them
+
   // number imported so far
   int imported_cases = 0;
 
@@ -1594,52 +1830,32 @@ void Epidemic::select_imported_cases(int day, int max_imported, double per_cap,
 
 
 void Epidemic::increment_group_state_count(int group_type_id, Group* group, int state) {
+  if (state < 0 || group_type_id < 0) {
+    return;
+  }
   if (this->track_counts_for_group_state[state][group_type_id]) {
     if (group != NULL) {
-      if ( this->group_state_count[state].find(group) == this->group_state_count[state].end() ) {
-	// not present so insert with count of one
-	std::pair<Group*,int> new_count(group,1);
-	this->group_state_count[state].insert(new_count);
-	this->total_group_state_count[state].insert(new_count);
-      }
-      else { // present so increment count
-	this->group_state_count[state][group]++;
-	this->total_group_state_count[state][group]++;
-      }  
+      add_to_group_state_count(&(this->group_state_counter[state][group->get_type_id()]), group);
       FRED_VERBOSE(1, "increment_group_state_count group %s cond %s state %s count %d total_count %d\n",
 		   group->get_label(), this->name,
 		   this->natural_history->get_state_name(state).c_str(),
-		   this->group_state_count[state][group],
-		   this->total_group_state_count[state][group]); 
+		   get_group_state_count(group, state),
+		   get_total_group_state_count(group, state));
     }
   }
 }
 
 void Epidemic::decrement_group_state_count(int group_type_id, Group* group, int state) {
+  if (state < 0 || group_type_id < 0) {
+    return;
+  }
   if (this->track_counts_for_group_state[state][group_type_id]) {
     if (group != NULL) {
-      /*
-	printf("decrementing_group_state_count for cond %d state %d group %s\n",
-	this->id, state, group->get_label());
-      */
-      if ( this->group_state_count[state].find(group) != this->group_state_count[state].end() ) {
-	/*
-	if (this->group_state_count[state][group]<1) {
-	  printf("HELP: decrementing_group_state_count for cond %d state %d group %s would result in negative count\n",
-		 this->id, state, group->get_label());
-	  exit(0);
-	}
-	*/
-	this->group_state_count[state][group]--;
-	/*
-	printf("decrementing_group_state_count for cond %d state %d group %s ==> %d\n",
-	       this->id, state, group->get_label(), this->group_state_count[state][group]);
-	*/
-	FRED_VERBOSE(1, "decrement_group_state_count group %s cond %s state %s count = %d\n",
-		     group->get_label(), this->name,
-		     this->natural_history->get_state_name(state).c_str(),
-		     this->group_state_count[state][group]); 
-      }  
+      remove_from_group_state_count(&(this->group_state_counter[state][group->get_type_id()]), group);
+      FRED_VERBOSE(1, "decrement_group_state_count group %s cond %s state %s count = %d\n",
+		   group->get_label(), this->name,
+		   this->natural_history->get_state_name(state).c_str(),
+		   get_group_state_count(group, state));
     }
   }
 }
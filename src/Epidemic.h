@@ -33,8 +33,10 @@
 #include "Place.h"
 
 class Group;
+class Household;
 class Condition;
 class Natural_History;
+class RNG;
 
 struct person_id_compare {
   bool operator()(const Person* x, const Person* y) const {
@@ -56,6 +58,27 @@ typedef  place_set_t::iterator place_set_iterator;
 
 typedef std::unordered_map<Group*,int> group_counter_t;
 
+// counts of the people in one state for each group of one group type.
+// Groups with an index (places) are counted in flat arrays indexed by
+// the group's index; groups without an index (networks) and group types
+// larger than the dense limit use the sparse maps instead.
+typedef struct {
+  bool is_dense;
+  int_vector_t current;
+  int_vector_t total;
+  group_counter_t sparse_current;
+  group_counter_t sparse_total;
+} group_state_counter_t;
+
+// counts of the people in each state for each admin division of one
+// level, kept for every day of the run in flat arrays indexed by
+// [day][division][state]
+typedef struct {
+  int level;
+  int divisions;
+  int* daily_incidence;
+  int* daily_current;
+} admin_state_counter_t;
 
 
 class VIS_Location {
@@ -106,6 +129,10 @@ public:
   void inactivate(Person* person, int day, int hour);
 
   void update(int day, int hour);
+  bool has_events(int step) {
+    return (this->state_transition_event_queue.get_size(step) > 0 ||
+	    this->meta_agent_transition_event_queue.get_size(step) > 0);
+  }
   void prepare_for_new_day(int day);
   void update_state(Person* person, int day, int hour, int new_state, int loop_counter);
 
@@ -115,6 +142,8 @@ public:
 
   void update_network_transmissions(int day, int hour);
 
+  void update_environmental_transmissions(int day, int hour);
+
   int get_number_of_transmissible_people() {
     return this->transmissible_people_list.size();
   }
@@ -155,7 +184,10 @@ public:
       return;
     }
     if (type_id < Group_Type::get_number_of_group_types()) {
-      this->track_counts_for_group_state[state][type_id] = true;
+      if (this->track_counts_for_group_state[state][type_id] == false) {
+	this->track_counts_for_group_state[state][type_id] = true;
+	this->tracked_group_types[state].push_back(type_id);
+      }
     }
   }
   void increment_group_state_count(int place_type_id, Group* group, int state);
@@ -170,8 +202,15 @@ public:
 
   void finish();
   void terminate_person(Person* person, int day);
+  void move_admin_state_count(Person* person, int day);
 
 protected:
+  void add_to_group_state_count(group_state_counter_t* counter, Group* group);
+  void remove_from_group_state_count(group_state_counter_t* counter, Group* group);
+  void update_admin_state_count(Person* person, int day, int old_state, int new_state);
+  void add_admin_state_count(Household* household, int day, int state, int delta, bool entered);
+  void write_admin_state_counts(admin_state_counter_t* counter);
+
   Condition* condition;
   char name[FRED_STRING_SIZE];
   int id;
@@ -216,9 +255,12 @@ protected:
   int* current_count;	  // number of people currently in state
   int** daily_incidence_count; // number of people entering state each day
   int** daily_current_count;	// number of people currently in state each day
-  std::vector<group_counter_t> group_state_count;
-  std::vector<group_counter_t> total_group_state_count;
+  group_state_counter_t** group_state_counter; // [state][group_type]
   bool** track_counts_for_group_state;
+  int_vector_t* tracked_group_types; // group types tracked for each state
+  int dense_group_state_count_limit;
+  int_vector_t admin_state_count_levels;
+  std::vector<admin_state_counter_t> admin_state_counter;
 
   // used for computing reproductive rate:
   double RR;
@@ -243,6 +285,11 @@ protected:
   // networks that support transmission of this condition
   network_vector_t transmissible_networks;
 
+  // keyed generators used by update_state() under common random
+  // numbers, one for each level of nested calls in the thread
+  static thread_local std::vector<RNG*> keyed_rng;
+  static thread_local int update_depth;
+
 };
 
 #endif // _FRED_EPIDEMIC_H
@@ -32,6 +32,18 @@
 
 #define TWOARGS 11
 
+// reusable per-thread buffers for intermediate lists, taken and released
+// in LIFO order as nested list expressions are evaluated
+thread_local std::vector<double_vector_t*> Expression::list_buffers;
+thread_local int Expression::list_buffers_in_use = 0;
+thread_local std::vector<person_vector_t*> Expression::person_buffers;
+thread_local int Expression::person_buffers_in_use = 0;
+
+// per-thread marks for removing duplicate ids: an id has been seen in the
+// current pass if its mark equals the pass's epoch
+thread_local std::vector<unsigned int> Expression::id_mark;
+thread_local unsigned int Expression::id_epoch = 0;
+
 std::map<std::string,int> Expression::op_map = {
   {"add", 1}, {"sub", 2}, {"mult", 3}, {"div", 4}, {"dist", 5}, {"equal", 6},
   {"min", 7}, {"max", 8}, {"uniform", 9}, {"normal", 10}, {"lognormal", 11},
@@ -683,44 +695,32 @@ double Expression::get_value(Person* person, Person* other) {
     // this is a select expression
     // FRED_VERBOSE(0, "get_value selection entered for person %d |%s|\n", person->get_id(), this->name.c_str());
 
-    double_vector_t id_vec = this->expr1->get_list_value(person, other);
-    int size = id_vec.size();
-    // FRED_VERBOSE(0, "get_value selection for person %d size %d\n", person->get_id(), size);
-    if (0) {
-      for (int i=0; i < size; i++) {
-	printf("%d %f\n", i, id_vec[i]);
-      }
-    }
+    double_vector_t* id_vec = Expression::get_list_buffer();
+    this->expr1->get_list_value(person, other, id_vec);
+    int size = id_vec->size();
+    double value = -99999999;
 
     if (this->preference == NULL ) {
       //this is a select-by-index expression
-      // FRED_VERBOSE(0, "get_value selection select-by-index for person %d size %d\n", person->get_id(), size);
       int index = this->expr2->get_value(person,other);
       if (index < size) {
-	// FRED_VERBOSE(0, "get_value selection select-by-index for person %d index %d other_id %d\n", person->get_id(), index, (int)id_vec[index]);
-	return id_vec[index];
-      }
-      else {
-	// FRED_VERBOSE(0, "get_value selection select-by-index for person %d other_id %d\n", person->get_id(), -999999);
-	return -99999999;
+	value = (*id_vec)[index];
       }
     }
     else {
       // this is a select by preference expression
-      // FRED_VERBOSE(0, "get_value selection select-by-pref for person %d size %d\n", person->get_id(), size);
-      person_vector_t people;
-      people.clear();
+      person_vector_t* people = Expression::get_person_buffer();
       for (int i = 0; i < size; i++) {
-	people.push_back(Person::get_person_with_id(id_vec[i]));
+	people->push_back(Person::get_person_with_id((*id_vec)[i]));
       }
-      Person* selected = this->preference->select_person(person,people);
+      Person* selected = this->preference->select_person(person, *people);
       if (selected!=NULL) {
-	return selected->get_id();
-      }
-      else {
-	return -99999999;
+	value = selected->get_id();
       }
+      Expression::release_person_buffer();
     }
+    Expression::release_list_buffer();
+    return value;
   }
 
   if (this->number_of_expressions == 0) {
@@ -850,6 +850,80 @@ double Expression::get_value(Person* person, Person* other) {
   
 
 
+int Expression::get_covariates() {
+
+  // lists, selections, other agents and random draws vary from one
+  // evaluation to the next
+  if (this->is_value || this->is_distance || this->is_select || this->use_other
+      || this->is_list_expr || this->is_list_var || this->is_global
+      || this->is_pool || this->is_filter || this->is_list) {
+    return Covariate::DYNAMIC;
+  }
+
+  if (this->number_of_expressions == 0) {
+    if (this->factor != NULL) {
+      return this->factor->get_covariates();
+    }
+    return Covariate::NONE;
+  }
+
+  switch(this->op_index) {
+  case 5:
+  case 9:
+  case 10:
+  case 11:
+  case 12:
+  case 13:
+    return Covariate::DYNAMIC;
+  }
+
+  int covariates = this->expr1->get_covariates();
+  if (this->number_of_expressions == 2) {
+    covariates |= this->expr2->get_covariates();
+  }
+  return covariates;
+}
+
+int Expression::get_other_covariates() {
+
+  // the covariates of the other agent on which the value depends. Values
+  // of the agent itself are fixed while the other agent varies, unless
+  // they are dynamic.
+  if (this->is_value || this->is_distance || this->is_select
+      || this->is_list_expr || this->is_list_var || this->is_global
+      || this->is_pool || this->is_filter || this->is_list) {
+    return Covariate::DYNAMIC;
+  }
+
+  if (this->number_of_expressions == 0) {
+    if (this->factor != NULL) {
+      int covariates = this->factor->get_covariates();
+      if (this->use_other) {
+	return covariates;
+      }
+      return covariates & Covariate::DYNAMIC;
+    }
+    return Covariate::NONE;
+  }
+
+  switch(this->op_index) {
+  case 5:
+  case 9:
+  case 10:
+  case 11:
+  case 12:
+  case 13:
+    return Covariate::DYNAMIC;
+  }
+
+  int covariates = this->expr1->get_other_covariates();
+  if (this->number_of_expressions == 2) {
+    covariates |= this->expr2->get_other_covariates();
+  }
+  return covariates;
+}
+
+
 bool Expression::parse() {
 
   // printf("EXPRESSION: parsing expression |%s|\n", this->name.c_str()); fflush(stdout);
@@ -1160,149 +1234,152 @@ bool Expression::parse() {
 
 double_vector_t Expression::get_list_value(Person* person, Person* other) {
   double_vector_t results;
-  results.clear();
+  get_list_value(person, other, &results);
+  return results;
+}
 
-  // FRED_VERBOSE(0, "get_list_value : |%s|: person %d\n", this->name.c_str(), person->get_id());
+void Expression::get_list_value(Person* person, Person* other, double_vector_t* results) {
+
+  // the values of this list expression are appended to results
 
   FRED_VERBOSE(1, "get_list_value person %d other %d list_var %d is_pool %d is_filter %d use_other %d\n",
 	       person->get_id(), other? other->get_id(): -999,
 	       this->is_list_var, this->is_pool, this->is_filter, this->use_other);
 
   if (this->is_list) {
-    // FRED_VERBOSE(0, "get_list_value : |%s|: person %d\n", this->name.c_str(), person->get_id());
-    double_vector_t list1;    
-    double_vector_t list2;    
-    list1.clear();
     if (this->expr1->is_list_expression()) {
-      // FRED_VERBOSE(0, "get_list_value : |%s|: person %d expr1 is list expr\n", this->name.c_str(), person->get_id());
-      list1 = this->expr1->get_list_value(person,other);
+      this->expr1->get_list_value(person, other, results);
     }
     else {
-      // FRED_VERBOSE(0, "get_list_value : |%s|: person %d expr1 is value expr\n", this->name.c_str(), person->get_id());
-      list1.push_back(this->expr1->get_value(person,other));
+      results->push_back(this->expr1->get_value(person,other));
     }
-    int size1 = list1.size();
-    // FRED_VERBOSE(0, "get_list_value : |%s|: person %d expr1 has size %d\n", this->name.c_str(), person->get_id(), size1);
-
-    list2.clear();
     if (this->expr2 != NULL) {
       if (this->expr2->is_list_expression()) {
-	// FRED_VERBOSE(0, "get_list_value : |%s|: person %d expr2 is list expr\n", this->name.c_str(), person->get_id());
-	list2 = this->expr2->get_list_value(person,other);
+	this->expr2->get_list_value(person, other, results);
       }
       else {
-	// FRED_VERBOSE(0, "get_list_value : |%s|: person %d expr2 is value expr\n", this->name.c_str(), person->get_id());
-	list2.push_back(this->expr2->get_value(person,other));
+	results->push_back(this->expr2->get_value(person,other));
       }
     }
-    int size2 = list2.size();
-    // FRED_VERBOSE(0, "get_list_value : |%s|: person %d expr2 has size %d\n", this->name.c_str(), person->get_id(), size2);
-
-    for (int i = 0; i < size2; i++) {
-      list1.push_back(list2[i]);
-    }
-    int size = list1.size();
-    // FRED_VERBOSE(0, "get_list_value : |%s|: person %d result list has size %d\n", this->name.c_str(), person->get_id(), size1);
-    return list1;
+    return;
   }
 
   if (this->is_list_var) {
-    // FRED_VERBOSE(0, "get_list_value : |%s|: person %d  is_list_var is_global %d\n", this->name.c_str(), person->get_id(), this->is_global);
+    Person* owner = this->use_other ? other : person;
     if (this->is_global) {
-      if (this->use_other) {
-	return other->get_global_list_var(this->list_var_id);
-      }
-      else {
-	// FRED_VERBOSE(0, "get_list_value : |%s|: person %d  calling get_list_var \n", this->name.c_str(), person->get_id());
-	return person->get_global_list_var(this->list_var_id);
-      }
+      const double_vector_t &list = Person::get_global_list_var(this->list_var_id);
+      results->insert(results->end(), list.begin(), list.end());
     }
     else {
-      if (this->use_other) {
-	return other->get_list_var(this->list_var_id);
-      }
-      else {
-	// FRED_VERBOSE(0, "get_list_value : |%s|: person %d  calling get_list_var \n", this->name.c_str(), person->get_id());
-	return person->get_list_var(this->list_var_id);
-      }
+      const double_vector_t &list = owner->get_list_var(this->list_var_id);
+      results->insert(results->end(), list.begin(), list.end());
     }
+    return;
   }
 
   if (this->is_pool) {
-    if (this->use_other) {
-      return get_pool(other);
-    }
-    else {
-      return get_pool(person);
-    }
+    get_pool(this->use_other ? other : person, results);
+    return;
   }
 
   if (this->is_filter) {
-    double_vector_t initial_list = this->expr1->get_list_value(person,other);
-    return get_filtered_list(person, initial_list);
+    double_vector_t* initial_list = Expression::get_list_buffer();
+    this->expr1->get_list_value(person, other, initial_list);
+    get_filtered_list(person, *initial_list, results);
+    Expression::release_list_buffer();
+    return;
   }
+}
 
-  return results;
+
+double_vector_t* Expression::get_list_buffer() {
+  if (Expression::list_buffers_in_use == Expression::list_buffers.size()) {
+    Expression::list_buffers.push_back(new double_vector_t);
+  }
+  double_vector_t* buffer = Expression::list_buffers[Expression::list_buffers_in_use++];
+  buffer->clear();
+  return buffer;
+}
+
+void Expression::release_list_buffer() {
+  Expression::list_buffers_in_use--;
+}
+
+person_vector_t* Expression::get_person_buffer() {
+  if (Expression::person_buffers_in_use == Expression::person_buffers.size()) {
+    Expression::person_buffers.push_back(new person_vector_t);
+  }
+  person_vector_t* buffer = Expression::person_buffers[Expression::person_buffers_in_use++];
+  buffer->clear();
+  return buffer;
 }
 
+void Expression::release_person_buffer() {
+  Expression::person_buffers_in_use--;
+}
+
+unsigned int Expression::start_id_marks() {
+  if (++Expression::id_epoch == 0) {
+    // the epoch wrapped around; clear the old marks
+    std::fill(Expression::id_mark.begin(), Expression::id_mark.end(), 0);
+    Expression::id_epoch = 1;
+  }
+  return Expression::id_epoch;
+}
 
-double_vector_t Expression::get_pool(Person* person) {
+bool Expression::mark_id(int id, unsigned int epoch) {
+  if (id < 0) {
+    return true;
+  }
+  if (id >= Expression::id_mark.size()) {
+    Expression::id_mark.resize(id + 1 + id / 2, 0);
+  }
+  if (Expression::id_mark[id] == epoch) {
+    return false;
+  }
+  Expression::id_mark[id] = epoch;
+  return true;
+}
 
-  // FRED_VERBOSE(0, "get_pool person %d\n", person->get_id());
+void Expression::get_pool(Person* person, double_vector_t* people) {
 
-  // return the list of ids of people in the person's pool groups
+  // append the ids of people in the person's pool groups, without duplicates
 
-  std::unordered_set<int> found = {};
-  double_vector_t people;
-  people.clear();
+  unsigned int epoch = Expression::start_id_marks();
   for (int i = 0; i < this->pool.size(); i++) {
     int group_type_id = this->pool[i];
-    // printf("group_type_id = %d\n", group_type_id); fflush(stdout);
     Group* group = person->get_activity_group(group_type_id);
-    // printf("group = %s\n", group ? group->get_label() : "NULL"); fflush(stdout);
     if (group!=NULL) {
       int size = group->get_size();
-      // printf("size = %d\n", size);
       for (int j = 0; j < size; j++) {
-	// printf("size = %d j = %d\n", size, j); fflush(stdout);
 	int other_id = group->get_member(j)->get_id();
-	if (found.insert(other_id).second) {
-	  people.push_back(other_id);
-	  // printf("added id %d\n", other_id);
-	}
-	else {
-	  // printf("duplicate id %d\n", other_id);
+	if (Expression::mark_id(other_id, epoch)) {
+	  people->push_back(other_id);
 	}
       }
     }
   }
-  // FRED_VERBOSE(0, "get_pool person %d pool size %d\n", person->get_id(), (int)people.size());
-
-  return people;
 }
 
-double_vector_t Expression::get_filtered_list(Person* person, double_vector_t &list) {
-
-  // create a filtered list of qualified people
-  std::unordered_set<int> found = {};
-  double_vector_t filtered;
-  filtered.clear();
+void Expression::get_filtered_list(Person* person, double_vector_t &list, double_vector_t* filtered) {
 
-  // filter out anyone who fails any requirement
-  for (int j = 0; j < list.size(); j++) {
+  // filter out anyone who fails any requirement; the requirements may
+  // evaluate other lists, so they are all tested before removing duplicates
+  int size = list.size();
+  int start = filtered->size();
+  for (int j = 0; j < size; j++) {
     int other_id = list[j];
     Person* other = Person::get_person_with_id(other_id);
-    // printf("testing filter: other %d age %d sex %c\n", other_id, other->get_age(), other->get_sex());
     if (this->clause->get_value(person, other)) {
-      if (found.insert(other_id).second) {
-	filtered.push_back(other_id);
-	// printf("passed filter other %d age %d sex %c\n", other_id, other->get_age(), other->get_sex());
-      }
+      filtered->push_back(other_id);
     }
-    else {
-      // printf("failed filter other %d age %d sex %c\n", other_id, other->get_age(), other->get_sex());
+  }
+  unsigned int epoch = Expression::start_id_marks();
+  int n = start;
+  for (int j = start; j < filtered->size(); j++) {
+    if (Expression::mark_id((*filtered)[j], epoch)) {
+      (*filtered)[n++] = (*filtered)[j];
     }
   }
-  return filtered;
+  filtered->resize(n);
 }
-
@@ -36,7 +36,10 @@ public:
   string get_name();
   double get_value(Person* person, Person* other = NULL);
   double_vector_t get_list_value(Person* person, Person* other = NULL);
+  void get_list_value(Person* person, Person* other, double_vector_t* results);
   bool parse();
+  int get_covariates();
+  int get_other_covariates();
   
   static bool is_known_function(std::string str) {
     return Expression::op_map.find(str)!=Expression::op_map.end();
@@ -53,8 +56,8 @@ public:
   string replace_unary_minus(string s);
   string convert_infix_to_prefix(string infix);
   int find_comma(string s);
-  double_vector_t get_pool(Person* person);
-  double_vector_t get_filtered_list(Person* person, double_vector_t &list);
+  void get_pool(Person* person, double_vector_t* people);
+  void get_filtered_list(Person* person, double_vector_t &list, double_vector_t* filtered);
   bool is_warning() {
     return this->warning;
   }
@@ -94,6 +97,20 @@ private:
 
   static std::map<std::string,int> op_map;
   static std::map<std::string,int> value_map;
+
+  static double_vector_t* get_list_buffer();
+  static void release_list_buffer();
+  static person_vector_t* get_person_buffer();
+  static void release_person_buffer();
+  static unsigned int start_id_marks();
+  static bool mark_id(int id, unsigned int epoch);
+
+  static thread_local std::vector<double_vector_t*> list_buffers;
+  static thread_local int list_buffers_in_use;
+  static thread_local std::vector<person_vector_t*> person_buffers;
+  static thread_local int person_buffers_in_use;
+  static thread_local std::vector<unsigned int> id_mark;
+  static thread_local unsigned int id_epoch;
 };
 
 #endif
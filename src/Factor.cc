@@ -33,6 +33,14 @@
 #include "Random.h"
 #include "Utils.h"
 
+// groups smaller than this are summed directly
+#define FACTOR_MEMO_MIN_GROUP_SIZE 32
+
+unsigned int Factor::membership_epoch = 1;
+std::vector<unsigned int> Factor::var_epoch;
+int Factor::memo_step[Global::MAX_NUM_THREADS];
+factor_memo_map_t Factor::group_var_memo[Global::MAX_NUM_THREADS];
+
 Factor::Factor(string s) {
   this->name = s;
   this->number_of_args = 0;
@@ -404,7 +412,7 @@ double Factor::get_sum_of_vars_in_group(Person* person, int var_id, int group_ty
     if (place == NULL) {
       return 0;
     }
-    double value = place->get_sum_of_var(var_id);
+    double value = get_sum_of_var_in_group(place, var_id);
     return value;
   }
   else {
@@ -413,7 +421,7 @@ double Factor::get_sum_of_vars_in_group(Person* person, int var_id, int group_ty
     if (network == NULL) {
       return 0;
     }
-    double value = network->get_sum_of_var(var_id);
+    double value = get_sum_of_var_in_group(network, var_id);
     return value;
   }
 }
@@ -425,7 +433,7 @@ double Factor::get_ave_of_vars_in_group(Person* person, int var_id, int group_ty
     if (place == NULL) {
       return 0;
     }
-    double value = place->get_sum_of_var(var_id);
+    double value = get_sum_of_var_in_group(place, var_id);
     int size = place->get_size();
     if (size > 0) {
       value = value / size;
@@ -438,7 +446,7 @@ double Factor::get_ave_of_vars_in_group(Person* person, int var_id, int group_ty
     if (network == NULL) {
       return 0;
     }
-    double value = network->get_sum_of_var(var_id);
+    double value = get_sum_of_var_in_group(network, var_id);
     int size = network->get_size();
     if (size > 0) {
       value = value / size;
@@ -447,6 +455,32 @@ double Factor::get_ave_of_vars_in_group(Person* person, int var_id, int group_ty
   }
 }
 
+// Sums over large groups are memoized for the current simulation hour,
+// since many rules may refer to the same group. An entry is stale once the
+// variable has been set for anyone or any group membership has changed.
+double Factor::get_sum_of_var_in_group(Group* group, int var_id) {
+  if (group->get_size() < FACTOR_MEMO_MIN_GROUP_SIZE || Factor::var_epoch.size() <= var_id) {
+    return group->get_sum_of_var(var_id);
+  }
+  int thread = fred::omp_get_thread_num();
+  if (Factor::memo_step[thread] != Global::Simulation_Step) {
+    Factor::group_var_memo[thread].clear();
+    Factor::memo_step[thread] = Global::Simulation_Step;
+  }
+  std::vector<factor_memo_t>& memo = Factor::group_var_memo[thread][group];
+  if (memo.size() <= var_id) {
+    factor_memo_t empty = { 0, 0, 0.0 };
+    memo.resize(Factor::var_epoch.size(), empty);
+  }
+  factor_memo_t* entry = &memo[var_id];
+  if (entry->membership_epoch != Factor::membership_epoch || entry->var_epoch != Factor::var_epoch[var_id]) {
+    entry->value = group->get_sum_of_var(var_id);
+    entry->membership_epoch = Factor::membership_epoch;
+    entry->var_epoch = Factor::var_epoch[var_id];
+  }
+  return entry->value;
+}
+
 double Factor::get_block_group_admin_code(Person* person, int place_type_id) {
   Place* place = NULL;
   place = person->get_place_of_type(place_type_id);
@@ -818,6 +852,25 @@ double Factor::get_value(Person* person1, Person* person2) {
 }
 
 
+int Factor::get_covariates() {
+  if (this->is_constant) {
+    return Covariate::NONE;
+  }
+  if (this->number_of_args == 1) {
+    if (this->f1 == &Factor::get_age) {
+      return Covariate::AGE;
+    }
+    if (this->f1 == &Factor::get_sex) {
+      return Covariate::SEX;
+    }
+    if (this->f1 == &Factor::get_race) {
+      return Covariate::RACE;
+    }
+  }
+  return Covariate::DYNAMIC;
+}
+
+
 bool Factor::parse() {
 
   // printf("FACTOR: parsing factor |%s|\n", this->name.c_str()); fflush(stdout);
@@ -1283,6 +1336,9 @@ bool Factor::parse() {
     this->arg2 = var_id;
     this->arg3 = group_type_id;
     this->number_of_args = 3;
+    if (Factor::var_epoch.size() < Person::get_number_of_vars()) {
+      Factor::var_epoch.resize(Person::get_number_of_vars(), 1);
+    }
     if (verb == 0) {
       this->f3 = get_sum_of_vars_in_group;
     }
@@ -23,9 +23,14 @@
 
 #include <stdlib.h>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Global.h"
 
 using namespace std;
 
+class Group;
 class Person;
 
 typedef double (*fptr_with_0_arg) ();
@@ -40,6 +45,23 @@ typedef double (*fptr_with_8_arg) (Person*,int,int,int,int, int, int, int);
 typedef double (*Fptr_with_2_arg) (Person*,Person*);
 typedef double (*Fptr_with_3_arg) (Person*,Person*,int);
 
+// The agent attributes that a factor, expression or rule may depend on.
+// A value that depends only on enumerable covariates is the same for all
+// agents with the same age, sex and race, so it can be tabulated.
+namespace Covariate {
+  enum e { NONE = 0, AGE = 1, SEX = 2, RACE = 4, DYNAMIC = 8 };
+}
+
+// A memoized value of a group-level factor, with the epochs of the data
+// it was computed from.
+typedef struct {
+  unsigned int membership_epoch;
+  unsigned int var_epoch;
+  double value;
+} factor_memo_t;
+
+typedef std::unordered_map<Group*, std::vector<factor_memo_t> > factor_memo_map_t;
+
 class Factor {
 public:
 
@@ -48,9 +70,20 @@ public:
   string get_name();
   double get_value(Person* person);
   double get_value(Person* person1, Person* person2);
+  int get_covariates();
   bool is_warning() {
     return this->warning;
   }
+
+  /// invalidate memoized group-level values
+  static void update_membership_epoch() {
+    Factor::membership_epoch++;
+  }
+  static void update_var_epoch(int var_id) {
+    if (var_id < Factor::var_epoch.size()) {
+      Factor::var_epoch[var_id]++;
+    }
+  }
   
 private:
   std::string name;
@@ -122,6 +155,13 @@ private:
 			 int group_type_id, int condition_id, int state, int except_me);
   static double get_sum_of_vars_in_group(Person* person, int var_id, int group_type_id);
   static double get_ave_of_vars_in_group(Person* person, int var_id, int group_type_id);
+  static double get_sum_of_var_in_group(Group* group, int var_id);
+
+  // memo of group sums for the current hour, one per thread
+  static unsigned int membership_epoch;
+  static std::vector<unsigned int> var_epoch;
+  static int memo_step[Global::MAX_NUM_THREADS];
+  static factor_memo_map_t group_var_memo[Global::MAX_NUM_THREADS];
 
   /// Factors based on groups
   static double get_group_id(Person* person, int group_type_id);
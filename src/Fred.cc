@@ -282,6 +282,9 @@ void fred_setup(int argc, char* argv[]) {
   Condition::prepare_conditions();
   // printf("FRED_SETUP %d\n", Random::draw_random_int(0,10000));
 
+  // find sets of conditions that can be updated concurrently
+  Condition::prepare_condition_sets();
+
   Utils::fred_print_lap_time("prepare_conditions");
 
   // PHASE 14: Update elevation if necessary
@@ -360,9 +363,13 @@ void fred_day(int day) {
   Utils::fred_start_day_timer();
   fred_setup_day(day);
 
-  for(Global::Simulation_Hour = 0; Global::Simulation_Hour < 24; ++Global::Simulation_Hour) {
+  // skip hours with no scheduled transitions and no open groups
+  Global::Simulation_Hour = 0;
+  while (Global::Simulation_Hour < 24) {
     Global::Simulation_Step = 24 * day + Global::Simulation_Hour;
     fred_step(day, Global::Simulation_Hour);
+    Network_Type::apply_edge_edits();
+    Global::Simulation_Hour = Condition::get_next_update_hour(day, Global::Simulation_Hour);
   }
 
   fred_finish_day(day);
@@ -373,6 +380,12 @@ void fred_step(int day, int hour) {
   
   FRED_VERBOSE(1, "fred_step day %d hour %d\n", day, hour);
 
+  // update independent sets of conditions concurrently, if enabled
+  if (Condition::get_number_of_condition_sets() > 1) {
+    Condition::update_condition_sets(day, hour);
+    return;
+  }
+
   // order of condition updates:
   vector<int> order;
   order.clear();
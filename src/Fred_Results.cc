@@ -0,0 +1,435 @@
+/*
+ * This file is part of the FRED system.
+ *
+ * Copyright (c) 2010-2012, University of Pittsburgh, John Grefenstette, Shawn Brown,
+ * Roni Rosenfield, Alona Fyshe, David Galloway, Nathan Stone, Jay DePasse,
+ * Anuroop Sriram, and Donald Burke
+ * All rights reserved.
+ *
+ * Copyright (c) 2013-2019, University of Pittsburgh, John Grefenstette, Robert Frankeny,
+ * David Galloway, Mary Krauland, Michael Lann, David Sinclair, and Donald Burke
+ * All rights reserved.
+ *
+ * FRED is distributed on the condition that users fully understand and agree to all terms of the
+ * End User License Agreement.
+ *
+ * FRED is intended FOR NON-COMMERCIAL, EDUCATIONAL OR RESEARCH PURPOSES ONLY.
+ *
+ * See the file "LICENSE" for more information.
+ */
+
+//
+//
+// File: Fred_Results.cc
+//
+// Collects the daily output of all runs in an output directory into the
+// PLOT/DAILY and PLOT/WEEKLY files read by fred_plot and friends. This is
+// a compiled replacement for the work formerly done by fred_make_csv_files:
+// each run's daily file is read once, the weekly series is derived from it
+// in memory, and the statistics across runs are computed exactly. The
+// variables are processed concurrently when built with OpenMP.
+//
+// In addition to the usual layout, PLOT/SUMMARY.csv holds the statistics of
+// every variable in a single file with one row per variable, period and
+// index.
+//
+// With --paired BASE, the runs are compared with the runs of the same
+// number in the output directory BASE, e.g. a baseline scenario run with
+// the same seeds and enable_common_random_numbers = 1, and
+// PLOT/PAIRED.csv holds the mean, standard deviation and standard error
+// of the daily difference (this scenario minus BASE) of every variable.
+//
+// usage: FRED_RESULTS [--dir OUT] [--paired BASE]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef vector<string> string_vector_t;
+
+// one output series of one run
+typedef struct {
+  string_vector_t index;
+  string_vector_t value;
+} series_t;
+
+static string_vector_t runs;
+static string_vector_t epi_week;
+static int init_week = 0;
+
+static void fail(const char* msg, const string& arg) {
+  fprintf(stderr, "FRED_RESULTS: %s %s\n", msg, arg.c_str());
+  exit(1);
+}
+
+static void read_lines(const string& filename, string_vector_t* first, string_vector_t* second) {
+  FILE* fp = fopen(filename.c_str(), "r");
+  if (fp == NULL) {
+    fail("can't read", filename);
+  }
+  char line[1024];
+  char a[512];
+  char b[512];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    a[0] = b[0] = '\0';
+    if (sscanf(line, "%511s %511s", a, b) < 1) {
+      continue;
+    }
+    first->push_back(a);
+    second->push_back(b);
+  }
+  fclose(fp);
+}
+
+static string format_number(double x) {
+  char str[64];
+  sprintf(str, "%.15g", x);
+  return str;
+}
+
+// aggregate a week's values the same way for every run: totals report the
+// last day, new counts are summed, and all other variables are averaged
+static string weekly_value(const string& var, const string& count, double sum, int days) {
+  if (var.find("tot") != string::npos) {
+    return count;
+  }
+  if (var.find("new") != string::npos) {
+    return format_number(sum);
+  }
+  return format_number((double)(long long int)(sum / days + 0.5));
+}
+
+static void make_weekly(const string& var, const series_t& daily, series_t* weekly) {
+  int size = daily.value.size();
+  bool first = true;
+  int day = 0;
+  double sum = 0;
+  string count;
+  string week;
+  for (int i = 0; i < size; ++i) {
+    count = daily.value[i];
+    sum += strtod(count.c_str(), NULL);
+    week = (i < (int)epi_week.size()) ? epi_week[i] : "";
+    day++;
+    if ((first && day == init_week) || (!first && day == 7)) {
+      weekly->index.push_back(week);
+      weekly->value.push_back(weekly_value(var, count, sum, day));
+      sum = 0;
+      day = 0;
+      first = false;
+    }
+  }
+  if (day > 0) {
+    weekly->index.push_back(week);
+    weekly->value.push_back(weekly_value(var, count, sum, day));
+  }
+}
+
+static void write_series(const string& filename, const series_t& series) {
+  FILE* fp = fopen(filename.c_str(), "w");
+  if (fp == NULL) {
+    fail("can't write to file", filename);
+  }
+  for (int i = 0; i < (int)series.value.size(); ++i) {
+    fprintf(fp, "%s %s\n", series.index[i].c_str(), series.value[i].c_str());
+  }
+  fclose(fp);
+}
+
+// element i of the sorted data, with negative indices counting back from
+// the end, to reproduce the quantiles reported by earlier versions
+static double element(const vector<double>& data, int i) {
+  int n = data.size();
+  if (i < 0) {
+    i += n;
+  }
+  return (0 <= i && i < n) ? data[i] : 0.0;
+}
+
+static double quantile(const vector<double>& data, double q, bool upper) {
+  int n = data.size();
+  double rank = q * (n + 1);
+  int irank = (int) rank;
+  if (upper && irank == n) {
+    irank = n - 1;
+  }
+  double weight = rank - irank;
+  double value = element(data, irank - 1);
+  if (n > 1) {
+    value += weight * (element(data, irank) - element(data, irank - 1));
+  }
+  return value;
+}
+
+// write PLOT/<period>/<var>.csv and return the means, which are the
+// population sizes used for the other variables
+static vector<double> write_stats(const string& var, const string& period, const vector<series_t>& series,
+				  const vector<double>* popsize, string* summary) {
+  vector<double> means;
+  string filename = "PLOT/" + period + "/" + var + ".csv";
+  FILE* fp = fopen(filename.c_str(), "w");
+  if (fp == NULL) {
+    fail("can't write to", filename);
+  }
+  int n = series.size();
+  int rows = series[0].value.size();
+  fprintf(fp, "INDEX,N,POPSIZE,MIN,QUART1,MED,QUART3,MAX,MEAN,STD");
+  for (int r = 1; r <= n; ++r) {
+    fprintf(fp, ",RUN%d", r);
+  }
+  fprintf(fp, "\n");
+
+  vector<double> data(n);
+  for (int i = 0; i < rows; ++i) {
+    for (int r = 0; r < n; ++r) {
+      if ((int)series[r].value.size() != rows) {
+	fail("runs have different lengths for", var);
+      }
+      data[r] = strtod(series[r].value[i].c_str(), NULL);
+    }
+    std::sort(data.begin(), data.end());
+    double q1 = quantile(data, 0.25, false);
+    double med = quantile(data, 0.5, false);
+    double q3 = quantile(data, 0.75, true);
+    double sum = 0;
+    double sumsq = 0;
+    for (int r = 0; r < n; ++r) {
+      sum += data[r];
+      sumsq += data[r] * data[r];
+    }
+    double square = (n > 1) ? (n * sumsq - sum * sum) / (n * (n - 1.0)) : 0;
+    double std = (square > 0.000000001) ? sqrt(square) : 0;
+    double mean = (n > 0) ? sum / n : 0;
+
+    // the mean is reported (and reused as the population size) at the
+    // precision written to the csv file
+    char str[64];
+    sprintf(str, "%0.5f", mean);
+    means.push_back(atof(str));
+    double mean_pop = (popsize == NULL) ? 1 : (i < (int)popsize->size() ? (*popsize)[i] : 0);
+
+    const char* index = series[0].index[i].c_str();
+    fprintf(fp, "%s,%0.0f,%0.0f,%0.0f,%0.2f,%0.2f,%0.2f,%0.0f,%0.5f,%0.5f",
+	    index, (double) n, mean_pop, data[0], q1, med, q3, data[n-1], mean, std);
+    for (int r = 0; r < n; ++r) {
+      fprintf(fp, ",%s", series[r].value[i].c_str());
+    }
+    fprintf(fp, "\n");
+
+    char line[1024];
+    snprintf(line, sizeof(line), "%s,%s,%s,%d,%0.0f,%0.0f,%0.2f,%0.2f,%0.2f,%0.0f,%0.5f,%0.5f\n",
+	     var.c_str(), period.c_str(), index, n, mean_pop, data[0], q1, med, q3, data[n-1], mean, std);
+    summary->append(line);
+  }
+  fclose(fp);
+  return means;
+}
+
+// read the daily series of one variable from every run, write each run's
+// weekly series and the statistics across runs for both periods
+static void process_variable(const string& var, vector<double>* daily_popsize, vector<double>* weekly_popsize,
+			     string* summary) {
+  int n = runs.size();
+  vector<series_t> daily(n);
+  vector<series_t> weekly(n);
+  for (int r = 0; r < n; ++r) {
+    read_lines(runs[r] + "/DAILY/" + var + ".txt", &daily[r].index, &daily[r].value);
+    make_weekly(var, daily[r], &weekly[r]);
+    write_series(runs[r] + "/WEEKLY/" + var + ".txt", weekly[r]);
+  }
+  bool is_popsize = (var == "Popsize");
+  vector<double> daily_means = write_stats(var, "DAILY", daily, is_popsize ? NULL : daily_popsize, summary);
+  vector<double> weekly_means = write_stats(var, "WEEKLY", weekly, is_popsize ? NULL : weekly_popsize, summary);
+  if (is_popsize) {
+    *daily_popsize = daily_means;
+    *weekly_popsize = weekly_means;
+  }
+}
+
+// the statistics of the daily differences between each run and the run
+// of the same number in the base directory
+static void process_paired_variable(const string& var, const string& base, string* paired) {
+  int n = runs.size();
+  vector<series_t> daily(n);
+  vector<series_t> base_daily(n);
+  for (int r = 0; r < n; ++r) {
+    read_lines(runs[r] + "/DAILY/" + var + ".txt", &daily[r].index, &daily[r].value);
+    read_lines(base + "/" + runs[r] + "/DAILY/" + var + ".txt", &base_daily[r].index, &base_daily[r].value);
+    if (daily[r].value.size() != base_daily[r].value.size()) {
+      fail("paired runs have different lengths for", var);
+    }
+  }
+  int rows = daily[0].value.size();
+  for (int i = 0; i < rows; ++i) {
+    double sum = 0;
+    double sumsq = 0;
+    for (int r = 0; r < n; ++r) {
+      if ((int)daily[r].value.size() != rows) {
+	fail("runs have different lengths for", var);
+      }
+      double diff = strtod(daily[r].value[i].c_str(), NULL) - strtod(base_daily[r].value[i].c_str(), NULL);
+      sum += diff;
+      sumsq += diff * diff;
+    }
+    double square = (n > 1) ? (n * sumsq - sum * sum) / (n * (n - 1.0)) : 0;
+    double std = (square > 0.000000001) ? sqrt(square) : 0;
+    double mean = sum / n;
+    char line[1024];
+    snprintf(line, sizeof(line), "%s,%s,%d,%0.5f,%0.5f,%0.5f\n",
+	     var.c_str(), daily[0].index[i].c_str(), n, mean, std, std / sqrt((double) n));
+    paired->append(line);
+  }
+}
+
+static int run_number(const string& run) {
+  return atoi(run.c_str() + 3);
+}
+
+static bool compare_runs(const string& a, const string& b) {
+  return run_number(a) < run_number(b);
+}
+
+int main(int argc, char* argv[]) {
+  string dir = "OUT";
+  string base = "";
+  for (int i = 1; i < argc; ++i) {
+    if ((strcmp(argv[i], "--dir") == 0 || strcmp(argv[i], "-d") == 0) && i + 1 < argc) {
+      dir = argv[++i];
+    }
+    else if (strncmp(argv[i], "--dir=", 6) == 0) {
+      dir = argv[i] + 6;
+    }
+    else if (strcmp(argv[i], "--paired") == 0 && i + 1 < argc) {
+      base = argv[++i];
+    }
+    else if (strncmp(argv[i], "--paired=", 9) == 0) {
+      base = argv[i] + 9;
+    }
+    else {
+      fprintf(stderr, "usage: FRED_RESULTS [--dir OUT] [--paired BASE]\n");
+      exit(1);
+    }
+  }
+  DIR* dp = opendir(dir.c_str());
+  if (dp == NULL) {
+    fail("can't find", dir);
+  }
+  closedir(dp);
+  if (base != "") {
+    // the base directory is used after changing to dir
+    char* path = realpath(base.c_str(), NULL);
+    if (path == NULL) {
+      fail("can't find", base);
+    }
+    base = path;
+    free(path);
+  }
+  if (chdir(dir.c_str()) != 0) {
+    fail("can't change to", dir);
+  }
+  mkdir("PLOT", 0777);
+  mkdir("PLOT/DAILY", 0777);
+  mkdir("PLOT/WEEKLY", 0777);
+
+  // find the runs
+  dp = opendir(".");
+  struct dirent* entry;
+  while ((entry = readdir(dp)) != NULL) {
+    if (strncmp(entry->d_name, "RUN", 3) == 0 && entry->d_name[3] >= '0' && entry->d_name[3] <= '9') {
+      runs.push_back(entry->d_name);
+    }
+  }
+  closedir(dp);
+  if (runs.empty()) {
+    fail("no RUN directories in", dir);
+  }
+  std::sort(runs.begin(), runs.end(), compare_runs);
+  for (int r = 0; r < (int)runs.size(); ++r) {
+    mkdir((runs[r] + "/WEEKLY").c_str(), 0777);
+  }
+
+  // find the output variables, with Popsize first
+  string_vector_t vars;
+  string daily_dir = runs[0] + "/DAILY";
+  dp = opendir(daily_dir.c_str());
+  if (dp == NULL) {
+    fail("can't find", daily_dir);
+  }
+  while ((entry = readdir(dp)) != NULL) {
+    string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) {
+      name = name.substr(0, name.size() - 4);
+      if (name != "Day" && name != "Date" && name != "EpiWeek" && name != "Popsize") {
+	vars.push_back(name);
+      }
+    }
+  }
+  closedir(dp);
+  std::sort(vars.begin(), vars.end());
+  vars.insert(vars.begin(), "Popsize");
+  FILE* fp = fopen("PLOT/VARS", "w");
+  if (fp == NULL) {
+    fail("can't open", "PLOT/VARS");
+  }
+  for (int v = 0; v < (int)vars.size(); ++v) {
+    fprintf(fp, "%s\n", vars[v].c_str());
+  }
+  fclose(fp);
+
+  // get the epi weeks and the number of days in the initial week
+  string_vector_t days;
+  read_lines(runs[0] + "/DAILY/EpiWeek.txt", &days, &epi_week);
+  for (int i = 0; i < (int)epi_week.size() && epi_week[i] == epi_week[0]; ++i) {
+    init_week++;
+  }
+
+  // Popsize is needed by all other variables
+  int nvars = vars.size();
+  vector<string> summary(nvars);
+  vector<double> daily_popsize;
+  vector<double> weekly_popsize;
+  process_variable(vars[0], &daily_popsize, &weekly_popsize, &summary[0]);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int v = 1; v < nvars; ++v) {
+    process_variable(vars[v], &daily_popsize, &weekly_popsize, &summary[v]);
+  }
+
+  fp = fopen("PLOT/SUMMARY.csv", "w");
+  if (fp == NULL) {
+    fail("can't open", "PLOT/SUMMARY.csv");
+  }
+  fprintf(fp, "VAR,PERIOD,INDEX,N,POPSIZE,MIN,QUART1,MED,QUART3,MAX,MEAN,STD\n");
+  for (int v = 0; v < nvars; ++v) {
+    fputs(summary[v].c_str(), fp);
+  }
+  fclose(fp);
+
+  if (base != "") {
+    vector<string> paired(nvars);
+#pragma omp parallel for schedule(dynamic)
+    for (int v = 0; v < nvars; ++v) {
+      process_paired_variable(vars[v], base, &paired[v]);
+    }
+    fp = fopen("PLOT/PAIRED.csv", "w");
+    if (fp == NULL) {
+      fail("can't open", "PLOT/PAIRED.csv");
+    }
+    fprintf(fp, "VAR,INDEX,N,MEAN_DIFF,STD_DIFF,SE_DIFF\n");
+    for (int v = 0; v < nvars; ++v) {
+      fputs(paired[v].c_str(), fp);
+    }
+    fclose(fp);
+  }
+  return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * This file is part of the FRED system.
+ *
+ * Copyright (c) 2010-2012, University of Pittsburgh, John Grefenstette, Shawn Brown,
+ * Roni Rosenfield, Alona Fyshe, David Galloway, Nathan Stone, Jay DePasse,
+ * Anuroop Sriram, and Donald Burke
+ * All rights reserved.
+ *
+ * Copyright (c) 2013-2019, University of Pittsburgh, John Grefenstette, Robert Frankeny,
+ * David Galloway, Mary Krauland, Michael Lann, David Sinclair, and Donald Burke
+ * All rights reserved.
+ *
+ * FRED is distributed on the condition that users fully understand and agree to all terms of the
+ * End User License Agreement.
+ *
+ * FRED is intended FOR NON-COMMERCIAL, EDUCATIONAL OR RESEARCH PURPOSES ONLY.
+ *
+ * See the file "LICENSE" for more information.
+ */
+
+//
+//
+// File: Fred_Snapshot.cc
+//
+// Converts a binary population snapshot, written by FRED when
+// output_population_format = binary, into a CSV file with one row per
+// person and one column per field. Condition states and places are
+// written by name, as in the text population file. The values of a list
+// variable are separated by semicolons within a single field. With
+// --schema only the header and column descriptions are printed. A
+// compressed snapshot is read transparently. See
+// Person::write_population_snapshot_file for the file layout.
+//
+// usage: FRED_SNAPSHOT [--schema] snapshot.bin [output.csv]
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "Compressed_Stream.h"
+
+using namespace std;
+
+typedef vector<string> string_vector_t;
+
+enum {
+  SNAPSHOT_INT32 = 1,
+  SNAPSHOT_DOUBLE = 2,
+  SNAPSHOT_CHAR = 3,
+  SNAPSHOT_DOUBLE_LIST = 4
+};
+
+static const char* type_name[] = { "", "int32", "double", "char", "double_list" };
+
+typedef struct {
+  int type;
+  string name;
+  string_vector_t labels;
+  const char* data;
+  const char* offsets;
+} column_t;
+
+static vector<char> buffer;
+static size_t pos = 0;
+static string filename;
+
+static void fail(const char* msg, const string& arg) {
+  fprintf(stderr, "FRED_SNAPSHOT: %s %s\n", msg, arg.c_str());
+  exit(1);
+}
+
+static const char* take(size_t bytes) {
+  if (buffer.size() - pos < bytes) {
+    fail("truncated snapshot", filename);
+  }
+  const char* p = buffer.data() + pos;
+  pos += bytes;
+  return p;
+}
+
+static int32_t take_int32() {
+  int32_t value;
+  memcpy(&value, take(4), 4);
+  return value;
+}
+
+static int64_t take_int64() {
+  int64_t value;
+  memcpy(&value, take(8), 8);
+  return value;
+}
+
+static int64_t get_int64(const char* p, int64_t i) {
+  int64_t value;
+  memcpy(&value, p + 8 * i, 8);
+  return value;
+}
+
+static string take_string() {
+  int32_t len = take_int32();
+  if (len < 0) {
+    fail("bad string in", filename);
+  }
+  return string(take(len), len);
+}
+
+int main(int argc, char* argv[]) {
+  bool schema_only = false;
+  string outfile = "";
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "--schema") == 0) {
+    schema_only = true;
+    arg++;
+  }
+  if (arg >= argc) {
+    fprintf(stderr, "usage: FRED_SNAPSHOT [--schema] snapshot.bin [output.csv]\n");
+    exit(1);
+  }
+  filename = argv[arg++];
+  if (arg < argc) {
+    outfile = argv[arg];
+  } else {
+    outfile = filename;
+    size_t gz = outfile.rfind(".gz");
+    if (gz != string::npos && gz + 3 == outfile.length()) {
+      outfile = outfile.substr(0, gz);
+    }
+    size_t dot = outfile.rfind(".bin");
+    if (dot != string::npos && dot + 4 == outfile.length()) {
+      outfile = outfile.substr(0, dot);
+    }
+    outfile += ".csv";
+  }
+
+  // read the whole snapshot
+  FILE* fp = Compressed_Stream::open_for_reading(filename.c_str());
+  if (fp == NULL) {
+    fail("can't read", filename);
+  }
+  size_t size = 0;
+  size_t n = 0;
+  do {
+    buffer.resize(size + (1 << 22));
+    n = fread(buffer.data() + size, 1, buffer.size() - size, fp);
+    size += n;
+  } while (n > 0);
+  buffer.resize(size);
+  fclose(fp);
+
+  // header and schema
+  if (memcmp(take(8), "FREDSNAP", 8) != 0) {
+    fail("not a population snapshot:", filename);
+  }
+  int32_t version = take_int32();
+  if (version != 1) {
+    fail("unsupported snapshot version in", filename);
+  }
+  int32_t columns = take_int32();
+  int64_t rows = take_int64();
+  int32_t day = take_int32();
+  string date = take_string();
+  vector<column_t> column(columns);
+  for (int i = 0; i < columns; i++) {
+    column[i].type = take_int32();
+    if (column[i].type < SNAPSHOT_INT32 || SNAPSHOT_DOUBLE_LIST < column[i].type) {
+      fail("bad column type in", filename);
+    }
+    column[i].name = take_string();
+    int32_t labels = take_int32();
+    for (int j = 0; j < labels; j++) {
+      column[i].labels.push_back(take_string());
+    }
+  }
+
+  if (schema_only) {
+    printf("snapshot %s day %d date %s people %lld columns %d\n",
+	   filename.c_str(), day, date.c_str(), (long long) rows, columns);
+    for (int i = 0; i < columns; i++) {
+      printf("%s %s labels %d\n", column[i].name.c_str(), type_name[column[i].type], (int) column[i].labels.size());
+    }
+    return 0;
+  }
+
+  // locate the data of each column
+  for (int i = 0; i < columns; i++) {
+    column[i].offsets = NULL;
+    switch (column[i].type) {
+    case SNAPSHOT_INT32:
+      column[i].data = take(4 * rows);
+      break;
+    case SNAPSHOT_DOUBLE:
+      column[i].data = take(8 * rows);
+      break;
+    case SNAPSHOT_CHAR:
+      column[i].data = take(rows);
+      break;
+    case SNAPSHOT_DOUBLE_LIST:
+      column[i].offsets = take(8 * (rows + 1));
+      column[i].data = take(8 * get_int64(column[i].offsets, rows));
+      break;
+    }
+  }
+
+  // write the CSV file
+  FILE* out = fopen(outfile.c_str(), "w");
+  if (out == NULL) {
+    fail("can't write", outfile);
+  }
+  for (int i = 0; i < columns; i++) {
+    fprintf(out, "%s%s", i ? "," : "", column[i].name.c_str());
+  }
+  fprintf(out, "\n");
+  for (int64_t r = 0; r < rows; r++) {
+    for (int i = 0; i < columns; i++) {
+      const column_t& col = column[i];
+      if (i) {
+	fputc(',', out);
+      }
+      switch (col.type) {
+      case SNAPSHOT_INT32:
+	{
+	  int32_t value;
+	  memcpy(&value, col.data + 4 * r, 4);
+	  if (0 <= value && value < col.labels.size()) {
+	    fputs(col.labels[value].c_str(), out);
+	  } else {
+	    fprintf(out, "%d", value);
+	  }
+	}
+	break;
+      case SNAPSHOT_DOUBLE:
+	{
+	  double value;
+	  memcpy(&value, col.data + 8 * r, 8);
+	  fprintf(out, "%.10g", value);
+	}
+	break;
+      case SNAPSHOT_CHAR:
+	fputc(col.data[r], out);
+	break;
+      case SNAPSHOT_DOUBLE_LIST:
+	{
+	  int64_t first = get_int64(col.offsets, r);
+	  int64_t last = get_int64(col.offsets, r + 1);
+	  for (int64_t k = first; k < last; k++) {
+	    double value;
+	    memcpy(&value, col.data + 8 * k, 8);
+	    fprintf(out, "%s%.10g", k > first ? ";" : "", value);
+	  }
+	}
+	break;
+      }
+    }
+    fputc('\n', out);
+  }
+  fclose(out);
+  return 0;
+}
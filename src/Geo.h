@@ -31,12 +31,6 @@
 
 using namespace std;
 
-typedef struct {
-  fred::geo lat;
-  fred::geo lon;
-  double elevation;
-} elevation_t;
-
 
 class Geo{
 public:
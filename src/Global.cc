@@ -24,6 +24,7 @@
 //
 
 #include "Global.h"
+#include "Compressed_Stream.h"
 #include "Property.h"
 #include "Demographics.h"
 #include "Utils.h"
@@ -57,6 +58,9 @@ int Global::Use_FRED = 0;
 int Global::Use_rules = 0;
 int Global::Compile_FRED = 0;
 int Global::Max_Loops = 0;
+int Global::Health_Records_Compression = 0;
+int Global::Visualization_Compression = 0;
+int Global::Output_Population_Compression = 0;
 bool Global::Enable_Profiles = false;
 bool Global::Enable_Records = false;
 bool Global::Enable_Var_Records = false;
@@ -72,6 +76,8 @@ bool Global::Enable_Population_Dynamics = false;
 bool Global::Enable_Travel = false;
 bool Global::Enable_Local_Workplace_Assignment = false;
 bool Global::Enable_Fixed_Order_Condition_Updates = false;
+bool Global::Enable_Concurrent_Condition_Updates = false;
+bool Global::Enable_Common_Random_Numbers = false;
 bool Global::Enable_External_Updates = false;
 bool Global::Use_Mean_Latitude = false;
 bool Global::Report_Serial_Interval = false;
@@ -92,6 +98,17 @@ FILE* Global::Birthfp = NULL;
 FILE* Global::Deathfp = NULL;
 FILE* Global::ErrorLogfp = NULL;
 
+static int get_compression_property(const char* name) {
+  char method[FRED_STRING_SIZE];
+  strcpy(method, "none");
+  Property::get_property(name, method);
+  int compression = Compressed_Stream::get_compression_method(method);
+  if(compression < 0) {
+    Utils::fred_abort("Unknown compression method %s for %s\n", method, name);
+  }
+  return compression;
+}
+
 void Global::get_global_properties() {
   Property::get_property("verbose", &Global::Verbose);
   Property::get_property("debug", &Global::Debug);
@@ -118,11 +135,21 @@ void Global::get_global_properties() {
   Property::get_property("enable_travel",&Global::Enable_Travel);
   Property::get_property("enable_local_Workplace_assignment", &Global::Enable_Local_Workplace_Assignment);
   Property::get_property("enable_fixed_order_condition_updates", &Global::Enable_Fixed_Order_Condition_Updates);
+  Property::get_property("enable_concurrent_condition_updates", &Global::Enable_Concurrent_Condition_Updates);
+  Property::get_property("enable_common_random_numbers", &Global::Enable_Common_Random_Numbers);
   Property::get_property("use_mean_latitude", &Global::Use_Mean_Latitude);
   Property::get_property("assign_teachers", &Global::Assign_Teachers);
   Property::get_property("report_serial_interval", &Global::Report_Serial_Interval);
   Property::get_property("report_contacts", &Global::Report_Contacts);
 
+  // compression of the large output files
+  Global::Health_Records_Compression = get_compression_property("health_records_compression");
+  Global::Visualization_Compression = get_compression_property("visualization_compression");
+  Global::Output_Population_Compression = get_compression_property("output_population_compression");
+  int threads = 4;
+  Property::get_property("compression_threads", &threads);
+  Compressed_Stream::set_number_of_threads(threads);
+
   // set any properties that are dependent on other properties
   Property::get_property("visualization_run", &Global::Visualization_Run);
   if(Global::Visualization_Run != -1 &&
@@ -166,6 +166,9 @@ public:
   static int Use_rules;
   static int Compile_FRED;
   static int Max_Loops;
+  static int Health_Records_Compression;
+  static int Visualization_Compression;
+  static int Output_Population_Compression;
 
   //Boolean flags
   static bool Enable_Profiles;
@@ -184,6 +187,8 @@ public:
   static bool Enable_Travel;
   static bool Enable_Local_Workplace_Assignment;
   static bool Enable_Fixed_Order_Condition_Updates;
+  static bool Enable_Concurrent_Condition_Updates;
+  static bool Enable_Common_Random_Numbers;
   static bool Enable_External_Updates;
   static bool Use_Mean_Latitude;
   static bool Report_Serial_Interval;
@@ -25,6 +25,7 @@
 
 #include "Group.h"
 #include "Condition.h"
+#include "Factor.h"
 #include "Person.h"
 #include "Utils.h"
 
@@ -92,6 +93,7 @@ int Group::begin_membership(Person* per) {
     this->members.reserve(2 * this->get_size());
   }
   this->members.push_back(per);
+  Factor::update_membership_epoch();
   FRED_VERBOSE(1, "Enroll person %d age %d in group %d %s\n", per->get_id(), per->get_age(), this->get_id(), this->get_label());
   return this->members.size()-1;
 }
@@ -114,6 +116,7 @@ void Group::end_membership(int pos) {
      this->get_id(), this->get_label(), pos, size, removed->get_id());
   }
   this->members.pop_back();
+  Factor::update_membership_epoch();
   FRED_VERBOSE(1, "UNENROLL group %d %s size = %d\n", this->get_id(), this->get_label(), this->members.size());
 }
 
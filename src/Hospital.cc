@@ -45,6 +45,8 @@ Hospital::Hospital() : Place() {
   this->daily_patient_capacity = -1;
   this->current_daily_patient_count = 0;
   this->add_capacity = false;
+  this->open_day = 0;
+  this->close_day = 0;
 
   if(Global::Enable_Health_Insurance) {
     vector<double>::iterator itr;
@@ -56,7 +58,7 @@ Hospital::Hospital() : Place() {
 }
 
 
-Hospital::Hospital(const char* lab, char _subtype, fred::geo lon, fred::geo lat) : Place(lab, lon, lat) {
+Hospital::Hospital(const char* lab, char _subtype, fred::geo lon, fred::geo lat) : Place(lab, Place_Type::get_type_id("Hospital"), lon, lat) {
   this->type_id = Place_Type::get_type_id("Hospital");
   this->set_subtype(_subtype);
   this->bed_count = 0;
@@ -64,6 +66,8 @@ Hospital::Hospital(const char* lab, char _subtype, fred::geo lon, fred::geo lat)
   this->daily_patient_capacity = -1;
   this->current_daily_patient_count = 0;
   this->add_capacity = false;
+  this->open_day = 0;
+  this->close_day = 0;
 
   if(Global::Enable_Health_Insurance) {
     vector<double>::iterator itr;
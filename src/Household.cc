@@ -55,6 +55,9 @@ Household::Household(const char* lab, char _subtype, fred::geo lon, fred::geo la
   this->group_quarters_units = 0;
   this->group_quarters_workplace = NULL;
   this->migration_admin_code = 0;
+  for (int level = 0; level < Admin_Level::ADMIN_LEVELS; level++) {
+    this->admin_division_index[level] = -1;
+  }
   this->in_low_vaccination_school = false;
   this->refuse_vaccine = false;
 }
@@ -25,6 +25,7 @@
 #ifndef _FRED_HOUSEHOLD_H
 #define _FRED_HOUSEHOLD_H
 
+#include "Admin_Division.h"
 #include "Global.h"
 #include "Hospital.h"
 #include "Place.h"
@@ -225,6 +226,16 @@ public:
     return this->migration_admin_code;
   }
 
+  // index of the county, census tract or block group of this household
+  // among the divisions of its level (see Admin_Level)
+  int get_admin_division_index(int level) {
+    return this->admin_division_index[level];
+  }
+
+  void set_admin_division_index(int level, int index) {
+    this->admin_division_index[level] = index;
+  }
+
   int get_orig_household_structure() {
     return this->orig_household_structure;
   }
@@ -352,6 +363,7 @@ private:
   bool refuse_vaccine;
 
   int migration_admin_code;  //household preparing to do county-to-county migration
+  int admin_division_index[Admin_Level::ADMIN_LEVELS];
 
   // true iff a household member is at one of the places for an extended absence
   //std::bitset<Household_extended_absence_index::HOUSEHOLD_EXTENDED_ABSENCE> not_home_bitset;
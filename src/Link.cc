@@ -24,6 +24,9 @@
 #include "Person.h"
 #include "Place.h"
 
+// shorter edge lists are scanned, which is faster than any index
+#define EDGE_INDEX_MIN_DEGREE 64
+
 Link::Link() {
   this->group = NULL;
   this->member_index = -1;
@@ -33,6 +36,33 @@ Link::Link() {
   this->outward_timestamp.clear();
   this->inward_weight.clear();
   this->outward_weight.clear();
+  this->inward_index = NULL;
+  this->outward_index = NULL;
+}
+
+Link::~Link() {
+  delete this->inward_index;
+  delete this->outward_index;
+}
+
+bool Link::has_edge_index() {
+  return this->group != NULL && Group::is_a_network(this->group->get_type_id()) && get_network()->has_edge_index();
+}
+
+// an edge list is indexed when it grows long enough. This is checked
+// only where edges are added, so that queries, which may run
+// concurrently, never build an index.
+
+void Link::prepare_inward_index() {
+  if (this->inward_index == NULL && EDGE_INDEX_MIN_DEGREE <= this->inward_edge.size() && has_edge_index()) {
+    this->inward_index = new Edge_Index(&this->inward_edge, &this->inward_timestamp, &this->inward_weight);
+  }
+}
+
+void Link::prepare_outward_index() {
+  if (this->outward_index == NULL && EDGE_INDEX_MIN_DEGREE <= this->outward_edge.size() && has_edge_index()) {
+    this->outward_index = new Edge_Index(&this->outward_edge, &this->outward_timestamp, &this->outward_weight);
+  }
 }
 
 void Link::begin_membership(Person* person, Group* new_group) {
@@ -81,6 +111,18 @@ Place* Link::get_place() {
 // these methods should be used to add or delete edges
 
 void Link::add_edge_to(Person* other_person) {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    if (0 <= index->find(other_person)) {
+      return;
+    }
+    this->outward_edge.push_back(other_person);
+    this->outward_timestamp.push_back(Global::Simulation_Step);
+    this->outward_weight.push_back(1.0);
+    index->insert(this->outward_edge.size() - 1);
+    return;
+  }
+
   int size = this->outward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(other_person == this->outward_edge[i]) {
@@ -92,9 +134,22 @@ void Link::add_edge_to(Person* other_person) {
   this->outward_edge.push_back(other_person);
   this->outward_timestamp.push_back(Global::Simulation_Step);
   this->outward_weight.push_back(1.0);
+  prepare_outward_index();
 }
 
 void Link::add_edge_from(Person* other_person) {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    if (0 <= index->find(other_person)) {
+      return;
+    }
+    this->inward_edge.push_back(other_person);
+    this->inward_timestamp.push_back(Global::Simulation_Step);
+    this->inward_weight.push_back(1.0);
+    index->insert(this->inward_edge.size() - 1);
+    return;
+  }
+
   int size =  this->inward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(other_person == this->inward_edge[i]) {
@@ -106,9 +161,134 @@ void Link::add_edge_from(Person* other_person) {
   this->inward_edge.push_back(other_person);
   this->inward_timestamp.push_back(Global::Simulation_Step);
   this->inward_weight.push_back(1.0);
+  prepare_inward_index();
+}
+
+void Link::reserve_edges(int out_degree, int in_degree) {
+  this->outward_edge.reserve(this->outward_edge.size() + out_degree);
+  this->outward_timestamp.reserve(this->outward_timestamp.size() + out_degree);
+  this->outward_weight.reserve(this->outward_weight.size() + out_degree);
+  this->inward_edge.reserve(this->inward_edge.size() + in_degree);
+  this->inward_timestamp.reserve(this->inward_timestamp.size() + in_degree);
+  this->inward_weight.reserve(this->inward_weight.size() + in_degree);
+}
+
+// the append methods do not check for an existing edge; the caller
+// must ensure that each edge is added only once
+
+void Link::append_edge_to(Person* other_person, double weight, int timestamp) {
+  Edge_Index* index = this->outward_index;
+  this->outward_edge.push_back(other_person);
+  this->outward_timestamp.push_back(timestamp);
+  this->outward_weight.push_back(weight);
+  if (index != NULL) {
+    index->insert(this->outward_edge.size() - 1);
+  } else {
+    prepare_outward_index();
+  }
+}
+
+void Link::append_edge_from(Person* other_person, double weight, int timestamp) {
+  Edge_Index* index = this->inward_index;
+  this->inward_edge.push_back(other_person);
+  this->inward_timestamp.push_back(timestamp);
+  this->inward_weight.push_back(weight);
+  if (index != NULL) {
+    index->insert(this->inward_edge.size() - 1);
+  } else {
+    prepare_inward_index();
+  }
+}
+
+static bool has_lower_id(Person* p1, Person* p2) {
+  return p1->get_id() < p2->get_id();
+}
+
+// apply a batch of edits to one edge list in a single pass. other is
+// sorted by id; add[k] is nonzero if the edge with other[k] is added and
+// zero if it is deleted. Existing edges keep their order, weight and
+// timestamp.
+
+static void update_edges(person_vector_t &edge, int_vector_t &timestamp, double_vector_t &weight,
+			 const person_vector_t &other, const int_vector_t &add) {
+  int n = other.size();
+  int_vector_t found(n, 0);
+  int size = edge.size();
+  int kept = 0;
+  for (int i = 0; i < size; ++i) {
+    person_vector_t::const_iterator pos = std::lower_bound(other.begin(), other.end(), edge[i], has_lower_id);
+    if (pos != other.end() && *pos == edge[i]) {
+      int k = pos - other.begin();
+      found[k] = 1;
+      if (add[k] == 0) {
+	continue;
+      }
+    }
+    edge[kept] = edge[i];
+    timestamp[kept] = timestamp[i];
+    weight[kept] = weight[i];
+    kept++;
+  }
+  edge.resize(kept);
+  timestamp.resize(kept);
+  weight.resize(kept);
+  for (int k = 0; k < n; ++k) {
+    if (add[k] && found[k] == 0) {
+      edge.push_back(other[k]);
+      timestamp.push_back(Global::Simulation_Step);
+      weight.push_back(1.0);
+    }
+  }
+}
+
+void Link::update_edges_to(const person_vector_t &other, const int_vector_t &add) {
+  update_edges(this->outward_edge, this->outward_timestamp, this->outward_weight, other, add);
+  if (this->outward_index != NULL) {
+    // positions have moved
+    this->outward_index->build();
+  } else {
+    prepare_outward_index();
+  }
+}
+
+void Link::update_edges_from(const person_vector_t &other, const int_vector_t &add) {
+  update_edges(this->inward_edge, this->inward_timestamp, this->inward_weight, other, add);
+  if (this->inward_index != NULL) {
+    // positions have moved
+    this->inward_index->build();
+  } else {
+    prepare_inward_index();
+  }
+}
+
+// delete the edge at position i by moving the last edge into its place,
+// as the unindexed methods do
+
+static void delete_edge(person_vector_t &edge, int_vector_t &timestamp, double_vector_t &weight,
+			Edge_Index* index, int i) {
+  if (i < 0) {
+    return;
+  }
+  int last = edge.size() - 1;
+  index->erase(i);
+  if (i < last) {
+    edge[i] = edge[last];
+    timestamp[i] = timestamp[last];
+    weight[i] = weight[last];
+    index->move(last, i);
+  }
+  edge.pop_back();
+  timestamp.pop_back();
+  weight.pop_back();
 }
 
 void Link::delete_edge_to(Person* other_person) {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    delete_edge(this->outward_edge, this->outward_timestamp, this->outward_weight, index, index->find(other_person));
+    return;
+  }
+
   // delete other_person from my outward_edge list.
   int size =  this->outward_edge.size();
   for(int i = 0; i < size; ++i) {
@@ -124,6 +304,12 @@ void Link::delete_edge_to(Person* other_person) {
 }
 
 void Link::delete_edge_from(Person* other_person) {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    delete_edge(this->inward_edge, this->inward_timestamp, this->inward_weight, index, index->find(other_person));
+    return;
+  }
+
   // delete other_person from my inward_edge list.
   int size =  this->inward_edge.size();
   // FRED_VERBOSE(0, "Link::delete_edge_from person %d size %d\n", other_person->get_id(),size);
@@ -161,6 +347,10 @@ void Link::print(FILE *fp) {
 }
 
 bool Link::is_connected_to(Person* other_person) {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    return 0 <= index->find(other_person);
+  }
   int size = this->outward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->outward_edge[i] == other_person) {
@@ -171,6 +361,10 @@ bool Link::is_connected_to(Person* other_person) {
 }
 
 bool Link::is_connected_from(Person* other_person) {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    return 0 <= index->find(other_person);
+  }
   int size = this->inward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->inward_edge[i] == other_person) {
@@ -187,6 +381,15 @@ void Link::update_member_index(int new_index) {
 }
 
 void Link::set_weight_to(Person* other_person, double value) {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->find(other_person);
+    if (0 <= i) {
+      this->outward_weight[i] = value;
+      index->update_weight(i);
+    }
+    return;
+  }
   int size = this->outward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->outward_edge[i] == other_person) {
@@ -198,6 +401,11 @@ void Link::set_weight_to(Person* other_person, double value) {
 }
 
 double Link::get_weight_to(Person* other_person) {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->find(other_person);
+    return 0 <= i ? this->outward_weight[i] : 0.0;
+  }
   int size = this->outward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->outward_edge[i] == other_person) {
@@ -208,6 +416,15 @@ double Link::get_weight_to(Person* other_person) {
 }
 
 void Link::set_weight_from(Person* other_person, double value) {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->find(other_person);
+    if (0 <= i) {
+      this->inward_weight[i] = value;
+      index->update_weight(i);
+    }
+    return;
+  }
   int size = this->inward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->inward_edge[i] == other_person) {
@@ -219,6 +436,11 @@ void Link::set_weight_from(Person* other_person, double value) {
 }
 
 double Link::get_weight_from(Person* other_person) {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->find(other_person);
+    return 0 <= i ? this->inward_weight[i] : 0.0;
+  }
   int size = this->inward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->inward_edge[i] == other_person) {
@@ -229,6 +451,11 @@ double Link::get_weight_from(Person* other_person) {
 }
 
 int Link::get_timestamp_to(Person* other_person) {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->find(other_person);
+    return 0 <= i ? this->outward_timestamp[i] : -1;
+  }
   int size = this->outward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->outward_edge[i] == other_person) {
@@ -239,6 +466,11 @@ int Link::get_timestamp_to(Person* other_person) {
 }
 
 int Link::get_timestamp_from(Person* other_person) {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->find(other_person);
+    return 0 <= i ? this->inward_timestamp[i] : -1;
+  }
   int size = this->inward_edge.size();
   for(int i = 0; i < size; ++i) {
     if(this->inward_edge[i] == other_person) {
@@ -249,6 +481,14 @@ int Link::get_timestamp_from(Person* other_person) {
 }
 
 int Link::get_id_of_last_outward_edge() {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->get_last_position();
+    if (0 <= i && -9999999 < this->outward_timestamp[i]) {
+      return this->outward_edge[i]->get_id();
+    }
+    return -99999999;
+  }
   int size = this->outward_edge.size();
   int max_time = -9999999;
   int pos = -1;
@@ -267,6 +507,14 @@ int Link::get_id_of_last_outward_edge() {
 }
 
 int Link::get_id_of_last_inward_edge() {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->get_last_position();
+    if (0 <= i && -9999999 < this->inward_timestamp[i]) {
+      return this->inward_edge[i]->get_id();
+    }
+    return -99999999;
+  }
   int size = this->inward_edge.size();
   int max_time = -9999999;
   int pos = -1;
@@ -285,6 +533,11 @@ int Link::get_id_of_last_inward_edge() {
 }
 
 int Link::get_id_of_max_weight_outward_edge() {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->get_max_weight_position();
+    return 0 <= i ? this->outward_edge[i]->get_id() : -99999999;
+  }
   int size = this->outward_edge.size();
   double max_weight;
   int pos = -1;
@@ -309,6 +562,11 @@ int Link::get_id_of_max_weight_outward_edge() {
 }
 
 int Link::get_id_of_max_weight_inward_edge() {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->get_max_weight_position();
+    return 0 <= i ? this->inward_edge[i]->get_id() : -99999999;
+  }
   int size = this->inward_edge.size();
   double max_weight;
   int pos = -1;
@@ -333,6 +591,11 @@ int Link::get_id_of_max_weight_inward_edge() {
 }
 
 int Link::get_id_of_min_weight_outward_edge() {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->get_min_weight_position();
+    return 0 <= i ? this->outward_edge[i]->get_id() : -99999999;
+  }
   int size = this->outward_edge.size();
   double min_weight;
   int pos = -1;
@@ -357,6 +620,11 @@ int Link::get_id_of_min_weight_outward_edge() {
 }
 
 int Link::get_id_of_min_weight_inward_edge() {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->get_min_weight_position();
+    return 0 <= i ? this->inward_edge[i]->get_id() : -99999999;
+  }
   int size = this->inward_edge.size();
   double min_weight;
   int pos = -1;
@@ -381,6 +649,11 @@ int Link::get_id_of_min_weight_inward_edge() {
 }
 
 int Link::get_timestamp_of_last_inward_edge() {
+  Edge_Index* index = this->inward_index;
+  if (index != NULL) {
+    int i = index->get_last_position();
+    return 0 <= i && -1 < this->inward_timestamp[i] ? this->inward_timestamp[i] : -1;
+  }
   int size = this->inward_edge.size();
   int max_time = -1;
   for(int i = 0; i < size; ++i) {
@@ -392,6 +665,11 @@ int Link::get_timestamp_of_last_inward_edge() {
 }
 
 int Link::get_timestamp_of_last_outward_edge() {
+  Edge_Index* index = this->outward_index;
+  if (index != NULL) {
+    int i = index->get_last_position();
+    return 0 <= i && -1 < this->outward_timestamp[i] ? this->outward_timestamp[i] : -1;
+  }
   int size = this->outward_edge.size();
   int max_time = -1;
   for(int i = 0; i < size; ++i) {
@@ -417,3 +695,74 @@ void Link::unlink(Person* person) {
   // printf("UNLINK: group %s size %d\n", this->group->get_label(), this->group->get_size()); fflush(stdout);
 }
   
+
+
+////////////////////////////////////////////
+//
+// EDGE INDEX
+//
+
+Edge_Index::Edge_Index(const person_vector_t* edge, const int_vector_t* timestamp, const double_vector_t* weight)
+  : max_weight(weight, true), min_weight(weight, false), last(timestamp, true) {
+  this->edge = edge;
+  build();
+}
+
+void Edge_Index::build() {
+  this->position.clear();
+  this->max_weight.clear();
+  this->min_weight.clear();
+  this->last.clear();
+  int size = this->edge->size();
+  for (int pos = 0; pos < size; ++pos) {
+    insert(pos);
+  }
+}
+
+// the neighbors are kept sorted by address, so an edge is found by binary
+// search and the list is updated in place
+
+static bool has_lower_address(const std::pair<Person*,int> &p1, Person* p2) {
+  return p1.first < p2;
+}
+
+int Edge_Index::find(Person* person) {
+  std::vector<std::pair<Person*,int> >::iterator found =
+    std::lower_bound(this->position.begin(), this->position.end(), person, has_lower_address);
+  return found != this->position.end() && found->first == person ? found->second : -1;
+}
+
+void Edge_Index::insert(int pos) {
+  Person* person = (*this->edge)[pos];
+  std::vector<std::pair<Person*,int> >::iterator found =
+    std::lower_bound(this->position.begin(), this->position.end(), person, has_lower_address);
+  this->position.insert(found, std::make_pair(person, pos));
+  this->max_weight.insert(pos);
+  this->min_weight.insert(pos);
+  this->last.insert(pos);
+}
+
+void Edge_Index::erase(int pos) {
+  Person* person = (*this->edge)[pos];
+  std::vector<std::pair<Person*,int> >::iterator found =
+    std::lower_bound(this->position.begin(), this->position.end(), person, has_lower_address);
+  this->position.erase(found);
+  this->max_weight.erase(pos);
+  this->min_weight.erase(pos);
+  this->last.erase(pos);
+}
+
+void Edge_Index::move(int from, int to) {
+  Person* person = (*this->edge)[to];
+  std::vector<std::pair<Person*,int> >::iterator found =
+    std::lower_bound(this->position.begin(), this->position.end(), person, has_lower_address);
+  found->second = to;
+  this->max_weight.move(from, to);
+  this->min_weight.move(from, to);
+  this->last.move(from, to);
+}
+
+void Edge_Index::update_weight(int pos) {
+  this->max_weight.update(pos);
+  this->min_weight.update(pos);
+}
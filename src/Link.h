@@ -25,6 +25,8 @@
 #ifndef _FRED_LINK_H
 #define _FRED_LINK_H
 
+#include <vector>
+
 #include "Global.h"
 
 class Group;
@@ -32,12 +34,144 @@ class Network;
 class Person;
 class Place;
 
+// A binary heap of the positions in an edge list, ordered by the key at
+// each position, largest or smallest first. Equal keys are ordered by
+// position, so the top is the edge that a scan of the list would find.
+
+template <typename T>
+class Edge_Heap {
+ public:
+  Edge_Heap(const std::vector<T>* key, bool largest) {
+    this->key = key;
+    this->largest = largest;
+  }
+
+  void clear() {
+    this->heap.clear();
+    this->slot.clear();
+  }
+
+  int top() {
+    return this->heap.empty() ? -1 : this->heap[0];
+  }
+
+  // the edge at pos has been appended
+  void insert(int pos) {
+    if (this->slot.size() <= pos) {
+      this->slot.resize(pos + 1);
+    }
+    this->slot[pos] = this->heap.size();
+    this->heap.push_back(pos);
+    sift_up(this->heap.size() - 1);
+  }
+
+  // the edge at pos is about to be removed
+  void erase(int pos) {
+    int s = this->slot[pos];
+    int moved = this->heap.back();
+    this->heap.pop_back();
+    if (s < this->heap.size()) {
+      place(s, moved);
+      update(moved);
+    }
+  }
+
+  // the key at pos has changed
+  void update(int pos) {
+    sift_up(this->slot[pos]);
+    sift_down(this->slot[pos]);
+  }
+
+  // the edge at from has been moved to the lower position to
+  void move(int from, int to) {
+    place(this->slot[from], to);
+    sift_up(this->slot[to]);
+  }
+
+ private:
+  bool is_before(int a, int b) {
+    T key_a = (*this->key)[a];
+    T key_b = (*this->key)[b];
+    if (key_a == key_b) {
+      return a < b;
+    }
+    return this->largest ? key_b < key_a : key_a < key_b;
+  }
+
+  void place(int s, int pos) {
+    this->heap[s] = pos;
+    this->slot[pos] = s;
+  }
+
+  void sift_up(int s) {
+    int pos = this->heap[s];
+    while (0 < s && is_before(pos, this->heap[(s - 1) / 2])) {
+      place(s, this->heap[(s - 1) / 2]);
+      s = (s - 1) / 2;
+    }
+    place(s, pos);
+  }
+
+  void sift_down(int s) {
+    int pos = this->heap[s];
+    int size = this->heap.size();
+    while (2 * s + 1 < size) {
+      int child = 2 * s + 1;
+      if (child + 1 < size && is_before(this->heap[child + 1], this->heap[child])) {
+	child++;
+      }
+      if (!is_before(this->heap[child], pos)) {
+	break;
+      }
+      place(s, this->heap[child]);
+      s = child;
+    }
+    place(s, pos);
+  }
+
+  const std::vector<T>* key;
+  bool largest;
+  int_vector_t heap;
+  int_vector_t slot;
+};
+
+// Indexes over one edge list of a Link in a network with edge_index set:
+// the position of each neighbor, and heaps of the positions by weight and
+// by timestamp. The index is told of each change after the list has been
+// updated, except for erase, which must precede the removal.
+
+class Edge_Index {
+ public:
+  Edge_Index(const person_vector_t* edge, const int_vector_t* timestamp, const double_vector_t* weight);
+  void build();
+  int find(Person* person);
+  void insert(int pos);
+  void erase(int pos);
+  void move(int from, int to);
+  void update_weight(int pos);
+  int get_max_weight_position() {
+    return this->max_weight.top();
+  }
+  int get_min_weight_position() {
+    return this->min_weight.top();
+  }
+  int get_last_position() {
+    return this->last.top();
+  }
+
+ private:
+  const person_vector_t* edge;
+  std::vector<std::pair<Person*,int> > position;
+  Edge_Heap<double> max_weight;
+  Edge_Heap<double> min_weight;
+  Edge_Heap<int> last;
+};
 
 class Link {
  public:
 
   Link();
-  ~Link() {}
+  ~Link();
 
   void begin_membership(Person* person, Group* new_group);
   void end_membership(Person* person);
@@ -46,6 +180,11 @@ class Link {
   void add_edge_from(Person* other_person);
   void delete_edge_to(Person* other_person);
   void delete_edge_from(Person* other_person);
+  void reserve_edges(int out_degree, int in_degree);
+  void append_edge_to(Person* other_person, double weight, int timestamp);
+  void append_edge_from(Person* other_person, double weight, int timestamp);
+  void update_edges_to(const person_vector_t &other, const int_vector_t &add);
+  void update_edges_from(const person_vector_t &other, const int_vector_t &add);
   void print(FILE* fp);
   Group* get_group() {
     return this->group;
@@ -73,6 +212,12 @@ class Link {
     this->outward_timestamp.clear();
     this->inward_weight.clear();
     this->outward_weight.clear();
+    if (this->inward_index != NULL) {
+      this->inward_index->build();
+    }
+    if (this->outward_index != NULL) {
+      this->outward_index->build();
+    }
   }
 
   Person * get_inward_edge(int n) {
@@ -115,6 +260,10 @@ class Link {
   void unlink(Person* person);
 
  private:
+  bool has_edge_index();
+  void prepare_inward_index();
+  void prepare_outward_index();
+
   Group* group;
   int member_index;
 
@@ -127,6 +276,10 @@ class Link {
   double_vector_t inward_weight;
   double_vector_t outward_weight;
 
+  // built once the edge list has EDGE_INDEX_MIN_DEGREE edges, in a
+  // network with edge_index set
+  Edge_Index* inward_index;
+  Edge_Index* outward_index;
 };
 
 #endif // _FRED_LINK_H
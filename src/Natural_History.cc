@@ -21,8 +21,10 @@
 #include "Condition.h"
 #include "Clause.h"
 #include "Date.h"
+#include "Demographics.h"
 #include "Global.h"
 #include "Expression.h"
+#include "Factor.h"
 #include "Household.h"
 #include "Natural_History.h"
 #include "Network_Type.h"
@@ -36,6 +38,8 @@
 #include "State_Space.h"
 #include "Utils.h"
 
+#include <cmath>
+
 Natural_History::Natural_History() {
   this->transition_day = NULL;
   this->transition_date = NULL;
@@ -48,6 +52,7 @@ Natural_History::Natural_History() {
   this->R0_a = -1.0;
   this->R0_b = -1.0;
   this->action_rules = NULL;
+  this->action_plan = NULL;
   this->wait_rule = NULL;
   this->exposure_rule = NULL;
   this->next_rules = NULL;
@@ -58,6 +63,10 @@ Natural_History::Natural_History() {
   this->import_location_rule = NULL;
   this->import_admin_code_rule = NULL;
   this->count_all_import_attempts = NULL;
+  this->transition_covariates = NULL;
+  this->transition_table = NULL;
+  this->duration_covariates = NULL;
+  this->duration_table = NULL;
 }
 
 
@@ -315,8 +324,10 @@ void Natural_History::get_properties() {
   // RULES
 
   this->action_rules = new rule_vector_t [this->number_of_states];
+  this->action_plan = new action_plan_t [this->number_of_states];
   for (int state = 0; state < this->number_of_states; state++) {
     this->action_rules[state].clear();
+    this->action_plan[state].clear();
   }
   this->next_rules = new rule_vector_t* [this->number_of_states];
   for (int state = 0; state < this->number_of_states; state++) {
@@ -369,6 +380,8 @@ void Natural_History::prepare() {
 
   prepare_rules();
 
+  prepare_transition_tables();
+
   // read optional properties
   Property::disable_abort_on_failure();
 
@@ -487,6 +500,79 @@ void Natural_History::print() {
   }
 }
 
+// Returns the number of combinations of the given covariates.
+static int get_number_of_covariate_values(int covariates) {
+  int n = 1;
+  if (covariates & Covariate::AGE) {
+    n *= Demographics::MAX_AGE + 1;
+  }
+  if (covariates & Covariate::SEX) {
+    n *= 2;
+  }
+  if (covariates & Covariate::RACE) {
+    n *= Race::RACES + 1;
+  }
+  return n;
+}
+
+// Returns the index of the person's combination of the given covariates,
+// or -1 if any of the person's values is out of the tabulated range.
+static int get_covariate_index(Person* person, int covariates) {
+  int index = 0;
+  if (covariates & Covariate::AGE) {
+    int age = person->get_age();
+    if (age < 0 || Demographics::MAX_AGE < age) {
+      return -1;
+    }
+    index = age;
+  }
+  if (covariates & Covariate::SEX) {
+    index = 2 * index + (person->get_sex() == 'M');
+  }
+  if (covariates & Covariate::RACE) {
+    int race = person->get_race() + 1;
+    if (race < 0 || Race::RACES < race) {
+      return -1;
+    }
+    index = (Race::RACES + 1) * index + race;
+  }
+  return index;
+}
+
+void Natural_History::prepare_transition_tables() {
+
+  // classify the next rules and the duration of each state by the agent
+  // attributes they depend on. Since tables are indexed by the covariate
+  // values, an agent whose age changes simply moves to another entry.
+  this->transition_covariates = new int [this->number_of_states];
+  this->transition_table = new double_vector_t [this->number_of_states];
+  this->duration_covariates = new int [this->number_of_states];
+  this->duration_table = new double_vector_t [this->number_of_states];
+
+  for (int state = 0; state < this->number_of_states; ++state) {
+    int covariates = Covariate::NONE;
+    for (int next = 0; next < this->number_of_states; ++next) {
+      for (int n = 0; n < this->next_rules[state][next].size(); ++n) {
+	covariates |= this->next_rules[state][next][n]->get_covariates();
+      }
+    }
+    this->transition_covariates[state] = (covariates & Covariate::DYNAMIC) ? -1 : covariates;
+
+    this->duration_covariates[state] = -1;
+    if (this->duration_expression[state] != NULL) {
+      covariates = this->duration_expression[state]->get_covariates();
+      if ((covariates & Covariate::DYNAMIC) == 0) {
+	this->duration_covariates[state] = covariates;
+      }
+    }
+
+    FRED_VERBOSE(0, "Natural_History::prepare_transition_tables %s.%s transition_covariates %d duration_covariates %d\n",
+		 get_name(), get_state_name(state).c_str(),
+		 this->transition_covariates[state], this->duration_covariates[state]);
+  }
+}
+
+
 int Natural_History::get_next_transition_step(Person* person, int state, int day, int hour) {
   int step = 24*day + hour;
   int transition_step = step;
@@ -495,7 +581,25 @@ int Natural_History::get_next_transition_step(Person* person, int state, int day
 	       person->get_id(), state, day, hour);
 
   if (this->duration_expression[state]) {
-    double duration = this->duration_expression[state]->get_value(person);
+    double duration;
+    int index = -1;
+    if (0 <= this->duration_covariates[state]) {
+      index = get_covariate_index(person, this->duration_covariates[state]);
+    }
+    if (0 <= index) {
+      // tabulated duration; NaN marks entries not yet computed
+      double_vector_t & table = this->duration_table[state];
+      if (table.empty()) {
+	table.assign(get_number_of_covariate_values(this->duration_covariates[state]), NAN);
+      }
+      if (std::isnan(table[index])) {
+	table[index] = this->duration_expression[state]->get_value(person);
+      }
+      duration = table[index];
+    }
+    else {
+      duration = this->duration_expression[state]->get_value(person);
+    }
     transition_step += round(duration);
   }
   else if (0 <= this->transition_days[state]) {
@@ -527,6 +631,24 @@ int Natural_History::get_next_state(Person* person, int state) {
 
   // FRED_VERBOSE(0, "get_next_state entered day %d person %d current state %s\n", Global::Simulation_Day, person->get_id(), get_state_name(state).c_str());
 
+  // use the tabulated transition probabilities if they depend only on
+  // the agent's age, sex and race
+  double* table_entry = NULL;
+  if (0 <= this->transition_covariates[state]) {
+    int index = get_covariate_index(person, this->transition_covariates[state]);
+    if (0 <= index) {
+      double_vector_t & table = this->transition_table[state];
+      if (table.empty()) {
+	// the first probability of an entry is negative until it is computed
+	table.assign(get_number_of_covariate_values(this->transition_covariates[state]) * this->number_of_states, -1.0);
+      }
+      table_entry = &table[index * this->number_of_states];
+      if (0.0 <= table_entry[0]) {
+	return select_next_state(state, table_entry);
+      }
+    }
+  }
+
   double total = 0.0;
   double trans_prob [this->number_of_states];
   for(int next = 0; next < this->number_of_states; ++next) {
@@ -599,6 +721,12 @@ int Natural_History::get_next_state(Person* person, int state) {
     }
   }
 
+  if (table_entry != NULL) {
+    for(int next = 0; next < this->number_of_states; ++next) {
+      table_entry[next] = trans_prob[next];
+    }
+  }
+
   int next_state = select_next_state(state, trans_prob);
 
   assert(next_state > -1);
@@ -657,6 +785,7 @@ void Natural_History::prepare_rules() {
       if (0 <= state) {
 	rule->mark_as_used();
 	this->action_rules[state].push_back(rule);
+	this->action_plan[state].push_back(rule->get_action_step());
 
 	// CHECK FOR FATAL RULE
 	if (rule->get_action_id()==Rule_Action::DIE || rule->get_action_id()==Rule_Action::DIE_OLD) {
@@ -22,6 +22,7 @@
 #define _FRED_NATURAL_HISTORY_H
 
 #include "Global.h"
+#include "Rule.h"
 
 class Condition;
 class Expression;
@@ -52,6 +53,8 @@ public:
 
   void compile_rules();
 
+  void prepare_transition_tables();
+
   void print();
 
   Expression* get_duration_expression(int state) {
@@ -116,10 +119,14 @@ public:
     return this->place_type_to_quit[state];
   }
 
-  rule_vector_t get_action_rules(int state) {
+  const rule_vector_t& get_action_rules(int state) {
     return this->action_rules[state];
   }
 
+  const action_plan_t& get_action_plan(int state) {
+    return this->action_plan[state];
+  }
+
   int get_network_type(int state) {
     return this->network_type[state];
   }
@@ -221,6 +228,7 @@ protected:
 
   // RULES
   rule_vector_t* action_rules;
+  action_plan_t* action_plan;
   Rule** wait_rule;
   Rule* exposure_rule;
   rule_vector_t** next_rules;
@@ -285,6 +293,15 @@ protected:
   int* default_next_state;
   int* state_is_dormant;
 
+  // MEMOIZED TRANSITIONS
+  // Transition probabilities and durations that depend only on the agent's
+  // age, sex and race are computed once for each combination of those
+  // covariates. The covariates of each state are -1 if they are dynamic.
+  int* transition_covariates;
+  double_vector_t* transition_table;
+  int* duration_covariates;
+  double_vector_t* duration_table;
+
 };
 
 #endif
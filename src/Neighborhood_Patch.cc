@@ -226,114 +226,6 @@ void Neighborhood_Patch::quality_control() {
 }
 
 
-double Neighborhood_Patch::get_elevation(double lat, double lon) {
-
-  int size = this->elevation_sites.size();
-  // printf("Patch %d %d elevation sites %d\n", this->row, this->col, size);
-  if (size > 0) {
-
-    // use FCC interpolation from
-    // http://www.softwright.com/faq/support/Terrain%20Elevation%20Interpolation.html
-
-    // find the four elevation points closest to the target point
-    elevation_t* A = NULL;
-    elevation_t* B = NULL;
-    elevation_t* C = NULL;
-    elevation_t* D = NULL;
-    for (int i = 1; i < size; i++) {
-      elevation_t* e = this->elevation_sites[i];
-      if ((lat <= e->lat && e->lon <= lon) && (A==NULL || (e->lat <= A->lat && A->lon <= e->lon))) {
-	A = e;
-      }
-      if ((lat <= e->lat && lon < e->lon) && (B==NULL || (e->lat <= B->lat && e->lon <= B->lon))) {
-	B = e;
-      }
-      if ((e->lat <= lat && e->lon <= lon) && (C==NULL || (C->lat <= e->lat && C->lon <= e->lon))) {
-	C = e;
-      }
-      if ((e->lat <= lat && lon < e->lon) && (D==NULL || (D->lat <= e->lat && e->lon <= D->lon))) {
-	D = e;
-      }
-    }  
-    assert(A!=NULL || B!=NULL || C!=NULL || D!=NULL);
-
-    // interpolate on the lines AB and CD
-    double elev_E = -9999;
-    double lat_E = -999;
-    if (A==NULL) {
-      if (B!=NULL) {
-	elev_E = B->elevation;
-	lat_E = B->lat;
-      }
-    }
-    else if (B==NULL) {
-      if (A!=NULL) {
-	elev_E = A->elevation;
-	lat_E = A->lat;
-      }
-    }
-    else {
-      elev_E = ((B->lon - lon)*A->elevation + (lon - A->lon)*B->elevation)/(B->lon - A->lon);
-      lat_E = A->lat;
-    }
-
-    double elev_F = -9999;
-    double lat_F = -999;
-    if (C==NULL) {
-      if (D!=NULL) {
-	elev_F = D->elevation;
-	lat_F = D->lat;
-      }
-    }
-    else if (D==NULL) {
-      if (C!=NULL) {
-	elev_F = C->elevation;
-	lat_F = C->lat;
-      }
-    }
-    else {
-      elev_F = ((D->lon - lon)*C->elevation + (lon - C->lon)*D->elevation)/(D->lon - C->lon);
-      lat_F = C->lat;
-    }
-
-    // interpolate on the line EF
-    double elev_G;
-    if (elev_E < 0) {
-      elev_G = elev_F;
-    }
-    else if (elev_F < 0) {
-      elev_G = elev_E;
-    }
-    else {
-      if (lat_E > lat_F) {
-	elev_G = ((lat_E - lat)*elev_F + (lat - lat_F)*elev_E)/(lat_E - lat_F);
-      }
-      else {
-	elev_G = elev_F;
-      }
-    }
-    if (elev_G < -9000) {
-      printf("HELP! lat_E %f lat_F %f elev_E %f elev_F %f elev_G %f\n", lat_E,lat_F,elev_E,elev_F,elev_G); fflush(stdout);
-      assert(elev_G >= -9000);
-    }
-    return elev_G;
-
-    // use closest elevation site
-    double min_dist = Geo::xy_distance(lat, lon, this->elevation_sites[0]->lat, this->elevation_sites[0]->lon);
-    int min_dist_index = 0;
-    for (int i = 1; i < size; i++) {
-      double dist = Geo::xy_distance(lat, lon, this->elevation_sites[i]->lat, this->elevation_sites[i]->lon);
-      if (dist < min_dist) {
-	min_dist = dist;
-	min_dist_index = i;
-      }
-    }
-    return this->elevation_sites[min_dist_index]->elevation;
-  }
-  else {
-    return 0.0;
-  }
-}
 
 place_vector_t Neighborhood_Patch::get_places_at_distance(int type_id, int dist) {
   place_vector_t results;
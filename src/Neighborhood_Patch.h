@@ -141,20 +141,6 @@ public:
     }
   }
 
-  void add_elevation_site(double lat, double lon, double elev) {
-    elevation_t *elevation_ptr = new elevation_t;
-    elevation_ptr->lat = lat;
-    elevation_ptr->lon = lon;
-    elevation_ptr->elevation = elev;
-    this->elevation_sites.push_back(elevation_ptr);
-  }
-
-  void add_elevation_site(elevation_t *esite) {
-    this->elevation_sites.push_back(esite);
-  }
-
-  double get_elevation(double lat, double lon);
-
   void add_place(Place* place);
 
   place_vector_t get_places(int type_id) {
@@ -169,7 +155,6 @@ private:
   person_vector_t person;
   int popsize;
   long long int admin_code;
-  std::vector<elevation_t*> elevation_sites;
 
   // lists of places by type
   place_vector_t schools_attended_by_neighborhood_residents;
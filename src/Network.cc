@@ -30,29 +30,317 @@
 #include "Person.h"
 #include "Property.h"
 #include "Random.h"
+#include "Utils.h"
 
 Network::Network(const char* lab, int _type_id, Network_Type* net_type) : Group(lab, _type_id) {
   this->network_type = net_type;
 }
 
 void Network::read_edges() {
+  edge_record_vector_t edges;
+
+  // edges given as <network>.add_edge = p1 p2 in the program file
   pair_vector_t results = Property::get_edges(this->get_label());
   for(int i = 0; i < results.size(); ++i) {
-    int p1 = results[i].first;
-    int p2 = results[i].second;
-    printf("%s.add_edge %d %d\n", this->get_label(), p1, p2);
-    Person* person1 = Person::get_person(p1);
-    Person* person2 = Person::get_person(p2);
-    if(p1 == p2) {
-      person1->join_network(this);
-    } else {
-      person1->join_network(this);
-      person2->join_network(this);
-      person1->add_edge_to(person2, this);
-      person2->add_edge_from(person1, this);
-      if(this->is_undirected()) {
-        person2->add_edge_to(person1, this);
-        person1->add_edge_from(person2, this);
+    edge_record_t edge;
+    edge.from = results[i].first;
+    edge.to = results[i].second;
+    edge.weight = 1.0;
+    edge.timestamp = Global::Simulation_Step;
+    edges.push_back(edge);
+  }
+
+  // edges given in <network>.edge_file
+  char filename[FRED_STRING_SIZE];
+  strcpy(filename, this->network_type->get_edge_file());
+  if (strcmp(filename, "none") != 0 && Global::Compile_FRED == 0) {
+    read_edge_file(filename, &edges);
+  }
+
+  add_edges(&edges);
+  FRED_STATUS(0, "network %s read %d edges, size = %d\n",
+	      this->get_label(), (int) edges.size(), this->get_size());
+}
+
+// Edge files contain one edge per line:
+//
+//   p1 p2 [weight [timestamp]]
+//
+// where p1 and p2 are person indices. Blank lines and lines starting with
+// '#' are ignored, and lines written by Network::print (<network>.add_edge
+// = p1 p2 weight) are also accepted. A binary edge file starts with the
+// 8-byte magic string FREDEDGE, followed by an int32 version (1), an int32
+// flag word (1 = has weights, 2 = has timestamps), an int64 edge count n,
+// and then the columns int32 from[n], int32 to[n], optionally double
+// weight[n] and int32 timestamp[n].
+
+static const size_t EDGE_CHUNK_SIZE = 1 << 22;
+
+void Network::read_edge_file(char* filename, edge_record_vector_t* edges) {
+  std::vector<char> text;
+  if (Utils::fred_read_file(filename, &text) == false) {
+    Utils::fred_abort("edge_file %s not readable\n", filename);
+  }
+  size_t size = text.size() - 1;
+  const char* data = text.data();
+  int first = edges->size();
+
+  if (size >= 8 && memcmp(data, "FREDEDGE", 8) == 0) {
+    int32_t version, flags;
+    int64_t n;
+    if (size < 24) {
+      Utils::fred_abort("edge_file %s: truncated header\n", filename);
+    }
+    memcpy(&version, data + 8, 4);
+    memcpy(&flags, data + 12, 4);
+    memcpy(&n, data + 16, 8);
+    size_t record_size = 8 + ((flags & 1) ? 8 : 0) + ((flags & 2) ? 4 : 0);
+    if (version != 1 || n < 0 || size < 24 + n * record_size) {
+      Utils::fred_abort("edge_file %s: bad header or truncated data\n", filename);
+    }
+    const char* from = data + 24;
+    const char* to = from + 4 * n;
+    const char* weight = to + 4 * n;
+    const char* timestamp = weight + ((flags & 1) ? 8 * n : 0);
+    edges->resize(first + n);
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; ++i) {
+      edge_record_t* edge = &(*edges)[first + i];
+      int32_t value;
+      memcpy(&value, from + 4 * i, 4);
+      edge->from = value;
+      memcpy(&value, to + 4 * i, 4);
+      edge->to = value;
+      edge->weight = 1.0;
+      if (flags & 1) {
+	memcpy(&edge->weight, weight + 8 * i, 8);
+      }
+      edge->timestamp = Global::Simulation_Step;
+      if (flags & 2) {
+	memcpy(&value, timestamp + 4 * i, 4);
+	edge->timestamp = value;
+      }
+    }
+  }
+  else {
+    // parse chunks of lines concurrently, then append them in file order
+    std::vector<size_t> bounds;
+    Utils::fred_split_lines(data, 0, size, EDGE_CHUNK_SIZE, &bounds);
+    int chunks = bounds.size() - 1;
+    edge_record_vector_t* records = new edge_record_vector_t [chunks];
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < chunks; ++k) {
+      const char* line = data + bounds[k];
+      const char* chunk_end = data + bounds[k + 1];
+      while (line < chunk_end) {
+	const char* end = (const char*) memchr(line, '\n', chunk_end - line);
+	if (end == NULL) {
+	  end = chunk_end;
+	}
+	const char* token[6];
+	int n = Utils::fred_get_tokens(line, end, token, 6);
+	int t = 0;
+	if (n >= 4 && token[1][0] == '=' && Utils::fred_get_token_length(token[1]) == 1) {
+	  // <network>.add_edge = p1 p2 ...
+	  t = 2;
+	}
+	if (n - t >= 2 && token[0][0] != '#') {
+	  edge_record_t edge;
+	  edge.from = atoi(token[t]);
+	  edge.to = atoi(token[t + 1]);
+	  edge.weight = (n - t > 2) ? atof(token[t + 2]) : 1.0;
+	  edge.timestamp = (n - t > 3) ? atoi(token[t + 3]) : Global::Simulation_Step;
+	  records[k].push_back(edge);
+	}
+	line = end + 1;
+      }
+    }
+    for (int k = 0; k < chunks; ++k) {
+      edges->insert(edges->end(), records[k].begin(), records[k].end());
+    }
+    delete[] records;
+  }
+
+  FRED_VERBOSE(0, "network %s read %d edges from %s\n",
+	       this->get_label(), (int) edges->size() - first, filename);
+}
+
+void Network::add_edges(edge_record_vector_t* edges) {
+  int size = edges->size();
+  bool undirected = this->is_undirected();
+
+  // check the person indices
+  int pop_size = Person::get_population_size();
+  for (int i = 0; i < size; ++i) {
+    edge_record_t* edge = &(*edges)[i];
+    if (edge->from < 0 || edge->from >= pop_size || edge->to < 0 || edge->to >= pop_size) {
+      Utils::fred_abort("network %s: edge %d %d refers to an unknown person\n",
+			this->get_label(), edge->from, edge->to);
+    }
+  }
+
+  // join the network in order of first appearance
+  for (int i = 0; i < size; ++i) {
+    Person::get_person((*edges)[i].from)->join_network(this);
+    Person::get_person((*edges)[i].to)->join_network(this);
+  }
+
+  // directed edges in the order they would be added one at a time; for
+  // undirected networks each edge is followed by its reverse
+  std::vector<int> order;
+  std::vector<bool> reverse;
+  order.reserve(undirected ? 2 * size : size);
+  reverse.reserve(undirected ? 2 * size : size);
+  for (int i = 0; i < size; ++i) {
+    if ((*edges)[i].from != (*edges)[i].to) {
+      order.push_back(i);
+      reverse.push_back(false);
+      if (undirected) {
+	order.push_back(i);
+	reverse.push_back(true);
+      }
+    }
+  }
+
+  // keep only the first occurrence of each directed edge
+  int m = order.size();
+  std::vector<std::pair<long long int, int> > key(m);
+  for (int j = 0; j < m; ++j) {
+    edge_record_t* edge = &(*edges)[order[j]];
+    long long int p1 = reverse[j] ? edge->to : edge->from;
+    long long int p2 = reverse[j] ? edge->from : edge->to;
+    key[j] = std::make_pair((p1 << 32) | p2, j);
+  }
+  std::sort(key.begin(), key.end());
+  std::vector<bool> keep(m, false);
+  for (int j = 0; j < m; ++j) {
+    if (j == 0 || key[j].first != key[j-1].first) {
+      keep[key[j].second] = true;
+    }
+  }
+  key.clear();
+
+  // count the degrees so that each adjacency list is allocated once
+  std::vector<int> out_degree(pop_size, 0);
+  std::vector<int> in_degree(pop_size, 0);
+  for (int j = 0; j < m; ++j) {
+    if (keep[j]) {
+      edge_record_t* edge = &(*edges)[order[j]];
+      out_degree[reverse[j] ? edge->to : edge->from]++;
+      in_degree[reverse[j] ? edge->from : edge->to]++;
+    }
+  }
+  for (int p = 0; p < pop_size; ++p) {
+    if (out_degree[p] > 0 || in_degree[p] > 0) {
+      Person::get_person(p)->reserve_edges(this, out_degree[p], in_degree[p]);
+    }
+  }
+
+  for (int j = 0; j < m; ++j) {
+    if (keep[j]) {
+      edge_record_t* edge = &(*edges)[order[j]];
+      Person* person1 = Person::get_person(reverse[j] ? edge->to : edge->from);
+      Person* person2 = Person::get_person(reverse[j] ? edge->from : edge->to);
+      person1->append_edge_to(person2, this, edge->weight, edge->timestamp);
+      person2->append_edge_from(person1, this, edge->weight, edge->timestamp);
+    }
+  }
+}
+
+bool Network::has_deferred_edges() {
+  return this->network_type->has_deferred_edges();
+}
+
+bool Network::has_edge_index() {
+  return this->network_type->has_edge_index();
+}
+
+// In a network with deferred edges, rules do not change the adjacency
+// lists directly. Each edit is logged, and the log is applied once per
+// simulation step, so edges added or deleted during a step are seen by
+// other rules only in later steps.
+
+void Network::log_edge_edit(Person* from, Person* to, bool add) {
+  if (from == NULL || to == NULL) {
+    return;
+  }
+  edge_edit_t edit = { from, to, add };
+  this->edge_edit_log.push_back(edit);
+  if (this->is_undirected()) {
+    edit.from = to;
+    edit.to = from;
+    this->edge_edit_log.push_back(edit);
+  }
+}
+
+void Network::apply_edge_edits() {
+  int size = this->edge_edit_log.size();
+  if (size == 0) {
+    return;
+  }
+
+  // people join the network in order of their first added edge, even
+  // if the edge is later deleted. Keep only the last edit of each directed
+  // edge, and ignore edges of people who died during the step.
+  std::vector<std::pair<long long int, int> > key;
+  key.reserve(size);
+  for (int j = 0; j < size; ++j) {
+    edge_edit_t* edit = &this->edge_edit_log[j];
+    if (edit->from->is_deceased() || edit->to->is_deceased()) {
+      continue;
+    }
+    if (edit->add) {
+      edit->from->join_network(this);
+      edit->to->join_network(this);
+    }
+    long long int p1 = edit->from->get_id();
+    long long int p2 = edit->to->get_id();
+    key.push_back(std::make_pair((p1 << 32) | p2, j));
+  }
+  std::sort(key.begin(), key.end());
+  edge_edit_vector_t edits;
+  edits.reserve(key.size());
+  for (int j = 0; j < key.size(); ++j) {
+    if (j + 1 == key.size() || key[j].first != key[j+1].first) {
+      edits.push_back(this->edge_edit_log[key[j].second]);
+    }
+  }
+  this->edge_edit_log.clear();
+
+  // rebuild the outward edges of each source, then the inward edges of
+  // each destination, in one pass per person
+  int m = edits.size();
+  person_vector_t other;
+  int_vector_t add;
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      key.clear();
+      for (int j = 0; j < m; ++j) {
+	long long int p1 = edits[j].to->get_id();
+	long long int p2 = edits[j].from->get_id();
+	key.push_back(std::make_pair((p1 << 32) | p2, j));
+      }
+      std::sort(key.begin(), key.end());
+    }
+    int j = 0;
+    while (j < m) {
+      edge_edit_t* first = &edits[pass == 0 ? j : key[j].second];
+      Person* person = pass == 0 ? first->from : first->to;
+      other.clear();
+      add.clear();
+      for (; j < m; ++j) {
+	edge_edit_t* edit = &edits[pass == 0 ? j : key[j].second];
+	if ((pass == 0 ? edit->from : edit->to) != person) {
+	  break;
+	}
+	other.push_back(pass == 0 ? edit->to : edit->from);
+	add.push_back(edit->add);
+      }
+      if (pass == 0) {
+	person->update_edges_to(this, other, add);
+      }
+      else {
+	person->update_edges_from(this, other, add);
       }
     }
   }
@@ -202,6 +490,14 @@ void Network::randomize(double mean_degree, int max_degree) {
   FRED_DEBUG(0, "RANDOMIZE size = %d  edges = %d\n\n", size, number_edges);
   int edges = 0;
   int found = 1;
+
+  // candidates are drawn by a Fisher-Yates shuffle that is only carried
+  // as far as needed to find a qualified destination
+  std::vector<int> shuffle_index(size);
+  for(int i = 0; i < size; ++i) {
+    shuffle_index[i] = i;
+  }
+
   while(edges < number_edges && found==1) {
     found = 0;
     int pos1 = Random::draw_random_int(0, size - 1);
@@ -215,18 +511,12 @@ void Network::randomize(double mean_degree, int max_degree) {
 
     // get a qualified destination
 
-    // shuffle the order of candidates
-    std::vector<int> shuffle_index;
-    shuffle_index.clear();
-    shuffle_index.reserve(size);
-    for(int i = 0; i < size; ++i) {
-      shuffle_index.push_back(i);
-    }
-    FYShuffle<int>(shuffle_index);
-
     int index = 0;
     while(index < size && found == 0) {
-      int pos = shuffle_index[index];
+      int next = Random::draw_random_int(index, size - 1);
+      int pos = shuffle_index[next];
+      shuffle_index[next] = shuffle_index[index];
+      shuffle_index[index] = pos;
       Person* dest = get_member(pos);
       if(dest == src) {
         ++index;
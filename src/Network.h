@@ -33,6 +33,23 @@ class Condition;
 class Preference;
 class Network_Type;
 
+// an edge read from the program file or from an edge file
+typedef struct {
+  int from;
+  int to;
+  double weight;
+  int timestamp;
+} edge_record_t;
+typedef std::vector<edge_record_t> edge_record_vector_t;
+
+// an edge added or deleted by a rule in a network with deferred edges
+typedef struct {
+  Person* from;
+  Person* to;
+  bool add;
+} edge_edit_t;
+typedef std::vector<edge_edit_t> edge_edit_vector_t;
+
 class Network : public Group {
 public: 
 
@@ -53,6 +70,12 @@ public:
 
   bool is_undirected();
   void read_edges();
+  void read_edge_file(char* filename, edge_record_vector_t* edges);
+  void add_edges(edge_record_vector_t* edges);
+  bool has_deferred_edges();
+  bool has_edge_index();
+  void log_edge_edit(Person* from, Person* to, bool add);
+  void apply_edge_edits();
 
   Network_Type* get_network_type() {
     return this->network_type;
@@ -73,6 +96,7 @@ public:
 protected:
   pair_vector_t edge;
   Network_Type* network_type;
+  edge_edit_vector_t edge_edit_log;
   // string_vector_t pool_str;
   // int_vector_t pool;
   // clause_vector_t requirements;
@@ -63,14 +63,16 @@ void Network_Transmission::transmission(int day, int hour, int condition_id, Gro
   FRED_VERBOSE(0, "network_transmission: day %d hour %d network %s transmissibles %d\n",
       day, hour, group->get_label(), (int) transmissible->size());
 
-  // randomize the order of processing the transmissible list
-  std::vector<int> shuffle_index;
-  shuffle_index.clear();
-  shuffle_index.reserve(number_of_transmissibles);
-  for(int i = 0; i < number_of_transmissibles; ++i) {
-    shuffle_index.push_back(i);
+  // under common random numbers, the order is keyed by the network and
+  // each source draws from a stream keyed by the source and the network
+  RNG* previous_stream = Random::get_stream();
+  if(Global::Enable_Common_Random_Numbers) {
+    use_keyed_stream(RANDOM_SITE_NETWORK_ORDER, network->get_id(), condition_id, day, hour, 0);
   }
-  FYShuffle<int>(shuffle_index);
+
+  // randomize the order of processing the transmissible list
+  int_vector_t &shuffle_index = Transmission::source_order;
+  get_random_order(number_of_transmissibles, &shuffle_index);
 
   for(int n = 0; n < number_of_transmissibles; ++n) {
     int source_pos = shuffle_index[n];
@@ -83,8 +85,21 @@ void Network_Transmission::transmission(int day, int hour, int condition_id, Gro
       continue;
     }
 
-    // get the other agents connected to the source
-    person_vector_t other = source->get_outward_edges(network, 1);
+    if(Global::Enable_Common_Random_Numbers) {
+      use_keyed_stream(RANDOM_SITE_NETWORK_SOURCE, source->get_id(), condition_id, day, hour, network->get_id());
+    }
+
+    // get the other agents connected to the source (the import agent
+    // joins the network when it exposes someone, but cannot be infected)
+    person_vector_t &other = Transmission::contacts;
+    other.clear();
+    int out_degree = source->get_out_degree(network);
+    for(int j = 0; j < out_degree; ++j) {
+      Person* person = source->get_outward_edge(j, network);
+      if(person != source && person->is_meta_agent() == false) {
+        other.push_back(person);
+      }
+    }
     int others = other.size();
     FRED_DEBUG(0, "source id %d has %d out_links\n", source->get_id(), others);
     if(others == 0) {
@@ -117,15 +132,15 @@ void Network_Transmission::transmission(int day, int hour, int condition_id, Gro
 
     int condition_to_transmit = condition->get_condition_to_transmit(source->get_state(condition_id));
 
-    std::vector<int> shuffle_index;
+    int_vector_t &contact_index = Transmission::contact_order;
     if(group->use_deterministic_contacts(condition_id)) {
-      // randomize the order of contacts among others
-      shuffle_index.clear();
-      shuffle_index.reserve(others);
-      for(int i = 0; i < others; ++i) {
-        shuffle_index.push_back(i);
+      if(contact_count < others) {
+        // choose the contacts among others without replacement
+        get_random_sample(others, contact_count, &contact_index);
+      } else {
+        // contact everyone, cycling through a random order
+        get_random_order(others, &contact_index);
       }
-      FYShuffle<int>(shuffle_index);
     }
 
     // get a destination for each contact
@@ -134,7 +149,7 @@ void Network_Transmission::transmission(int day, int hour, int condition_id, Gro
       int pos = 0;
       if (group->use_deterministic_contacts(condition_id)) {
         // select an agent from among the others without replacement
-        pos = shuffle_index[count % others];
+        pos = contact_index[count % others];
       } else {
         // select an agent from among the others with replacement
         pos = Random::draw_random_int(0, others - 1);
@@ -162,6 +177,7 @@ void Network_Transmission::transmission(int day, int hour, int condition_id, Gro
       }
     } // end contact loop
   } // end transmissible list loop
+  Random::use_stream(previous_stream);
 
   if(new_exposures > 0) {
     FRED_VERBOSE(0, "network_transmission day %d hour %d network %s gives %d new_exposures\n", day, hour, group->get_label(), new_exposures);
@@ -48,6 +48,7 @@ Network_Type::Network_Type(int type_id, string _name) : Group_Type(_name) {
   this->network = new Network(_name.c_str(), type_id, this);
   this->print_interval = 0;
   this->next_print_day = 999999;
+  strcpy(this->edge_file, "none");
   Group_Type::add_group_type(this);
 }
 
@@ -117,12 +118,25 @@ void Network_Type::get_properties() {
   Property::get_property(property_name, &n);
   this->undirected = n;
 
+  sprintf(property_name, "%s.deferred_edges", this->name.c_str());
+  n = 0;
+  Property::get_property(property_name, &n);
+  this->deferred_edges = n;
+
+  sprintf(property_name, "%s.edge_index", this->name.c_str());
+  n = 0;
+  Property::get_property(property_name, &n);
+  this->edge_index = n;
+
   sprintf(property_name, "%s.print_interval", this->name.c_str());
   Property::get_property(property_name, &this->print_interval);
   if (this->print_interval > 0) {
     this->next_print_day = 0;
   }
 
+  sprintf(property_name, "%s.edge_file", this->name.c_str());
+  Property::get_property(property_name, this->edge_file);
+
   Property::set_abort_on_failure();
 
   FRED_STATUS(0, "network_type %s read_properties finished\n", this->name.c_str());
@@ -147,6 +161,15 @@ void Network_Type::print_network_types(int day) {
   }
 }
 
+void Network_Type::apply_edge_edits() {
+  for(int index = 0; index < Network_Type::get_number_of_network_types(); ++index) {
+    Network* network = Network_Type::network_types[index]->get_network();
+    if (network->has_deferred_edges()) {
+      network->apply_edge_edits();
+    }
+  }
+}
+
 void Network_Type::finish_network_types() {
   for(int index = 0; index < Network_Type::get_number_of_network_types(); ++index) {
     if (Network_Type::network_types[index]->print_interval > 0) {
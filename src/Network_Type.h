@@ -57,6 +57,18 @@ public:
     return this->undirected;
   }
 
+  bool has_deferred_edges() {
+    return this->deferred_edges;
+  }
+
+  bool has_edge_index() {
+    return this->edge_index;
+  }
+
+  char* get_edge_file() {
+    return this->edge_file;
+  }
+
   // static methods
 
   static void get_network_type_properties();
@@ -139,6 +151,8 @@ public:
 
   static void print_network_types(int day);
 
+  static void apply_edge_edits();
+
   static void finish_network_types();
 
 private:
@@ -150,6 +164,15 @@ private:
   int id;
   bool undirected;
 
+  // edges added or deleted by rules are applied at the end of each step
+  bool deferred_edges;
+
+  // each person's edges are indexed by neighbor, weight and timestamp
+  bool edge_index;
+
+  // optional file of predefined edges
+  char edge_file[FRED_STRING_SIZE];
+
   // each network type has one network
   Network* network;
 
@@ -27,6 +27,7 @@
 
 #include "Census_Tract.h"
 #include "Clause.h"
+#include "Compressed_Stream.h"
 #include "Condition.h"
 #include "County.h"
 #include "Date.h"
@@ -57,6 +58,7 @@
 #include <vector>
 #include <sstream>
 #include <unordered_set>
+#include <unistd.h>
 
 // static variables
 person_vector_t Person::people;
@@ -73,6 +75,7 @@ int Person::next_meta_id = -1;
 Person* Person::Import_agent = NULL;
 std::unordered_map<Person*, Group*> Person::admin_group_map;
 bool Person::record_location = false;
+thread_local int_vector_t Person::placemate_sample;
   
 // personal variables
 std::vector<std::string> Person::var_name;
@@ -97,6 +100,7 @@ int Person::enable_copy_files = 0;
 int Person::report_initial_population = 0;
 int Person::output_population = 0;
 char Person::pop_outfile[FRED_STRING_SIZE];
+char Person::output_population_format[FRED_STRING_SIZE] = "text";
 char Person::output_population_date_match[FRED_STRING_SIZE];
 int Person::Popsize_by_age [Demographics::MAX_AGE+1];
 
@@ -109,6 +113,9 @@ Person::Person() {
   this->id = -1;
   this->index = -1;
   this->eligible_to_migrate = true;
+  this->county_index_pos = -1;
+  this->county_index_county = -1;
+  this->county_index_age = -1;
   this->native = true;
   this->original = false;
   this->vaccine_refusal = false;
@@ -349,14 +356,7 @@ void Person::quit_place_of_type(int place_type_id) {
 	       size);
 
   // decrement the group_state_counts associated with this place
-  if (place!=NULL) {
-    for (int cond_id = 0; cond_id < Condition::get_number_of_conditions(); cond_id++) {
-      int state = get_state(cond_id);
-      // printf("decrementing_group_state_count for person %d for cond %d state %d place %s\n",
-      // this->id, cond_id, state, place->get_label());
-      Condition::get_condition(cond_id)->decrement_group_state_count(place_type_id, place, state);
-    }
-  }
+  Condition::decrement_group_state_counts(this, place_type_id, place);
 
   set_activity_group(place_type_id, NULL);
   FRED_VERBOSE(1,"HEALTH RECORD: %s %s day %d person %d QUITS PLACE type %s label %s new size = %d\n",
@@ -399,14 +399,7 @@ void Person::select_place_of_type(int place_type_id) {
   set_activity_group(place_type_id, place);
 
   // increment the group_state_counts associated with this place
-  if (place!=NULL) {
-    for (int cond_id = 0; cond_id < Condition::get_number_of_conditions(); cond_id++) {
-      int state = get_state(cond_id);
-      // printf("incrementing_group_state_count for person %d for cond %d state %d place %s\n",
-      // this->id, cond_id, state, place->get_label());
-      Condition::get_condition(cond_id)->increment_group_state_count(place_type_id, place, state);
-    }
-  }
+  Condition::increment_group_state_counts(this, place_type_id, place);
   FRED_VERBOSE(1,"HEALTH RECORD: %s %s day %d person %d JOINS PLACE type %s label %s new size = %d\n",
 	       Date::get_date_string().c_str(),
 	       Date::get_12hr_clock().c_str(),
@@ -516,25 +509,12 @@ person_vector_t Person::get_placemates(int place_type_id, int maxn) {
       }
     }
     else {
-      // randomize the order of processing the members
-      std::vector<int> shuffle_index;
-      shuffle_index.clear();
-      shuffle_index.reserve(size);
-      for(int i = 0; i < size; ++i) {
-	shuffle_index.push_back(i);
-      }
-      FYShuffle<int>(shuffle_index);
-      /*
-      printf("shuffle: ");
-      for(int i = 0; i < size; ++i) {
-	printf("%d ", shuffle_index[i]);
-      }
-      printf("\n");
-      */
-
-      // return the first maxn
+      // return a random sample of maxn members
+      int_vector_t &sample = Person::placemate_sample;
+      sample.resize(maxn);
+      Random::sample_range_without_replacement(size, maxn, sample.data());
       for (int i = 0; i < maxn; i++) {
-	result.push_back(place->get_member(shuffle_index[i]));
+	result.push_back(place->get_member(sample[i]));
       }
     }
   }
@@ -599,6 +579,7 @@ void Person::get_population_properties() {
   Property::get_property("report_initial_population", &Person::report_initial_population);
   Property::get_property("output_population", &Person::output_population);
   Property::get_property("pop_outfile", Person::pop_outfile);
+  Property::get_property("output_population_format", Person::output_population_format);
   Property::get_property("output_population_date_match",
 		    Person::output_population_date_match);
   Property::get_property("max_reporting_agents", &Person::max_reporting_agents);
@@ -673,6 +654,7 @@ Person* Person::add_person_to_population(int age, char sex, int race, int rel,
   Person::people.push_back(person);
   Person::pop_size = Person::people.size();
   Person::id_map.push_back(idx);
+  County::add_to_resident_index(person);
   return person;
 }
 
@@ -803,159 +785,246 @@ void Person::setup() {
   FRED_STATUS(0, "population setup finished\n", "");
 }
 
-void Person::get_person_data(char* line, bool gq) {
+bool Person::get_person_record(const char* line, const char* end, bool gq, person_record_t* record) {
 
-  // FRED_STATUS(0, "get_person_data %s\n", line);
-  int day = Global::Simulation_Day;
+  // fields: label house age sex race relationship school work
+  // or, for group quarters: label gq age sex
+  const char* token[8];
+  int n = Utils::fred_get_tokens(line, end, token, 8);
 
-  // person data
-  char label[FRED_STRING_SIZE];
-  Place* house = NULL;
-  Place* work = NULL;
-  Place* school = NULL;
-  int age = -1;
-  int race = -1;
-  int household_relationship = -1;
-  char sex = 'X';
-  bool today_is_birthday = false;
+  // skip empty lines and header lines ...
+  if (n < 2
+      || (strncmp(token[0], "sp_id", 5) == 0 && Utils::fred_get_token_length(token[0]) == 5)
+      || (strncmp(token[0], "per_id", 6) == 0 && Utils::fred_get_token_length(token[0]) == 6)) {
+    return false;
+  }
 
-  // place labels
-  char house_label[FRED_STRING_SIZE];
-  char school_label[FRED_STRING_SIZE];
-  char work_label[FRED_STRING_SIZE];
-  char gq_label[FRED_STRING_SIZE];
-  char tmp_house_label[FRED_STRING_SIZE];
-  char tmp_school_label[FRED_STRING_SIZE];
-  char tmp_work_label[FRED_STRING_SIZE];
+  record->line = line;
+  record->house = NULL;
+  record->school = NULL;
+  record->work = NULL;
+  record->age = n > 2 ? atoi(token[2]) : -1;
+  record->sex = n > 3 ? token[3][0] : 'X';
+  record->race = -1;
+  record->relationship = -1;
+  record->gq = gq;
+  record->has_school_label = false;
+  record->has_work_label = false;
 
-  strcpy(label, "X");
-  strcpy(house_label, "X");
-  strcpy(school_label, "X");
-  strcpy(work_label, "X");
+  char label[FRED_STRING_SIZE];
+  int len = Utils::fred_get_token_length(token[1]);
+  if (len > FRED_STRING_SIZE - 4) {
+    return true;
+  }
 
   if (gq) {
-    sscanf(line, "%s %s %d %c", label, gq_label, &age, &sex);
-    sprintf(house_label, "GH-%s", gq_label);
-    sprintf(work_label, "GW-%s", gq_label);
+    sprintf(label, "GH-%.*s", len, token[1]);
+    record->house = Place::get_household_from_label(label);
+    sprintf(label, "GW-%.*s", len, token[1]);
+    record->work = Place::get_workplace_from_label(label);
+    record->has_work_label = true;
+    return true;
   }
-  else {
-    sscanf(line, "%s %s %d %c %d %d %s %s", label, tmp_house_label, &age, &sex, &race, &household_relationship, tmp_school_label, tmp_work_label);
-    sprintf(house_label, "H-%s", tmp_house_label);
-    sprintf(work_label, "W-%s", tmp_work_label);
-    sprintf(school_label, "S-%s", tmp_school_label);
+
+  if (n > 4) {
+    record->race = atoi(token[4]);
+  }
+  if (n > 5) {
+    record->relationship = atoi(token[5]);
   }
 
-  // FRED_VERBOSE(0,"GET_PERSON_DATA %s %s %d %c %d %d %s %s\n", label, house_label, age, (char) sex, race, household_relationship, school_label, work_label); fflush(stdout);
+  sprintf(label, "H-%.*s", len, token[1]);
+  record->house = Place::get_household_from_label(label);
 
-  if (strcmp(tmp_school_label,"X") != 0 && Global::GRADES <= age) {
-    // person is too old for schools in FRED!
-    FRED_VERBOSE(0, "WARNING: person %s age %d is too old to attend school %s\n",
-		 label,
-		 age,
-		 school_label);
-    // reset school _label
-    strcpy(school_label, "X");
+  if (n > 6) {
+    len = Utils::fred_get_token_length(token[6]);
+    record->has_school_label = (len != 1 || token[6][0] != 'X');
+    // people too old for schools in FRED are not assigned to a school
+    if (record->has_school_label && len < FRED_STRING_SIZE - 4 && record->age < Global::GRADES) {
+      sprintf(label, "S-%.*s", len, token[6]);
+      record->school = Place::get_school_from_label(label);
+    }
   }
 
-  // set pointer to primary places in init data object
-  house = Place::get_household_from_label(house_label);
-  // FRED_VERBOSE(0, "get_household_from_label ok\n");
-  work =  Place::get_workplace_from_label(work_label);
-  school = Place::get_school_from_label(school_label);
+  if (n > 7) {
+    len = Utils::fred_get_token_length(token[7]);
+    record->has_work_label = (len != 1 || token[7][0] != 'X');
+    if (record->has_work_label && len < FRED_STRING_SIZE - 4) {
+      sprintf(label, "W-%.*s", len, token[7]);
+      record->work = Place::get_workplace_from_label(label);
+    }
+  }
+
+  return true;
+}
 
-  if(house == NULL) {
+void Person::add_person_record(person_record_t* record) {
+
+  int day = Global::Simulation_Day;
+  bool today_is_birthday = false;
+
+  // tokens of the input line, needed only for warnings
+  const char* token[8];
+  int n = 0;
+  if (record->house == NULL || (record->has_school_label && (record->school == NULL || Global::GRADES <= record->age))
+      || (record->has_work_label && record->work == NULL)) {
+    n = Utils::fred_get_tokens(record->line, record->line + FRED_STRING_SIZE, token, 8);
+  }
+  int work_token = record->gq ? 1 : 7;
+
+  if (record->has_school_label && Global::GRADES <= record->age) {
+    // person is too old for schools in FRED!
+    FRED_VERBOSE(0, "WARNING: person %.*s age %d is too old to attend school S-%.*s\n",
+		 Utils::fred_get_token_length(token[0]), token[0], record->age,
+		 Utils::fred_get_token_length(token[6]), token[6]);
+  }
+
+  if(record->house == NULL) {
     // we need at least a household (homeless people not yet supported), so
     // skip this person
-    FRED_VERBOSE(0, "WARNING: skipping person %s -- %s %s\n", label,
-		 "no household found for label =", house_label);
+    FRED_VERBOSE(0, "WARNING: skipping person %.*s -- %s %s%.*s\n",
+		 Utils::fred_get_token_length(token[0]), token[0],
+		 "no household found for label =", record->gq ? "GH-" : "H-",
+		 Utils::fred_get_token_length(token[1]), token[1]);
     return;
   }
 
   // warn if we can't find workplace
-  if(strcmp(tmp_work_label, "X") != 0 && work == NULL) {
-    FRED_VERBOSE(2, "WARNING: person %s -- no workplace found for label = %s\n", label,
-		 work_label);
+  Place* work = record->work;
+  if(record->has_work_label && work == NULL && work_token < n) {
+    FRED_VERBOSE(2, "WARNING: person %.*s -- no workplace found for label = %s%.*s\n",
+		 Utils::fred_get_token_length(token[0]), token[0], record->gq ? "GW-" : "W-",
+		 Utils::fred_get_token_length(token[work_token]), token[work_token]);
     if(Global::Enable_Local_Workplace_Assignment) {
       work = Place::get_random_workplace();
       if (work != NULL) {
-	FRED_VERBOSE(0, "WARNING: person %s assigned to workplace %s\n",
-		     label, work->get_label());
+	FRED_VERBOSE(0, "WARNING: person %.*s assigned to workplace %s\n",
+		     Utils::fred_get_token_length(token[0]), token[0], work->get_label());
       }
       else {
-	FRED_VERBOSE(0, "WARNING: no workplace available for person %s\n", label);
+	FRED_VERBOSE(0, "WARNING: no workplace available for person %.*s\n",
+		     Utils::fred_get_token_length(token[0]), token[0]);
       }
     }
   }
 
   // warn if we can't find school.
-  if (strcmp(tmp_school_label,"X") != 0 && school == NULL) {
-    FRED_VERBOSE(0, "WARNING: person %s -- no school found for label = %s\n", label, school_label);
+  if (record->has_school_label && record->school == NULL && record->age < Global::GRADES) {
+    FRED_VERBOSE(0, "WARNING: person %.*s -- no school found for label = S-%.*s\n",
+		 Utils::fred_get_token_length(token[0]), token[0],
+		 Utils::fred_get_token_length(token[6]), token[6]);
   }
 
-  // FRED_VERBOSE(0, "add_person_to_pop:\n");
-  add_person_to_population(age, sex, race, household_relationship, house,
-			   school, work, day, today_is_birthday);
+  add_person_to_population(record->age, record->sex, record->race, record->relationship,
+			   record->house, record->school, work, day, today_is_birthday);
 }
 
 
+// population files are parsed in chunks of about this many bytes
+static const size_t POPULATION_CHUNK_SIZE = 1 << 22;
+
 void Person::read_all_populations() {
 
-  // process each specified location
+  // list the population files of each specified location
+  std::vector<std::string> file_name;
+  std::vector<bool> file_is_gq;
   int locs = Place::get_number_of_location_ids();
   for (int i = 0; i < locs; ++i) {
     char pop_dir[FRED_STRING_SIZE];
     Place::get_population_directory(pop_dir, i);
-    read_population(pop_dir, "people");
+    file_name.push_back(string(pop_dir) + "/people.txt");
+    file_is_gq.push_back(false);
     if(Global::Enable_Group_Quarters) {
-      read_population(pop_dir, "gq_people");
+      file_name.push_back(string(pop_dir) + "/gq_people.txt");
+      file_is_gq.push_back(true);
     }
   }
+  int files = file_name.size();
 
-  // mark all original people as original
-  for (int i = 0; i < people.size(); i++) {
-    people[i]->set_original();
+  // verify that the files (or their .gz versions) exist
+  for (int f = 0; f < files; ++f) {
+    char population_file[FRED_STRING_SIZE];
+    strcpy(population_file, file_name[f].c_str());
+    Utils::get_fred_file_name(population_file);
+    string gz_file = string(population_file) + ".gz";
+    if(access(population_file, R_OK) != 0 && access(gz_file.c_str(), R_OK) != 0) {
+      Utils::fred_abort("population_file %s not found\n", population_file);
+    }
   }
 
-  // report on time take to read populations
-  Utils::fred_print_lap_time("reading populations");
-
-}
-
-void Person::read_population(const char* pop_dir, const char* pop_type) {
-
-  FRED_STATUS(0, "read population entered\n");
-
-  char population_file[FRED_STRING_SIZE];
-  bool is_group_quarters_pop = (strcmp(pop_type, "gq_people") == 0);
-  FILE* fp = NULL;
-
-  sprintf(population_file, "%s/%s.txt", pop_dir, pop_type);
+  if (Global::Compile_FRED) {
+    files = 0;
+  }
+
+  // read the files concurrently and split each into chunks of lines,
+  // discarding the header line
+  std::vector<char>* text = new std::vector<char> [files];
+  std::vector<size_t>* bounds = new std::vector<size_t> [files];
+#pragma omp parallel for schedule(dynamic)
+  for (int f = 0; f < files; ++f) {
+    char population_file[FRED_STRING_SIZE];
+    strcpy(population_file, file_name[f].c_str());
+    if (Utils::fred_read_file(population_file, &text[f]) == false) {
+      Utils::fred_abort("population_file %s not readable\n", population_file);
+    }
+    size_t size = text[f].size() - 1;
+    const char* nl = (const char*) memchr(text[f].data(), '\n', size);
+    size_t start = (nl == NULL) ? size : (nl - text[f].data()) + 1;
+    Utils::fred_split_lines(text[f].data(), start, size, POPULATION_CHUNK_SIZE, &bounds[f]);
+  }
+
+  // parse all chunks of all files concurrently, resolving place labels
+  std::vector<int> chunk_file;
+  std::vector<int> chunk_index;
+  for (int f = 0; f < files; ++f) {
+    for (int c = 0; c + 1 < bounds[f].size(); ++c) {
+      chunk_file.push_back(f);
+      chunk_index.push_back(c);
+    }
+  }
+  int chunks = chunk_file.size();
+  std::vector<person_record_t>* records = new std::vector<person_record_t> [chunks];
+#pragma omp parallel for schedule(dynamic)
+  for (int k = 0; k < chunks; ++k) {
+    int f = chunk_file[k];
+    const char* line = text[f].data() + bounds[f][chunk_index[k]];
+    const char* chunk_end = text[f].data() + bounds[f][chunk_index[k] + 1];
+    person_record_t record;
+    while (line < chunk_end) {
+      const char* end = (const char*) memchr(line, '\n', chunk_end - line);
+      if (end == NULL) {
+	end = chunk_end;
+      }
+      if (get_person_record(line, end, file_is_gq[f], &record)) {
+	records[k].push_back(record);
+      }
+      line = end + 1;
+    }
+  }
 
-  // verify that the file exists
-  fp = Utils::fred_open_file(population_file);
-  if(fp == NULL) {
-    Utils::fred_abort("population_file %s not found\n", population_file);
+  // add the people to the population in file order
+  for (int k = 0; k < chunks; ++k) {
+    int size = records[k].size();
+    for (int i = 0; i < size; ++i) {
+      add_person_record(&records[k][i]);
+    }
+    records[k].clear();
+    if (k + 1 == chunks || chunk_file[k + 1] != chunk_file[k]) {
+      FRED_VERBOSE(0, "finished reading population, pop_size = %d\n", Person::pop_size);
+    }
   }
-  fclose(fp);
+  delete[] records;
+  delete[] bounds;
+  delete[] text;
 
-  if (Global::Compile_FRED) {
-    return;
+  // mark all original people as original
+  for (int i = 0; i < people.size(); i++) {
+    people[i]->set_original();
   }
 
-  std::ifstream stream(population_file, ifstream::in);
+  // report on time take to read populations
+  Utils::fred_print_lap_time("reading populations");
 
-  char line[FRED_STRING_SIZE];
-  // discard header line
-  stream.getline(line, FRED_STRING_SIZE);
-  while(stream.good()) {
-    stream.getline(line, FRED_STRING_SIZE);
-    // skip empty lines and header lines ...
-    if((line[0] == '\0') || strncmp(line, "sp_id", 6) == 0 || strncmp(line, "per_id", 7) == 0) {
-      continue;
-    }
-    get_person_data(line, is_group_quarters_pop);
-  }
-  FRED_VERBOSE(0, "finished reading population, pop_size = %d\n", Person::pop_size);
 }
 
 void Person::remove_dead_from_population(int day) {
@@ -985,6 +1054,7 @@ void Person::remove_migrants_from_population(int day) {
 void Person::delete_person_from_population(int day, Person* person) {
   FRED_VERBOSE(1, "DELETING PERSON: %d\n", person->get_id());
 
+  County::remove_from_resident_index(person);
   person->terminate(day);
 
   // delete from population data structure
@@ -1370,21 +1440,250 @@ Person* Person::select_random_person() {
 
 void Person::write_population_output_file(int day) {
 
+  if(strcmp(Person::output_population_format, "binary") == 0) {
+    Person::write_population_snapshot_file(day);
+    return;
+  }
+
   //Loop over the whole population and write the output of each Person's to_string to the file
   char population_output_file[FRED_STRING_SIZE];
   sprintf(population_output_file, "%s/%s_%s.txt", Global::Output_directory, Person::pop_outfile,
 	  Date::get_date_string().c_str());
-  FILE* fp = fopen(population_output_file, "w");
+  FILE* fp = Compressed_Stream::open_for_writing(population_output_file, Global::Output_Population_Compression);
   if(fp == NULL) {
     Utils::fred_abort("Help! population_output_file %s not found\n", population_output_file);
   }
 
-  for(int p = 0; p < Person::get_population_size(); ++p) {
-    Person* person = get_person(p);
-    fprintf(fp, "%s\n", person->to_string().c_str());
+  // format batches of people concurrently, then write them in order
+  const int chunk_size = 16384;
+  const int chunks_per_batch = 64;
+  int popsize = Person::get_population_size();
+  std::vector<std::string> text(chunks_per_batch);
+  for(int start = 0; start < popsize; start += chunk_size * chunks_per_batch) {
+    int chunks = (popsize - start + chunk_size - 1) / chunk_size;
+    if(chunks > chunks_per_batch) {
+      chunks = chunks_per_batch;
+    }
+#pragma omp parallel for schedule(dynamic,1)
+    for(int c = 0; c < chunks; ++c) {
+      int first = start + c * chunk_size;
+      int last = std::min(first + chunk_size, popsize);
+      text[c].clear();
+      for(int p = first; p < last; ++p) {
+	text[c] += get_person(p)->to_string();
+	text[c] += '\n';
+      }
+    }
+    for(int c = 0; c < chunks; ++c) {
+      fwrite(text[c].data(), 1, text[c].size(), fp);
+    }
   }
   fflush(fp);
-  fclose(fp);
+  bool failed = (ferror(fp) != 0);
+  if(fclose(fp) != 0 || failed) {
+    Utils::fred_abort("Help! population_output_file %s could not be written\n", population_output_file);
+  }
+}
+
+// A binary population snapshot starts with the 8-byte magic string
+// FREDSNAP, an int32 version (1), an int32 column count, an int64 row
+// count, the int32 simulation day and the date. The schema follows: for
+// each column its int32 type, its name, and an int32 count of labels
+// followed by the labels. Condition columns hold state indices and are
+// labeled by the state names; place columns hold the index of the place
+// within its type (-1 if none) and are labeled by the place labels. All
+// strings are written as an int32 length followed by the characters.
+// The data follow in schema order, one column at a time: rows values
+// for a fixed-width column, or int64 offsets[rows+1] followed by the
+// double values of all lists for a list column. FRED_SNAPSHOT converts
+// a snapshot to CSV.
+
+enum {
+  SNAPSHOT_INT32 = 1,
+  SNAPSHOT_DOUBLE = 2,
+  SNAPSHOT_CHAR = 3,
+  SNAPSHOT_DOUBLE_LIST = 4
+};
+
+enum {
+  SNAPSHOT_ID,
+  SNAPSHOT_AGE,
+  SNAPSHOT_SEX,
+  SNAPSHOT_RACE,
+  SNAPSHOT_RELATIONSHIP,
+  SNAPSHOT_PLACE,
+  SNAPSHOT_STATE,
+  SNAPSHOT_VAR,
+  SNAPSHOT_LIST_VAR
+};
+
+typedef struct {
+  int type;
+  int source;
+  int index;
+  string name;
+  string_vector_t labels;
+} snapshot_column_t;
+
+static void write_snapshot_string(FILE* fp, const string &str) {
+  int32_t len = str.length();
+  fwrite(&len, sizeof(len), 1, fp);
+  fwrite(str.data(), 1, len, fp);
+}
+
+static void add_snapshot_column(std::vector<snapshot_column_t>* schema, int type, int source, int index, string name) {
+  snapshot_column_t column;
+  column.type = type;
+  column.source = source;
+  column.index = index;
+  column.name = name;
+  schema->push_back(column);
+}
+
+void Person::write_population_snapshot_file(int day) {
+
+  char population_output_file[FRED_STRING_SIZE];
+  sprintf(population_output_file, "%s/%s_%s.bin", Global::Output_directory, Person::pop_outfile,
+	  Date::get_date_string().c_str());
+  FILE* fp = Compressed_Stream::open_for_writing(population_output_file, Global::Output_Population_Compression, "wb");
+  if(fp == NULL) {
+    Utils::fred_abort("Help! population_output_file %s not found\n", population_output_file);
+  }
+
+  // the schema: demographics, places, condition states, vars and list vars
+  std::vector<snapshot_column_t> schema;
+  add_snapshot_column(&schema, SNAPSHOT_INT32, SNAPSHOT_ID, 0, "id");
+  add_snapshot_column(&schema, SNAPSHOT_INT32, SNAPSHOT_AGE, 0, "age");
+  add_snapshot_column(&schema, SNAPSHOT_CHAR, SNAPSHOT_SEX, 0, "sex");
+  add_snapshot_column(&schema, SNAPSHOT_INT32, SNAPSHOT_RACE, 0, "race");
+  add_snapshot_column(&schema, SNAPSHOT_INT32, SNAPSHOT_RELATIONSHIP, 0, "relationship");
+  for(int t = 0; t < Place_Type::get_number_of_place_types(); ++t) {
+    Place_Type* place_type = Place_Type::get_place_type(t);
+    add_snapshot_column(&schema, SNAPSHOT_INT32, SNAPSHOT_PLACE, t, place_type->get_name());
+    for(int i = 0; i < place_type->get_number_of_places(); ++i) {
+      Place* place = place_type->get_place(i);
+      schema.back().labels.push_back(place == NULL ? "-1" : place->get_label());
+    }
+  }
+  for(int c = 0; c < Condition::get_number_of_conditions(); ++c) {
+    Condition* condition = Condition::get_condition(c);
+    add_snapshot_column(&schema, SNAPSHOT_INT32, SNAPSHOT_STATE, c, condition->get_name());
+    for(int s = 0; s < condition->get_number_of_states(); ++s) {
+      schema.back().labels.push_back(condition->get_state_name(s));
+    }
+  }
+  for(int v = 0; v < Person::get_number_of_vars(); ++v) {
+    add_snapshot_column(&schema, SNAPSHOT_DOUBLE, SNAPSHOT_VAR, v, Person::get_var_name(v));
+  }
+  for(int v = 0; v < Person::get_number_of_list_vars(); ++v) {
+    add_snapshot_column(&schema, SNAPSHOT_DOUBLE_LIST, SNAPSHOT_LIST_VAR, v, Person::get_list_var_name(v));
+  }
+
+  // header
+  int32_t version = 1;
+  int32_t columns = schema.size();
+  int64_t rows = Person::get_population_size();
+  int32_t snapshot_day = day;
+  fwrite("FREDSNAP", 1, 8, fp);
+  fwrite(&version, sizeof(version), 1, fp);
+  fwrite(&columns, sizeof(columns), 1, fp);
+  fwrite(&rows, sizeof(rows), 1, fp);
+  fwrite(&snapshot_day, sizeof(snapshot_day), 1, fp);
+  write_snapshot_string(fp, Date::get_date_string());
+  for(int i = 0; i < columns; ++i) {
+    int32_t type = schema[i].type;
+    int32_t labels = schema[i].labels.size();
+    fwrite(&type, sizeof(type), 1, fp);
+    write_snapshot_string(fp, schema[i].name);
+    fwrite(&labels, sizeof(labels), 1, fp);
+    for(int j = 0; j < labels; ++j) {
+      write_snapshot_string(fp, schema[i].labels[j]);
+    }
+  }
+
+  // each column is gathered concurrently into a buffer, then written
+  std::vector<int32_t> int_values;
+  std::vector<int64_t> long_values;
+  std::vector<double> double_values;
+  std::vector<char> char_values;
+  for(int i = 0; i < columns; ++i) {
+    const snapshot_column_t &column = schema[i];
+    switch(column.type) {
+
+    case SNAPSHOT_INT32:
+      int_values.resize(rows);
+#pragma omp parallel for
+      for(int64_t p = 0; p < rows; ++p) {
+	Person* person = get_person(p);
+	switch(column.source) {
+	case SNAPSHOT_ID:
+	  int_values[p] = person->get_id();
+	  break;
+	case SNAPSHOT_AGE:
+	  int_values[p] = person->get_age();
+	  break;
+	case SNAPSHOT_RACE:
+	  int_values[p] = person->get_race();
+	  break;
+	case SNAPSHOT_RELATIONSHIP:
+	  int_values[p] = person->get_household_relationship();
+	  break;
+	case SNAPSHOT_PLACE:
+	  {
+	    Group* place = person->get_activity_group(column.index);
+	    int_values[p] = (place == NULL) ? -1 : place->get_index();
+	  }
+	  break;
+	default:
+	  int_values[p] = person->get_state(column.index);
+	  break;
+	}
+      }
+      fwrite(int_values.data(), sizeof(int32_t), rows, fp);
+      break;
+
+    case SNAPSHOT_DOUBLE:
+      double_values.resize(rows);
+#pragma omp parallel for
+      for(int64_t p = 0; p < rows; ++p) {
+	double_values[p] = get_person(p)->get_var(column.index);
+      }
+      fwrite(double_values.data(), sizeof(double), rows, fp);
+      break;
+
+    case SNAPSHOT_CHAR:
+      char_values.resize(rows);
+#pragma omp parallel for
+      for(int64_t p = 0; p < rows; ++p) {
+	char_values[p] = get_person(p)->get_sex();
+      }
+      fwrite(char_values.data(), 1, rows, fp);
+      break;
+
+    case SNAPSHOT_DOUBLE_LIST:
+      {
+	long_values.resize(rows + 1);
+	long_values[0] = 0;
+	for(int64_t p = 0; p < rows; ++p) {
+	  long_values[p + 1] = long_values[p] + get_person(p)->list_var[column.index].size();
+	}
+	double_values.resize(long_values[rows]);
+#pragma omp parallel for
+	for(int64_t p = 0; p < rows; ++p) {
+	  const double_vector_t &list = get_person(p)->list_var[column.index];
+	  std::copy(list.begin(), list.end(), double_values.begin() + long_values[p]);
+	}
+	fwrite(long_values.data(), sizeof(int64_t), rows + 1, fp);
+	fwrite(double_values.data(), sizeof(double), long_values[rows], fp);
+      }
+      break;
+    }
+  }
+  fflush(fp);
+  bool failed = (ferror(fp) != 0);
+  if(fclose(fp) != 0 || failed) {
+    Utils::fred_abort("Help! population_output_file %s could not be written\n", population_output_file);
+  }
 }
 
 void Person::get_age_distribution(int* count_males_by_age, int* count_females_by_age) {
@@ -1971,6 +2270,7 @@ void Person::setup_conditions() {
     this->condition[condition_id].source = NULL;
     this->condition[condition_id].group = NULL;
     this->condition[condition_id].number_of_hosts = 0;
+    this->condition[condition_id].counted_household = -1;
     int states = get_natural_history(condition_id)->get_number_of_states();
     this->condition[condition_id].entered = new int [states];
     for (int i = 0; i < states; i++) {
@@ -1983,6 +2283,7 @@ void Person::setup_conditions() {
     this->var = new double [number_of_vars];
     for (int i = 0; i < number_of_vars; i++) {
       this->var[i] = Person::var_init_value[i];
+      Factor::update_var_epoch(i);
     }
   }
   if (this->id==-1) {
@@ -2056,10 +2357,7 @@ void Person::become_exposed(int condition_id, Person* source, Group* group, int
     set_place_of_type(place_type_id, place); 
 
     // increment the group_state_counts for all conditions for this place
-    for (int cond_id = 0; cond_id < Condition::get_number_of_conditions(); cond_id++) {
-      int state = get_state(cond_id);
-      Condition::get_condition(cond_id)->increment_group_state_count(place_type_id, place, state);
-    }
+    Condition::increment_group_state_counts(this, place_type_id, place);
 
     if (Global::Enable_Records) {
       fprintf(Global::Recordsfp,
@@ -2205,6 +2503,7 @@ void Person::set_var(int index, double value) {
   FRED_VERBOSE(0, "set_var person %d index %d number of vars %d\n", this->id, index, number_of_vars);
   if (index < number_of_vars) {
     this->var[index] = value;
+    Factor::update_var_epoch(index);
   }
 }
 
@@ -2238,7 +2537,7 @@ int Person::get_global_list_size(int list_var_id) {
   }
 }
 
-double_vector_t Person::get_list_var(int index) {
+const double_vector_t &Person::get_list_var(int index) {
   int number_of_list_vars = Person::get_number_of_list_vars();
   if (index < number_of_list_vars) {
     return this->list_var[index];
@@ -2246,12 +2545,12 @@ double_vector_t Person::get_list_var(int index) {
   else {
     printf("ERR: index = %d vars = %d\n", index, number_of_vars);
     assert(0);
-    double_vector_t empty;
+    static double_vector_t empty;
     return empty;
   }
 }
 
-double_vector_t Person::get_global_list_var(int index) {
+const double_vector_t &Person::get_global_list_var(int index) {
   int number_of_list_vars = Person::get_number_of_global_list_vars();
   if (index < number_of_list_vars) {
     return Person::global_list_var[index];
@@ -2259,7 +2558,7 @@ double_vector_t Person::get_global_list_var(int index) {
   else {
     printf("ERR: index = %d vars = %d\n", index, number_of_vars);
     assert(0);
-    double_vector_t empty;
+    static double_vector_t empty;
     return empty;
   }
 }
@@ -2343,6 +2642,7 @@ void Person::get_external_updates(FILE* fp, int day) {
     sprintf(vstr2, "%s", Person::get_var_name(i).c_str());
     assert(strcmp(vstr,vstr2)==0);
     this->var[i] = fval;
+    Factor::update_var_epoch(i);
   }  
 }
 
@@ -3141,8 +3441,14 @@ void Person::change_household(Place* house) {
 	       get_id(), house->get_label(), house->get_subtype());
 
   // change household
+  County::move_in_resident_index(this, house);
   set_household(house);
 
+  // move the admin division counts of each condition
+  for(int condition_id = 0; condition_id < this->number_of_conditions; ++condition_id) {
+    Condition::get_condition(condition_id)->get_epidemic()->move_admin_state_count(this, Global::Simulation_Day);
+  }
+
   // set neighborhood
   set_neighborhood(house->get_patch()->get_neighborhood());
 
@@ -3412,6 +3718,41 @@ void Person::add_edge_from(Person* other, Network* network) {
   }
 }
 
+void Person::reserve_edges(Network* network, int out_degree, int in_degree) {
+  int n = network->get_type_id();
+  if (0 <= n) {
+    this->link[n].reserve_edges(out_degree, in_degree);
+  }
+}
+
+void Person::append_edge_to(Person* other, Network* network, double weight, int timestamp) {
+  int n = network->get_type_id();
+  if (0 <= n) {
+    this->link[n].append_edge_to(other, weight, timestamp);
+  }
+}
+
+void Person::append_edge_from(Person* other, Network* network, double weight, int timestamp) {
+  int n = network->get_type_id();
+  if (0 <= n) {
+    this->link[n].append_edge_from(other, weight, timestamp);
+  }
+}
+
+void Person::update_edges_to(Network* network, const person_vector_t &other, const int_vector_t &add) {
+  int n = network->get_type_id();
+  if (0 <= n) {
+    this->link[n].update_edges_to(other, add);
+  }
+}
+
+void Person::update_edges_from(Network* network, const person_vector_t &other, const int_vector_t &add) {
+  int n = network->get_type_id();
+  if (0 <= n) {
+    this->link[n].update_edges_from(other, add);
+  }
+}
+
 void Person::delete_edge_to(Person* person, Network* network) {
   if (person==NULL) {
     return;
@@ -3854,53 +4195,30 @@ int Person::get_profile_from_name(std::string name) {
 
 
 
-void Person::run_action_rules(int condition_id, int state, rule_vector_t rules) {
+void Person::run_action_rules(int condition_id, int state, const action_plan_t& plan) {
 
   int day = Global::Simulation_Day;
   int hour = Global::Simulation_Hour;
 
   FRED_VERBOSE(1, "run side-effect rules day %d hour %d person %d cond %d state %d rules %d\n",
-	       day, hour, this->id, condition_id, state, (int) rules.size());
-
-  for (int i = 0; i < rules.size(); i++) {
-
-    Rule* rule = rules[i];
-    int action = rule->get_action_id();
-    // rule->print();
-    string action_str = rule->get_action();
-    int cond_id = rule->get_cond_id();
-    int state_id = rule->get_state_id();
-    int next_state_id = rule->get_next_state_id();
-    int source_cond_id = rule->get_source_cond_id();
-    int var_id = -1;
-
-    string group_name = rule->get_group();
-    int group_type_id = rule->get_group_type_id();
-
-    string network_name = rule->get_network();
-    Network* network = Network::get_network(network_name);
-    int network_type_id = network ? network->get_type_id() : -1;
-
-    Expression* expr = rule->get_expression();
-    Expression* expr2 = rule->get_expression2();
+	       day, hour, this->id, condition_id, state, (int) plan.size());
+
+  for (int i = 0; i < plan.size(); i++) {
+
+    const action_step_t& step = plan[i];
+    Rule* rule = step.rule;
+    int action = step.action;
+    int cond_id = step.cond_id;
+    int var_id = step.var_id;
+    int group_type_id = step.group_type_id;
+    Network* network = step.network;
+    int network_type_id = step.network_type_id;
+    Expression* expr = step.expr;
+    Expression* expr2 = step.expr2;
     double value = 0;
-    Preference* preference = NULL;
-    Clause* clause = rule->get_clause();
-
-    if (clause) {
-      if (clause->get_value(this)==false) {
-	// printf("action rule clause failed: ");
-	// rule->print();
-	continue;
-      }
-      else {
-	// printf("action rule clause passed: ");
-	// rule->print();
-      }
-    }
-    else {
-      // printf("no clause found: ");
-      // rule->print();
+
+    if (step.clause && step.clause->get_value(this)==false) {
+      continue;
     }
 
     switch (action) {
@@ -3919,18 +4237,18 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
       break;
 
     case Rule_Action::SET_SUS :
-      this->condition[rule->get_source_cond_id()].susceptibility = expr2->get_value(this);
+      this->condition[step.source_cond_id].susceptibility = expr2->get_value(this);
       break;
 
     case Rule_Action::SET_TRANS :
       if (0 <= this->id) {
-	this->condition[rule->get_source_cond_id()].transmissibility = expr2->get_value(this);
+	this->condition[step.source_cond_id].transmissibility = expr2->get_value(this);
       }
       else if (this->id == -1) {
-	int source_cond_id = rule->get_source_cond_id();
+	int source_cond_id = step.source_cond_id;
 	double old_value = Condition::get_condition(source_cond_id)->get_transmissibility();
 	double value = expr2->get_value(this);
-	Condition::get_condition(rule->get_source_cond_id())->set_transmissibility(value);
+	Condition::get_condition(step.source_cond_id)->set_transmissibility(value);
 	if (Global::Enable_Records && Global::Enable_Var_Records && old_value!=value) {
 	  char tmp[FRED_STRING_SIZE];
 	  get_record_string(tmp);
@@ -3939,7 +4257,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 		  tmp,
 		  get_natural_history(condition_id)->get_name(),
 		  get_natural_history(condition_id)->get_state_name(state).c_str(),
-		  Condition::get_condition(rule->get_source_cond_id())->get_name(),
+		  Condition::get_condition(step.source_cond_id)->get_name(),
 		  old_value,
 		  value);
 	}
@@ -3988,7 +4306,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	// FRED_VERBOSE(0, "ADD_EDGE_FROM NETWORK %s\n", network_name.c_str());
 	double_vector_t id_vec;
 	if (expr->is_list_expression()) {
-	  id_vec = expr->get_list_value(this);
+	  expr->get_list_value(this, NULL, &id_vec);
 	}
 	else {
 	  id_vec.push_back(expr->get_value(this));
@@ -3998,6 +4316,10 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	  int other_id = id_vec[i];
 	  // FRED_VERBOSE(0, "ADD_EDGE_FROM NETWORK %s other_id %d\n", network_name.c_str(), other_id);
 	  Person* other = Person::get_person_with_id(other_id);
+	  if (network->has_deferred_edges()) {
+	    network->log_edge_edit(other, this, true);
+	    continue;
+	  }
 	  add_edge_from(other, network);
 	  other->add_edge_to(this, network);
 	  if (network->is_undirected()) {
@@ -4013,7 +4335,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	// FRED_VERBOSE(0, "ADD_EDGE_TO NETWORK %s\n", network_name.c_str());
 	double_vector_t id_vec;
 	if (expr->is_list_expression()) {
-	  id_vec = expr->get_list_value(this);
+	  expr->get_list_value(this, NULL, &id_vec);
 	}
 	else {
 	  id_vec.push_back(expr->get_value(this));
@@ -4024,6 +4346,10 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	  int other_id = id_vec[i];
 	  // FRED_VERBOSE(0, "person %d ADD_EDGE_TO NETWORK %s other_id %d\n", this->id, network_name.c_str(), other_id);
 	  Person* other = Person::get_person_with_id(other_id);
+	  if (network->has_deferred_edges()) {
+	    network->log_edge_edit(this, other, true);
+	    continue;
+	  }
 	  add_edge_to(other, network);
 	  other->add_edge_from(this, network);
 	  if (network->is_undirected()) {
@@ -4042,7 +4368,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	// FRED_VERBOSE(0, "DELETE_EDGE_FROM NETWORK %s\n", network_name.c_str());
 	double_vector_t id_vec;
 	if (expr->is_list_expression()) {
-	  id_vec = expr->get_list_value(this);
+	  expr->get_list_value(this, NULL, &id_vec);
 	}
 	else {
 	  id_vec.push_back(expr->get_value(this));
@@ -4052,6 +4378,10 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	  int other_id = id_vec[i];
 	  // FRED_VERBOSE(0, "DELETE_EDGE_FROM NETWORK %s other_id %d\n", network_name.c_str(), other_id);
 	  Person* other = Person::get_person_with_id(other_id);
+	  if (network->has_deferred_edges()) {
+	    network->log_edge_edit(other, this, false);
+	    continue;
+	  }
 	  delete_edge_from(other, network);
 	  other->delete_edge_to(this, network);
 	  if (network->is_undirected()) {
@@ -4067,7 +4397,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	// FRED_VERBOSE(0, "DELETE_EDGE_TO NETWORK %s\n", network_name.c_str());
 	double_vector_t id_vec;
 	if (expr->is_list_expression()) {
-	  id_vec = expr->get_list_value(this);
+	  expr->get_list_value(this, NULL, &id_vec);
 	}
 	else {
 	  id_vec.push_back(expr->get_value(this));
@@ -4077,6 +4407,10 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	  int other_id = id_vec[i];
 	  // FRED_VERBOSE(0, "DELETE_EDGE_TO NETWORK %s other_id %d\n", network_name.c_str(), other_id);
 	  Person* other = Person::get_person_with_id(other_id);
+	  if (network->has_deferred_edges()) {
+	    network->log_edge_edit(this, other, false);
+	    continue;
+	  }
 	  delete_edge_to(other, network);
 	  other->delete_edge_from(this, network);
 	  if (network->is_undirected()) {
@@ -4089,15 +4423,14 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 
     case Rule_Action::SET :
       {
-	var_id = rule->get_var_id();
-	bool global = rule->is_global();
+	bool global = step.global;
 	Person* other = NULL;
-	Expression* other_expr = rule->get_expression2();
+	Expression* other_expr = expr2;
 	if (other_expr) {
 	  int person_id = other_expr->get_value(this);
 	  other = Person::get_person_with_id(person_id);
 	}
-	value = rule->get_value(this, other);
+	value = expr->get_value(this, other);
 	if (global) {
 	  if (Global::Enable_Records && Global::Enable_Var_Records && Person::global_var[var_id]!=value) {
 	    char tmp[FRED_STRING_SIZE];
@@ -4128,6 +4461,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 		      value);
 	    }
 	    this->var[var_id] = value;
+	    Factor::update_var_epoch(var_id);
 	  }
 	  else {
 	    if (Global::Enable_Records && Global::Enable_Var_Records && other->get_var(var_id)!=value) {
@@ -4154,11 +4488,10 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	FRED_VERBOSE(1, "run SET_LIST person %d cond %d state %d rule: %s\n",
 		     this->id, condition_id, state, rule->get_name().c_str());
 
-	var_id = rule->get_list_var_id();
-	bool global = rule->is_global();
+	bool global = step.global;
 	if (global) {
 	  FRED_VERBOSE(1, "global_list_var %d %s\n", var_id, Person::get_global_list_var_name(var_id).c_str());
-	  double_vector_t list_value = rule->get_expression()->get_list_value(this);
+	  double_vector_t list_value = expr->get_list_value(this);
 	  FRED_VERBOSE(1, "AFTER SET_LIST list_var %d size %d => size %d\n",
 		       var_id, Person::global_list_var[var_id].size(), list_value.size());
 	  Person::global_list_var[var_id] = list_value;
@@ -4172,7 +4505,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	}
 	else {
 	  // FRED_VERBOSE(0, "list_var %d %s\n", var_id, rule->get_list_var_name(var_id).c_str());
-	  double_vector_t list_value = rule->get_expression()->get_list_value(this);
+	  double_vector_t list_value = expr->get_list_value(this);
 	  FRED_VERBOSE(1, "AFTER SET_LIST list_var %d size %d => size %d\n",
 		       var_id, this->list_var[var_id].size(), list_value.size());
 	  this->list_var[var_id] = list_value;
@@ -4189,9 +4522,9 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 
     case Rule_Action::SET_STATE :
       {
-	int source_cond_id = rule->get_source_cond_id();
-	int source_state_id = rule->get_source_state_id();
-	int dest_state_id = rule->get_dest_state_id();
+	int source_cond_id = step.source_cond_id;
+	int source_state_id = step.source_state_id;
+	int dest_state_id = step.dest_state_id;
 	if (get_state(source_cond_id)==source_state_id) {
 	  int day = Global::Simulation_Day;
 	  int hour = Global::Simulation_Hour;
@@ -4220,7 +4553,7 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	if (is_member_of_network(network)) {
 	  double_vector_t id_vec;
 	  if (expr->is_list_expression()) {
-	    id_vec = expr->get_list_value(this);
+	    expr->get_list_value(this, NULL, &id_vec);
 	  }
 	  else {
 	    id_vec.push_back(expr->get_value(this));
@@ -4254,8 +4587,8 @@ void Person::run_action_rules(int condition_id, int state, rule_vector_t rules)
 	// FRED_VERBOSE(0, "RANDOMIZE NETWORK %s\n", network_name.c_str());
 	Group* group = get_admin_group();
 	if (group && group->get_type_id()==network_type_id) {
-	  double mean_degree = rule->get_expression()->get_value(this,NULL);
-	  double max_degree = rule->get_expression2()->get_value(this,NULL);
+	  double mean_degree = expr->get_value(this,NULL);
+	  double max_degree = expr2->get_value(this,NULL);
 	  // FRED_VERBOSE(0, "RANDOMIZE NETWORK %s mean %f max %f\n", network_name.c_str(), mean_degree, max_degree);
 	  network->randomize(mean_degree, max_degree);
 	}
@@ -41,6 +41,7 @@ using namespace std;
 #include "Place_Type.h"
 #include "Group_Type.h"
 #include "Place.h"
+#include "Rule.h"
 #include "Utils.h"
 
 class Activities_Tracking_Data;
@@ -66,6 +67,21 @@ typedef struct {
   std::vector<double> value_on_day;
 } report_t;
 
+// a person read from a population file, with its places resolved
+typedef struct {
+  const char* line;		// the input line, for warnings
+  Place* house;
+  Place* school;
+  Place* work;
+  int age;
+  int race;
+  int relationship;
+  char sex;
+  bool gq;
+  bool has_school_label;
+  bool has_work_label;
+} person_record_t;
+
 
 typedef struct {
   int state;
@@ -80,6 +96,10 @@ typedef struct {
   Group* group;
   int number_of_hosts;
 
+  // index of the household in whose admin divisions the current state
+  // is counted, or -1
+  int counted_household;
+
   // time each state was last entered
   int* entered;
 
@@ -472,7 +492,7 @@ public:
   void report_place_size(int place_type_id);
   Place* get_place_with_type_id(int place_type_id);
   person_vector_t get_placemates(int place_type_id, int maxn);
-  void run_action_rules(int condition_id, int state, rule_vector_t rules);
+  void run_action_rules(int condition_id, int state, const action_plan_t& plan);
 
   // SCHEDULE
   std::string schedule_to_string(int sim_day);
@@ -488,6 +508,22 @@ public:
   void unset_eligible_to_migrate() {
     this->eligible_to_migrate = false;
   }
+
+  // position in the county index of residents by sex and age
+  int get_county_index_county() {
+    return this->county_index_county;
+  }
+  int get_county_index_age() {
+    return this->county_index_age;
+  }
+  int get_county_index_pos() {
+    return this->county_index_pos;
+  }
+  void set_county_index(int county, int age, int pos) {
+    this->county_index_county = county;
+    this->county_index_age = age;
+    this->county_index_pos = pos;
+  }
   void change_household(Place* house);
   void change_school(Place* place);
   void change_workplace(Place* place, int include_office = 1);
@@ -574,6 +610,11 @@ public:
   bool is_member_of_network(Network* network);
   void add_edge_to(Person* person, Network* network);
   void add_edge_from(Person* person, Network* network);
+  void reserve_edges(Network* network, int out_degree, int in_degree);
+  void append_edge_to(Person* person, Network* network, double weight, int timestamp);
+  void append_edge_from(Person* person, Network* network, double weight, int timestamp);
+  void update_edges_to(Network* network, const person_vector_t &other, const int_vector_t &add);
+  void update_edges_from(Network* network, const person_vector_t &other, const int_vector_t &add);
   void delete_edge_to(Person* person, Network* network);
   void delete_edge_from(Person* person, Network* network);
   bool is_connected_to(Person* person, Network* network);
@@ -604,7 +645,7 @@ public:
   // VARIABLES
   double get_var(int index);
   void set_var(int index, double value);
-  double_vector_t get_list_var(int index);
+  const double_vector_t &get_list_var(int index);
   int get_list_size(int list_var_id);
 
   static void include_variable(string name) {
@@ -706,7 +747,7 @@ public:
   static int get_global_var_id(string var_name);
   static int get_global_list_var_id(string var_name);
   static double get_global_var(int index);
-  static double_vector_t get_global_list_var(int index);
+  static const double_vector_t &get_global_list_var(int index);
   static int get_global_list_size(int list_var_id);
   static void push_back_global_list_var(int list_var_id, double value);
 
@@ -791,6 +832,12 @@ public:
   int get_number_of_hosts(int condition_id) const {
     return this->condition[condition_id].number_of_hosts;
   }
+  void set_counted_household(int condition_id, int index) {
+    this->condition[condition_id].counted_household = index;
+  }
+  int get_counted_household(int condition_id) const {
+    return this->condition[condition_id].counted_household;
+  }
   bool is_susceptible(int condition_id) const {
     return get_susceptibility(condition_id) > 0.0;
   }
@@ -861,8 +908,8 @@ public:
   static void initialize_static_activity_variables();
   static void setup();
   static void read_all_populations();
-  static void read_population(const char* pop_dir, const char* pop_type );
-  static void get_person_data(char* line, bool gq);
+  static bool get_person_record(const char* line, const char* end, bool gq, person_record_t* record);
+  static void add_person_record(person_record_t* record);
   static Person* add_person_to_population(int age, char sex, int race, int rel, Place* house,
 					  Place* school, Place* work, int day, bool today_is_birthday);
   static int get_population_size() {
@@ -1042,6 +1089,9 @@ private:
   bool eligible_to_migrate;
   bool native;
   bool original;
+  int county_index_pos;
+  short int county_index_county;
+  short int county_index_age;
 
   // vaccine
   bool vaccine_refusal;
@@ -1124,7 +1174,9 @@ private:
   static int output_population;
   static char pop_outfile[FRED_STRING_SIZE];
   static char output_population_date_match[FRED_STRING_SIZE];
+  static char output_population_format[FRED_STRING_SIZE];
   static void write_population_output_file(int day);
+  static void write_population_snapshot_file(int day);
   static int Popsize_by_age [Demographics::MAX_AGE+1];
   static person_vector_t report_person;
   static std::vector<report_t*> report_vec;
@@ -1144,6 +1196,9 @@ private:
   static std::unordered_map<Person*, Group*> admin_group_map;
 
   static bool record_location;
+
+  // scratch space for sampling placemates
+  static thread_local int_vector_t placemate_sample;
 };
 
 #endif // _FRED_PERSON_H
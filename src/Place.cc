@@ -38,6 +38,7 @@
 
 #include "Block_Group.h"
 #include "Date.h"
+#include "Elevation_Layer.h"
 #include "Condition.h"
 #include "Geo.h"
 #include "Global.h"
@@ -83,7 +84,6 @@ bool Place::country_is_usa = false;
 bool Place::country_is_colombia = false;
 bool Place::country_is_india = false;
 std::vector<int> Place::state_admin_code;
-std::map<std::string, std::string>  Place::hh_label_hosp_label_map;
 std::map<std::string, int>  Place::hosp_label_hosp_id_map;
 
 // map of place type names
@@ -97,6 +97,9 @@ place_vector_t Place::schools_by_grade[Global::GRADES];
 place_vector_t Place::gq;
 
 bool Place::Update_elevation = false;
+char Place::Elevation_data_directory[FRED_STRING_SIZE] = "none";
+int Place::Elevation_cells_per_degree = 0;
+char Place::Elevation_cache_directory[FRED_STRING_SIZE] = "none";
 
 char Place::Population_directory[FRED_STRING_SIZE];
 char Place::Country[FRED_STRING_SIZE];
@@ -119,7 +122,10 @@ int Place::Military_fixed_staff = 0;
 double Place::Military_resident_to_staff_ratio = 0;
 int Place::School_fixed_staff = 0;
 double Place::School_student_teacher_ratio = 0;
+int_vector_t Place::household_hospital;
 bool Place::Household_hospital_map_file_exists = false;
+char Place::Household_hospital_map_file[FRED_STRING_SIZE];
+int Place::Hospital_catchment_size = 5;
 int Place::Hospital_fixed_staff = 1.0;
 double Place::Hospital_worker_to_bed_ratio = 1.0;
 double Place::Hospitalization_radius = 0.0;
@@ -520,49 +526,27 @@ void Place::get_place_properties() {
   Property::get_property("hospitalization_radius", &Place::Hospitalization_radius);
   Property::get_property("Hospital_fixed_staff", &Place::Hospital_fixed_staff);
 
+  Property::get_property("hospital_catchment_size", &Place::Hospital_catchment_size);
+
+  // the household to hospital map file is read once households and
+  // hospitals are loaded
   char hosp_file_dir[FRED_STRING_SIZE];
   char hh_hosp_map_file_name[FRED_STRING_SIZE];
-
   Property::get_property("Household_Hospital_map_file_directory", hosp_file_dir);
   Property::get_property("Household_Hospital_map_file", hh_hosp_map_file_name);
-
   if(strcmp(hh_hosp_map_file_name, "none") == 0) {
-    Place::Household_hospital_map_file_exists = false;
+    strcpy(Place::Household_hospital_map_file, "none");
   } else {
-    //If there is a file mapping Households to Hospitals, open it
-    FILE* hospital_household_map_fp = NULL;
-
-    char filename[FRED_STRING_SIZE];
-    sprintf(filename, "%s%s", hosp_file_dir, hh_hosp_map_file_name);
-    hospital_household_map_fp = Utils::fred_open_file(filename);
-
-    if(hospital_household_map_fp != NULL) {
-      Place::Household_hospital_map_file_exists = true;
-
-      char hh_label[FRED_STRING_SIZE];
-      char hosp_label[FRED_STRING_SIZE];
-      while (fscanf(hospital_household_map_fp, "%s,%s", hh_label, hosp_label) == 2) {
-        if (strcmp(hh_label, "hh_id") == 0) {
-          continue;
-        }
-        if(strcmp(hh_label, "sp_id") == 0) {
-          continue;
-        }
-        string hh_label_str(hh_label);
-        string hosp_label_str(hosp_label);
-        Place::hh_label_hosp_label_map.insert(std::pair<string, string>(hh_label_str, hosp_label_str));
-      }
-      fclose(hospital_household_map_fp);
-    }
+    sprintf(Place::Household_hospital_map_file, "%s%s", hosp_file_dir, hh_hosp_map_file_name);
   }
 
+  Property::get_property("elevation_data_directory", Place::Elevation_data_directory);
+  Property::get_property("elevation_cells_per_degree", &Place::Elevation_cells_per_degree);
+  Property::get_property("elevation_cache_directory", Place::Elevation_cache_directory);
+
   // the following are included here to make them visible to check_properties.
   // they are conditionally read in elsewhere.
 
-  char elevation_data_dir[FRED_STRING_SIZE];
-  sprintf(elevation_data_dir, "none");
-  Property::get_property("elevation_data_directory", elevation_data_dir);
-
   char map_file_dir[FRED_STRING_SIZE];
   char map_file_name[FRED_STRING_SIZE];
   Property::get_property("Household_Hospital_map_file_directory", map_file_dir);
@@ -578,7 +562,6 @@ void Place::read_all_places() {
   // clear the vectors and maps
   Place::state_admin_code.clear();
   Place::hosp_label_hosp_id_map.clear();
-  Place::hh_label_hosp_label_map.clear();
 
   // to compute the region's bounding box
   Place::min_lat = Place::min_lon = 999;
@@ -735,73 +718,114 @@ void Place::read_gq_places(const char* loc_id) {
 }
 
 
-void Place::read_household_file(char* location_file) {
+// a line of a household file
+typedef struct {
+  const char* label;
+  long long int admin_code;
+  int race;
+  int income;
+  double lat;
+  double lon;
+  double elevation;
+  int items;
+} household_record_t;
 
-  char line[FRED_STRING_SIZE];
+// household files are parsed in chunks of about this many bytes
+static const size_t HOUSEHOLD_CHUNK_SIZE = 1 << 22;
+
+void Place::read_household_file(char* location_file) {
 
   // data to fill in from input file
   int type_id = Place_Type::HOUSEHOLD;
   char place_subtype = Place::SUBTYPE_NONE;
   char new_label[FRED_STRING_SIZE];
-  char label[FRED_STRING_SIZE];
-  long long int admin_code = 0;
   long long int sp_id = 0;
-  double lat = 0;
-  double lon = 0;
   double elevation = 0;
-  int race;
-  int income;
   int n = 0;
 
-  FILE* fp = Utils::fred_open_file(location_file);
+  std::vector<char> text;
+  if (Utils::fred_read_file(location_file, &text) == false) {
+    Utils::fred_abort("household file %s not found\n", location_file);
+  }
 
   // skip header line
-  fgets(label, FRED_STRING_SIZE, fp);
-
-  // read first data line
-  strcpy(line, "");
-  fgets(line, FRED_STRING_SIZE, fp);
-  int items = sscanf(line, "%s %lld %d %d %lf %lf %lf", label, &admin_code, &race, &income, &lat, &lon, &elevation);
-  
-  while(6 <= items) {
-      
-    // debugging:
-    // printf("HH %d %s %lld %d %d %lf %lf %lf\n", n, label, admin_code, race, income, lat, lon, elevation); fflush(stdout);
-
-
-
-    // debugging:
-    // printf("HH added: %d %s %lld %d %d %lf %lf %lf\n", n, place->get_label(), place->get_admin_code(),
-    // race, income, place->get_latitude(), place->get_longitude(), place->get_elevation()); fflush(stdout);
+  size_t size = text.size() - 1;
+  const char* nl = (const char*) memchr(text.data(), '\n', size);
+  size_t start = (nl == NULL) ? size : (nl - text.data()) + 1;
+  std::vector<size_t> bounds;
+  Utils::fred_split_lines(text.data(), start, size, HOUSEHOLD_CHUNK_SIZE, &bounds);
+
+  // parse the chunks concurrently
+  int chunks = bounds.size() - 1;
+  std::vector<household_record_t>* records = new std::vector<household_record_t> [chunks];
+#pragma omp parallel for schedule(dynamic)
+  for (int k = 0; k < chunks; ++k) {
+    const char* line = text.data() + bounds[k];
+    const char* chunk_end = text.data() + bounds[k + 1];
+    household_record_t record;
+    const char* token[7];
+    while (line < chunk_end) {
+      const char* end = (const char*) memchr(line, '\n', chunk_end - line);
+      if (end == NULL) {
+	end = chunk_end;
+      }
+      // fields: label admin_code race income lat lon [elevation]
+      record.items = Utils::fred_get_tokens(line, end, token, 7);
+      if (6 <= record.items) {
+	record.label = token[0];
+	record.admin_code = strtoll(token[1], NULL, 10);
+	record.race = atoi(token[2]);
+	record.income = atoi(token[3]);
+	record.lat = strtod(token[4], NULL);
+	record.lon = strtod(token[5], NULL);
+	record.elevation = (record.items == 7) ? strtod(token[6], NULL) : 0.0;
+      }
+      records[k].push_back(record);
+      line = end + 1;
+    }
+  }
 
-    sscanf(label, "%lld", &sp_id);
-    if(!Group::sp_id_exists(sp_id + 100000000)) {
-      // negative income disallowed
-      if(income < 0) {
-        income = 0;
+  // add the households in file order, stopping at the first incomplete line
+  bool done = false;
+  for (int k = 0; k < chunks && done == false; ++k) {
+    for (int i = 0; i < records[k].size(); ++i) {
+      household_record_t* record = &records[k][i];
+      if (record->items < 6) {
+	done = true;
+	break;
       }
+      // a missing elevation keeps the value from the previous line
+      if (record->items == 7) {
+	elevation = record->elevation;
+      }
+      double lat = record->lat;
+      double lon = record->lon;
+      int income = record->income;
+      int label_len = Utils::fred_get_token_length(record->label);
+
+      sp_id = strtoll(record->label, NULL, 10);
+      if(!Group::sp_id_exists(sp_id + 100000000)) {
+	// negative income disallowed
+	if(income < 0) {
+	  income = 0;
+	}
 
-      sprintf(new_label, "H-%s", label);
+	sprintf(new_label, "H-%.*s", label_len, record->label);
 
-      Household* place = static_cast<Household*>(add_place(new_label, type_id, place_subtype, lon, lat, elevation, admin_code));
-      place->set_sp_id(sp_id + 100000000);
+	Household* place = static_cast<Household*>(add_place(new_label, type_id, place_subtype, lon, lat, elevation, record->admin_code));
+	place->set_sp_id(sp_id + 100000000);
 
-      // household race and income
-      place->set_household_race(race);
-      place->set_income(income);
+	// household race and income
+	place->set_household_race(record->race);
+	place->set_income(income);
 
-      n++;
+	n++;
 
-      Place::update_geo_boundaries(lat, lon);
+	Place::update_geo_boundaries(lat, lon);
+      }
     }
-
-    // get next line
-    strcpy(line, "");
-    fgets(line, FRED_STRING_SIZE, fp);
-    items = sscanf(line, "%s %lld %d %d %lf %lf %lf", label, &admin_code, &race, &income, &lat, &lon, &elevation);
-
   }
-  fclose(fp);
+  delete[] records;
   FRED_VERBOSE(0, "finished reading in %d households\n", n);
   return;
 }
@@ -848,6 +872,9 @@ void Place::read_workplace_file(char* location_file) {
     fgets(line, FRED_STRING_SIZE, fp);
     items = sscanf(line, "%s %lf %lf %lf", label, &lat, &lon, &elevation);
   }
+  if(ferror(fp)) {
+    Utils::fred_abort("error reading %s\n", location_file);
+  }
   fclose(fp);
   return;
 }
@@ -867,6 +894,7 @@ void Place::read_hospital_file(char* location_file) {
   int workers;
   int physicians;
   int beds;
+  char subtype;
   long long int admin_code = 0;
   long long int sp_id = 0;
 
@@ -882,9 +910,14 @@ void Place::read_hospital_file(char* location_file) {
     // read first data line
     strcpy(line, "");
     fgets(line, FRED_STRING_SIZE, fp);
-    int items = sscanf(line, "%s %d %d %d %lf %lf %lf", label, &workers, &physicians, &beds, &lat, &lon, &elevation);
+    int items = sscanf(line, "%s %d %d %d %lf %lf %lf %c", label, &workers, &physicians, &beds, &lat, &lon, &elevation, &subtype);
 
     while (6 <= items) {
+      // an optional last column marks clinics, which have no overnight stays
+      place_subtype = Place::SUBTYPE_NONE;
+      if(items == 8 && (subtype == Place::SUBTYPE_HEALTHCARE_CLINIC || subtype == Place::SUBTYPE_MOBILE_HEALTHCARE_CLINIC)) {
+        place_subtype = subtype;
+      }
       sprintf(new_label, "M-%s", label);
       sscanf(label, "%lld", &sp_id);
       if(!Group::sp_id_exists(sp_id + 600000000)) {
@@ -904,7 +937,10 @@ void Place::read_hospital_file(char* location_file) {
       // read next data line
       strcpy(line, "");
       fgets(line, FRED_STRING_SIZE, fp);
-      items = sscanf(line, "%s %d %d %d %lf %lf %lf", label, &workers, &physicians, &beds, &lat, &lon, &elevation);
+      items = sscanf(line, "%s %d %d %d %lf %lf %lf %c", label, &workers, &physicians, &beds, &lat, &lon, &elevation, &subtype);
+    }
+    if(ferror(fp)) {
+      Utils::fred_abort("error reading %s\n", location_file);
     }
     fclose(fp);
   }
@@ -961,6 +997,9 @@ void Place::read_school_file(char* location_file) {
     fgets(line, FRED_STRING_SIZE, fp);
     items = sscanf(line, "%s %lld %lf %lf %lf", label, &admin_code, &lat, &lon, &elevation);
   }
+  if(ferror(fp)) {
+    Utils::fred_abort("error reading %s\n", location_file);
+  }
   fclose(fp);
   return;
 }
@@ -1063,6 +1102,9 @@ void Place::read_group_quarters_file(char* location_file) {
     fgets(line, FRED_STRING_SIZE, fp);
     items = sscanf(line, "%s %c %lld %d %lf %lf %lf", id, &gq_type, &admin_code, &capacity, &lat, &lon, &elevation);
   }
+  if(ferror(fp)) {
+    Utils::fred_abort("error reading %s\n", location_file);
+  }
   fclose(fp);
   return;
 }
@@ -1111,6 +1153,9 @@ void Place::read_place_file(char* location_file, int type_id) {
       sp_id = Place_Type::get_place_type(type_id)->get_next_sp_id();
     }
   }
+  if(ferror(fp)) {
+    Utils::fred_abort("error reading %s\n", location_file);
+  }
   fclose(fp);
   return;
 }
@@ -1129,6 +1174,13 @@ void Place::setup_block_groups() {
     Block_Group* block_group = Block_Group::get_block_group_with_admin_code(admin_code);
     block_group->add_household(place);
 
+    // record the household's divisions for the dense admin state counters
+    Household* household = static_cast<Household*>(place);
+    Admin_Division* census_tract = block_group->get_higher_division();
+    household->set_admin_division_index(Admin_Level::BLOCK_GROUP, block_group->get_index());
+    household->set_admin_division_index(Admin_Level::CENSUS_TRACT, census_tract->get_index());
+    household->set_admin_division_index(Admin_Level::COUNTY, census_tract->get_higher_division()->get_index());
+
   }
 
   FRED_VERBOSE(0, "setup_block_groups finished BLOCK\n");
@@ -1572,6 +1624,8 @@ void Place::setup_partitions() {
 
 void Place::reassign_workers() {
 
+  Global::Simulation_Region->prepare_workplace_index();
+
   if(Global::Assign_Teachers) {
     reassign_workers_to_schools();
   }
@@ -1606,6 +1660,8 @@ void Place::reassign_workers_to_schools() {
   Utils::fred_log("reassign workers to schools entered. schools = %d fixed_staff = %d staff_ratio = %f \n",
       number_of_schools, fixed_staff, staff_ratio);
 
+  place_vector_t targets;
+  int_vector_t target_staff;
   for(int p = 0; p < number_of_schools; p++) {
     Place* school = get_school(p);
     fred::geo lat = school->get_latitude();
@@ -1632,15 +1688,12 @@ void Place::reassign_workers_to_schools() {
     FRED_VERBOSE(1, "school %s students %d fixed_staff = %d tot_staff = %d\n",
         school->get_label(), n, fixed_staff, staff);
 
-    Place* nearby_workplace = regional_patch->get_nearby_workplace(school, staff);
-    if(nearby_workplace != NULL) {
-      // make all the workers in selected workplace teachers at the nearby school
-      nearby_workplace->turn_workers_into_teachers(school);
-    } else {
-      FRED_VERBOSE(0, "NO NEARBY_WORKPLACE FOUND FOR SCHOOL %s in county %d at lat %f lon %f \n",
-          school->get_label(), school->get_county_admin_code(), lat, lon);
-    }
+    targets.push_back(school);
+    target_staff.push_back(staff);
   }
+
+  // make all the workers in the selected workplaces teachers at the nearby schools
+  Place::reassign_workers_from_nearby_workplaces(targets, target_staff, true);
 }
 
 void Place::reassign_workers_to_hospitals() {
@@ -1651,6 +1704,8 @@ void Place::reassign_workers_to_hospitals() {
   int fixed_staff = Place::Hospital_fixed_staff;
   double staff_ratio = (1.0 / Place::Hospital_worker_to_bed_ratio);
 
+  place_vector_t targets;
+  int_vector_t target_staff;
   for(int p = 0; p < number_places; p++) {
     Hospital* hosp = get_hospital(p);
     fred::geo lat = hosp->get_latitude();
@@ -1675,20 +1730,19 @@ void Place::reassign_workers_to_hospitals() {
       staff += (0.5 + (double)n / staff_ratio);
     }
     
-    Place* nearby_workplace = regional_patch->get_nearby_workplace(hosp, staff);
-    if(nearby_workplace != NULL) {
-      // make all the workers in selected workplace as workers in the target place
-      nearby_workplace->reassign_workers(hosp);
-    } else {
-      FRED_VERBOSE(0, "NO NEARBY_WORKPLACE FOUND for hospital %s in county %d at lat %f lon %f \n",
-          hosp->get_label(), hosp->get_county_admin_code(), lat, lon);
-    }
+    targets.push_back(hosp);
+    target_staff.push_back(staff);
   }
+
+  // make all the workers in the selected workplaces workers in the hospitals
+  Place::reassign_workers_from_nearby_workplaces(targets, target_staff, false);
 }
 
 void Place::reassign_workers_to_group_quarters(char subtype, int fixed_staff, double resident_to_staff_ratio) {
   int number_places = get_number_of_workplaces();
   Utils::fred_log("reassign workers to group quarters subtype %c entered. total workplaces = %d\n", subtype, number_places);
+  place_vector_t targets;
+  int_vector_t target_staff;
   for(int p = 0; p < number_places; ++p) {
     Place* place = get_workplace(p);
     if(place->get_subtype() == subtype) {
@@ -1712,16 +1766,61 @@ void Place::reassign_workers_to_group_quarters(char subtype, int fixed_staff, do
         continue;
       }
 
-      Place* nearby_workplace = regional_patch->get_nearby_workplace(place, staff);
-      if(nearby_workplace != NULL) {
-        // make all the workers in selected workplace as workers in the target place
-        FRED_VERBOSE(0, "REASSIGN WORKERS: NEARBY_WORKPLACE FOUND %s for GQ %s subtype %c at lat %f lon %f \n",
-            nearby_workplace->get_label(), place->get_label(), subtype, lat, lon);
-        nearby_workplace->reassign_workers(place);
-      }
-      else {
-        FRED_VERBOSE(0, "REASSIGN WORKERS: NO NEARBY_WORKPLACE FOUND for GQ %s subtype %c at lat %f lon %f \n", place->get_label(), subtype, lat, lon);
-      }
+      targets.push_back(place);
+      target_staff.push_back(staff);
+    }
+  }
+
+  // make all the workers in the selected workplaces workers in the group quarters
+  Place::reassign_workers_from_nearby_workplaces(targets, target_staff, false);
+}
+
+// Each target takes the workers of the nearest workplace whose size is
+// within 25% of its target staff. The searches run concurrently; a target
+// is searched again if an earlier target has since changed the workplace
+// found for it, or has left workers in a workplace of the right size, so
+// the result is as if the targets were served one at a time in order.
+
+void Place::reassign_workers_from_nearby_workplaces(place_vector_t &targets, int_vector_t &staff, bool make_teachers) {
+  int n = targets.size();
+  std::vector<workplace_query_t> queries(n);
+  for(int i = 0; i < n; ++i) {
+    queries[i].x = Geo::get_x(targets[i]->get_longitude());
+    queries[i].y = Geo::get_y(targets[i]->get_latitude());
+    queries[i].min_staff = std::max(1, (int)(0.75 * staff[i]));
+    queries[i].max_staff = (int)(0.5 + 1.25 * staff[i]);
+  }
+  place_vector_t found;
+  Global::Simulation_Region->get_nearest_workplaces(queries, &found);
+
+  std::set<Place*> used;
+  place_vector_t partly_used;
+  for(int i = 0; i < n; ++i) {
+    Place* target = targets[i];
+    Place* nearby_workplace = found[i];
+    bool stale = (nearby_workplace != NULL && used.find(nearby_workplace) != used.end());
+    for(int j = 0; j < static_cast<int>(partly_used.size()) && !stale; ++j) {
+      int size = partly_used[j]->get_size();
+      stale = (queries[i].min_staff <= size && size <= queries[i].max_staff);
+    }
+    if(stale) {
+      nearby_workplace = Global::Simulation_Region->get_nearest_workplace(queries[i]);
+    }
+    if(nearby_workplace == NULL) {
+      FRED_VERBOSE(0, "NO NEARBY_WORKPLACE FOUND for %s %s in county %d at lat %f lon %f \n",
+          Place_Type::get_place_type_name(target->get_type_id()).c_str(), target->get_label(), target->get_county_admin_code(),
+          target->get_latitude(), target->get_longitude());
+      continue;
+    }
+    FRED_VERBOSE(1, "nearby workplace %s size %d target %s staff %d\n",
+        nearby_workplace->get_label(), nearby_workplace->get_size(), target->get_label(), staff[i]);
+    if(make_teachers) {
+      nearby_workplace->turn_workers_into_teachers(target);
+    } else {
+      nearby_workplace->reassign_workers(target);
+    }
+    if(used.insert(nearby_workplace).second && nearby_workplace->get_size() > 0) {
+      partly_used.push_back(nearby_workplace);
     }
   }
 }
@@ -1755,6 +1854,10 @@ Place* Place::get_random_school(int grade) {
 }
 
 
+// households are assigned to hospitals in blocks of this many, each
+// block drawing from its own random number stream
+#define HOSPITAL_ASSIGNMENT_BLOCK 4096
+
 void Place::assign_hospitals_to_households() {
 
   if(!Global::Enable_Hospitals) {
@@ -1764,18 +1867,50 @@ void Place::assign_hospitals_to_households() {
   FRED_STATUS(0, "assign_hospitals_to_household entered\n");
 
   int number_hh = (int)get_number_of_households();
+  Place::household_hospital.assign(number_hh, -1);
+  Place::read_household_hospital_map_file();
+
+  // the catchment of every patch with households is found before the
+  // households are assigned concurrently
+  int unassigned = 0;
   for(int i = 0; i < number_hh; ++i) {
-    Household* hh = get_household(i);
-    Hospital* hosp = static_cast<Hospital*>(Place::get_hospital_assigned_to_household(hh));
-    assert(hosp != NULL);
-    if(hosp != NULL) {
-      hh->set_household_visitation_hospital(hosp);
-      string hh_label_str(hh->get_label());
-      string hosp_label_str(hosp->get_label());
+    if(Place::household_hospital[i] < 0) {
+      Household* hh = get_household(i);
+      Regional_Patch* patch = Global::Simulation_Region->get_patch(hh);
+      if(patch != NULL && patch->has_hospital_catchment() == false) {
+        Place::prepare_hospital_catchment(patch);
+      }
+      unassigned++;
+    }
+  }
+  if(unassigned > 0) {
+    // the map file is missing or incomplete, so write a new one
+    Place::Household_hospital_map_file_exists = false;
+  }
 
-      Place::hh_label_hosp_label_map.insert(std::pair<string, string>(hh_label_str, hosp_label_str));
+  // seed the stream of each block from the main stream, so that the
+  // assignments do not depend on the number of threads
+  int blocks = (number_hh + HOSPITAL_ASSIGNMENT_BLOCK - 1) / HOSPITAL_ASSIGNMENT_BLOCK;
+  RNG* block_rng = new RNG [blocks];
+  for(int b = 0; b < blocks; ++b) {
+    block_rng[b].set_seed(Random::draw_random_int(0, INT_MAX - 1));
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for(int b = 0; b < blocks; ++b) {
+    Random::use_stream(&block_rng[b]);
+    int last = std::min(number_hh, (b + 1) * HOSPITAL_ASSIGNMENT_BLOCK);
+    for(int i = b * HOSPITAL_ASSIGNMENT_BLOCK; i < last; ++i) {
+      if(Place::household_hospital[i] < 0) {
+        Hospital* hosp = Place::get_hospital_assigned_to_household(get_household(i));
+        if(hosp != NULL) {
+          Place::household_hospital[i] = hosp->get_index();
+        }
+      }
     }
+    Random::use_stream(NULL);
   }
+  delete[] block_rng;
 
   int number_hospitals = get_number_of_hospitals();
   int catchment_count[number_hospitals];
@@ -1789,15 +1924,10 @@ void Place::assign_hospitals_to_households() {
 
   for(int i = 0; i < number_hh; ++i) {
     Household* hh = get_household(i);
-    Hospital* hosp = hh->get_household_visitation_hospital();
-    assert(hosp != NULL);
-    string hosp_label_str(hosp->get_label());
-    int hosp_id = -1;
-    if(Place::hosp_label_hosp_id_map.find(hosp_label_str) != Place::hosp_label_hosp_id_map.end()) {
-      hosp_id = Place::hosp_label_hosp_id_map.find(hosp_label_str)->second;
-    }
+    int hosp_id = Place::household_hospital[i];
     assert(0 <= hosp_id && hosp_id < number_hospitals);
-    // printf("CATCH house %s hosp_id %d %s\n", hh->get_label(), hosp_id, hosp->get_label());
+    Hospital* hosp = get_hospital(hosp_id);
+    hh->set_household_visitation_hospital(hosp);
     catchment_count[hosp_id] += hh->get_size();
     catchment_dist[hosp_id] += hh->get_size()*(Place::distance_between_places(hh,hosp));
     for (int j = 0; j < hh->get_size(); j++) {
@@ -1819,36 +1949,70 @@ void Place::assign_hospitals_to_households() {
 
   //Write the mapping file if it did not already exist (or if it was incomplete)
   if(!Place::Household_hospital_map_file_exists) {
+    Place::write_household_hospital_map_file();
+  }
 
-    char map_file_dir[FRED_STRING_SIZE];
-    char map_file_name[FRED_STRING_SIZE];
-    Property::get_property("Household_Hospital_map_file_directory", map_file_dir);
-    Property::get_property("Household_Hospital_map_file", map_file_name);
+  FRED_STATUS(0, "assign_hospitals_to_household finished\n");
+}
 
-    if(strcmp(map_file_name, "none") == 0) {
-      Place::hh_label_hosp_label_map.clear();
-      return;
-    }
+void Place::read_household_hospital_map_file() {
+  if(strcmp(Place::Household_hospital_map_file, "none") == 0) {
+    Place::Household_hospital_map_file_exists = false;
+    return;
+  }
 
-    char filename[FRED_STRING_SIZE];
-    sprintf(filename, "%s%s", map_file_dir, map_file_name);
+  char filename[FRED_STRING_SIZE];
+  strcpy(filename, Place::Household_hospital_map_file);
+  FILE* fp = Utils::fred_open_file(filename);
+  if(fp == NULL) {
+    Place::Household_hospital_map_file_exists = false;
+    return;
+  }
+  Place::Household_hospital_map_file_exists = true;
 
-    Utils::get_fred_file_name(filename);
-    FILE* hh_label_hosp_label_map_fp = fopen(filename, "w");
-    if(hh_label_hosp_label_map_fp == NULL) {
-      Utils::fred_abort("Can't open %s\n", filename);
+  // each line holds a household label and a hospital label, separated by
+  // a comma. The hospital label may carry the "M-" prefix of its place.
+  char line[FRED_STRING_SIZE];
+  while(fgets(line, FRED_STRING_SIZE, fp) != NULL) {
+    char* comma = strchr(line, ',');
+    if(comma == NULL) {
+      continue;
     }
-
-    for(std::map<std::string, string>::iterator itr = Place::hh_label_hosp_label_map.begin(); itr != Place::hh_label_hosp_label_map.end(); ++itr) {
-      fprintf(hh_label_hosp_label_map_fp, "%s,%s\n", itr->first.c_str(), itr->second.c_str());
+    *comma = '\0';
+    char* hosp_label = comma + 1;
+    hosp_label[strcspn(hosp_label, "\r\n")] = '\0';
+    if(strncmp(hosp_label, "M-", 2) == 0) {
+      hosp_label += 2;
+    }
+    if(strcmp(line, "hh_id") == 0 || strcmp(line, "sp_id") == 0) {
+      continue;
     }
+    Place* hh = Place::get_household_from_label(line);
+    std::map<std::string, int>::iterator itr = Place::hosp_label_hosp_id_map.find(string(hosp_label));
+    if(hh != NULL && itr != Place::hosp_label_hosp_id_map.end()) {
+      Place::household_hospital[hh->get_index()] = itr->second;
+    }
+  }
+  fclose(fp);
+}
 
-    fflush(hh_label_hosp_label_map_fp);
-    fclose(hh_label_hosp_label_map_fp);
+void Place::write_household_hospital_map_file() {
+  if(strcmp(Place::Household_hospital_map_file, "none") == 0) {
+    return;
   }
 
-  Place::hh_label_hosp_label_map.clear();
-  FRED_STATUS(0, "assign_hospitals_to_household finished\n");
+  char filename[FRED_STRING_SIZE];
+  strcpy(filename, Place::Household_hospital_map_file);
+  Utils::get_fred_file_name(filename);
+  FILE* fp = fopen(filename, "w");
+  if(fp == NULL) {
+    Utils::fred_abort("Can't open %s\n", filename);
+  }
+  int number_hh = Place::household_hospital.size();
+  for(int i = 0; i < number_hh; ++i) {
+    fprintf(fp, "%s,%s\n", get_household(i)->get_label(), get_hospital(Place::household_hospital[i])->get_label());
+  }
+  fclose(fp);
 }
 
 void Place::prepare_primary_care_assignment() {
@@ -1875,104 +2039,99 @@ void Place::prepare_primary_care_assignment() {
 }
 
 Hospital* Place::get_random_open_hospital_matching_criteria(int sim_day, Person* per, bool check_insurance) {
-  return NULL;
-  /*
   if(!Global::Enable_Hospitals) {
     return NULL;
   }
 
-  if(check_insurance) {
-    assert(Global::Enable_Health_Insurance);
-  }
   assert(per != NULL);
-
-  int overnight_cap = 0;
-  Hospital* assigned_hospital = NULL;
-  Household* hh = per->get_household();
+  Place* hh = per->get_household();
+  if(hh == NULL) {
+    hh = per->get_permanent_household();
+  }
   assert(hh != NULL);
 
-  // ignore place if it is outside the region
-  fred::geo lat = hh->get_latitude();
-  fred::geo lon = hh->get_longitude();
-  Regional_Patch* hh_patch = Global::Simulation_Region->get_patch(lat, lon);
+  Regional_Patch* patch = Global::Simulation_Region->get_patch(hh);
+  if(patch == NULL) {
+    return NULL;
+  }
+  if(patch->has_hospital_catchment() == false) {
+    Place::prepare_hospital_catchment(patch);
+  }
+  return Place::select_hospital_in_catchment(patch, sim_day, per, check_insurance);
+}
+
+// The catchment of a patch holds its Hospital_catchment_size nearest
+// hospitals that allow overnight stays, with gravity weights bed_count /
+// distance measured from the center of the patch. Hospitals inside the
+// patch are taken to be at least half a patch away.
+
+void Place::prepare_hospital_catchment(Regional_Patch* patch) {
+  double x = patch->get_center_x();
+  double y = patch->get_center_y();
+  double min_dist = 0.5 * Global::Simulation_Region->get_patch_size();
+  place_vector_t nearest;
+  Global::Simulation_Region->get_nearest_hospitals(x, y, Place::Hospital_catchment_size, &nearest);
+  place_vector_t hospitals;
+  double_vector_t weights;
+  for(int i = 0; i < static_cast<int>(nearest.size()); ++i) {
+    Hospital* hospital = static_cast<Hospital*>(nearest[i]);
+    double dx = Geo::get_x(hospital->get_longitude()) - x;
+    double dy = Geo::get_y(hospital->get_latitude()) - y;
+    double distance = std::max(sqrt(dx * dx + dy * dy), min_dist);
+    hospitals.push_back(hospital);
+    weights.push_back(static_cast<double>(hospital->get_bed_count(0)) / distance);
+  }
+  patch->set_hospital_catchment(hospitals, weights);
+}
+
+// Draw a hospital from the catchment of the patch in proportion to its
+// weight, among those that are open, have a free bed and, if
+// check_insurance is set, accept the insurance of the person.
 
-  vector<Place*> possible_hosp = Global::Simulation_Region->get_nearby_hospitals(hh_patch->get_row(), hh_patch->get_col(), lat, lon, 5);
-  int number_hospitals = static_cast<int>(possible_hosp.size());
-  if(number_hospitals <= 0) {
+Hospital* Place::select_hospital_in_catchment(Regional_Patch* patch, int sim_day, Person* per, bool check_insurance) {
+  if(check_insurance) {
+    assert(Global::Enable_Health_Insurance);
+  }
+  const place_vector_t &hospitals = patch->get_catchment_hospitals();
+  const double_vector_t &weights = patch->get_catchment_weights();
+  int number_hospitals = hospitals.size();
+  if(number_hospitals == 0) {
     Utils::fred_abort("Found no nearby Hospitals in simulation that has Enabled Hospitalization", "");
   }
 
-  int number_possible_hospitals = 0;
-  //First, only try Hospitals within a certain radius (* that accept insurance)
-  std::vector<double> hosp_probs;
-  double probability_total = 0.0;
+  double eligible_weight[number_hospitals];
+  double total = 0.0;
   for(int i = 0; i < number_hospitals; ++i) {
-    Hospital* hospital = static_cast<Hospital*>(possible_hosp[i]);
-    double distance = Place::distance_between_places(hh, hospital);
-    double cur_prob = 0.0;
-    int increment = 0;
-    overnight_cap = hospital->get_bed_count(sim_day);
-    //Need to make sure place is not a healthcare clinic && there are beds available
-    if(distance > 0.0 && !hospital->is_healthcare_clinic() && !hospital->is_mobile_healthcare_clinic()
-       && hospital->should_be_open(sim_day)
-       && (hospital->get_occupied_bed_count() < overnight_cap)) {
-      if(check_insurance) {
-        Insurance_assignment_index::e per_insur = per->get_insurance_type();
-        if(hospital->accepts_insurance(per_insur)) {
-          //Hospital accepts the insurance so we are good
-          cur_prob = static_cast<double>(overnight_cap) / distance;
-          increment = 1;
-        } else {
-          //Not possible (Doesn't accept insurance)
-          cur_prob = 0.0;
-          increment = 0;
-        }
-      } else {
-        //We don't care about insurance so good to go
-        cur_prob = static_cast<double>(overnight_cap) / distance;
-        increment = 1;
-      }
-    } else {
-      //Not possible
-      cur_prob = 0.0;
-      increment = 0;
+    Hospital* hospital = static_cast<Hospital*>(hospitals[i]);
+    eligible_weight[i] = 0.0;
+    if(hospital->should_be_open(sim_day) == false
+       || hospital->get_occupied_bed_count() >= hospital->get_bed_count(sim_day)) {
+      continue;
     }
-    hosp_probs.push_back(cur_prob);
-    probability_total += cur_prob;
-    number_possible_hospitals += increment;
+    if(check_insurance && per != NULL && !hospital->accepts_insurance(per->get_insurance_type())) {
+      continue;
+    }
+    eligible_weight[i] = weights[i];
+    total += weights[i];
+  }
+  if(total <= 0.0) {
+    //No hospitals in the catchment match search criteria
+    return NULL;
   }
-  assert(static_cast<int>(hosp_probs.size()) == number_hospitals);
-  FRED_VERBOSE(1,"CATCH HOSP FOR HH %s number_hospitals %d number_poss_hosp %d\n",
-	       hh->get_label(), number_hospitals, number_possible_hospitals);
-
 
-  if(number_possible_hospitals > 0) {
-    if(probability_total > 0.0) {
-      for(int i = 0; i < number_hospitals; ++i) {
-        hosp_probs[i] /= probability_total;
-	// printf("%f ", hosp_probs[i]);
-      }
+  double r = Random::draw_random() * total;
+  for(int i = 0; i < number_hospitals; ++i) {
+    r -= eligible_weight[i];
+    if(r < 0.0 && eligible_weight[i] > 0.0) {
+      return static_cast<Hospital*>(hospitals[i]);
     }
-    // printf("\n");
-
-    double rand = Random::draw_random();
-    double cum_prob = 0.0;
-    int i = 0;
-    while(i < number_hospitals) {
-      cum_prob += hosp_probs[i];
-      if(rand < cum_prob) {
-	// printf("picked i = %d %f\n", i, hosp_probs[i]);
-        return static_cast<Hospital*>(possible_hosp[i]);
-      }
-      ++i;
+  }
+  for(int i = number_hospitals - 1; i >= 0; --i) {
+    if(eligible_weight[i] > 0.0) {
+      return static_cast<Hospital*>(hospitals[i]);
     }
-    printf("HOSP CATCHMENT picked default i = %d %f\n", number_hospitals-1, hosp_probs[number_hospitals-1]);
-    return static_cast<Hospital*>(possible_hosp[number_hospitals - 1]);
-  } else {
-    //No hospitals in the simulation match search criteria
-    return NULL;
   }
-  */
+  return NULL;
 }
 
 
@@ -2402,38 +2561,27 @@ void Place::combine_households(int house_index1, int house_index2) {
 
 Hospital* Place::get_hospital_assigned_to_household(Household* hh) {
   assert(Place::is_load_completed());
-  if(Place::hh_label_hosp_label_map.find(string(hh->get_label())) != Place::hh_label_hosp_label_map.end()) {
-    string hosp_label = Place::hh_label_hosp_label_map.find(string(hh->get_label()))->second;
-    if(Place::hosp_label_hosp_id_map.find(hosp_label) != Place::hosp_label_hosp_id_map.end()) {
-      int hosp_id = Place::hosp_label_hosp_id_map.find(hosp_label)->second;
-      return static_cast<Hospital*>(Place::get_hospital(hosp_id));
-    } else {
-      return NULL;
-    }
-  } else {
-    if(Place::Household_hospital_map_file_exists) {
-      //List is incomplete so set this so we can print out a new file
-      Place::Household_hospital_map_file_exists = false;
-    }
+  int index = hh->get_index();
+  if(index < static_cast<int>(Place::household_hospital.size()) && 0 <= Place::household_hospital[index]) {
+    return Place::get_hospital(Place::household_hospital[index]);
+  }
 
-    Hospital* hosp = NULL;
-    if(hh->get_size() > 0) {
-      Person* per = hh->get_member(0);
-      assert(per != NULL);
-      if(Global::Enable_Health_Insurance) {
-        hosp = Place::get_random_open_hospital_matching_criteria(0, per, true);
-      } else {
-        hosp = Place::get_random_open_hospital_matching_criteria(0, per, false);
-      }
+  Regional_Patch* patch = Global::Simulation_Region->get_patch(hh);
+  assert(patch != NULL && patch->has_hospital_catchment());
 
-      //If it still came back with nothing, ignore health insurance
-      if(hosp == NULL) {
-        hosp = Place::get_random_open_hospital_matching_criteria(0, per, false);
-      }
-    }
-    assert(hosp != NULL);
-    return hosp;
+  // the first resident's insurance is checked if insurance is enabled
+  Person* per = hh->get_size() > 0 ? hh->get_member(0) : NULL;
+  Hospital* hosp = NULL;
+  if(Global::Enable_Health_Insurance && per != NULL) {
+    hosp = Place::select_hospital_in_catchment(patch, 0, per, true);
+  }
+
+  //If it still came back with nothing, ignore health insurance
+  if(hosp == NULL) {
+    hosp = Place::select_hospital_in_catchment(patch, 0, per, false);
   }
+  assert(hosp != NULL);
+  return hosp;
 }
 
 void Place::update_population_dynamics(int day) {
@@ -2442,6 +2590,9 @@ void Place::update_population_dynamics(int day) {
     return;
   }
 
+  // record today's birthdays in the county indexes of residents
+  County::update_resident_index(day);
+
   int number_counties = County::get_number_of_counties();
   for(int i = 0; i < number_counties; ++i) {
     County::get_county_with_index(i)->update(day);
@@ -2471,7 +2622,7 @@ void Place::update_geo_boundaries(fred::geo lat, fred::geo lon) {
   return;
 }
 
-void Place::get_elevation_data() {
+Elevation_Layer* Place::get_elevation_data() {
 
   Utils::fred_print_lap_time("Places.get_elevation_started");
 
@@ -2483,82 +2634,96 @@ void Place::get_elevation_data() {
 
   printf("miny %d maxy %d minw %d maxw %d\n", miny,maxy,minw,maxw);
 
-  // read optional properties
-  Property::disable_abort_on_failure();
-  
-  char elevation_data_dir[FRED_STRING_SIZE];
-  sprintf(elevation_data_dir, "none");
-  Property::get_property("elevation_data_directory", elevation_data_dir);
+  const char* elevation_data_dir = Place::Elevation_data_directory;
+  const char* elevation_cache_dir = Place::Elevation_cache_directory;
+  int cells_per_degree = Place::Elevation_cells_per_degree;
 
-  // restore requiring properties
-  Property::set_abort_on_failure();
+  bool use_cache = strcmp(elevation_cache_dir, "none")!=0;
+  fred::geo min_lon = Global::Simulation_Region->get_min_lon();
+  fred::geo min_lat = Global::Simulation_Region->get_min_lat();
+  fred::geo max_lon = Global::Simulation_Region->get_max_lon();
+  fred::geo max_lat = Global::Simulation_Region->get_max_lat();
 
-  if (strcmp(elevation_data_dir, "none")==0) {
-    return;
+  // the elevation data files that cover the region
+  char key[FRED_STRING_SIZE];
+  char zip_file[FRED_STRING_SIZE];
+  std::vector<std::string> keys;
+  std::vector<std::string> zip_files;
+  if (strcmp(elevation_data_dir, "none")!=0) {
+    for(int y = miny; y <= maxy; ++y) {
+      for(int x = minw; x <= maxw; ++x) {
+        sprintf(key, "n%dw%03d", y, x);
+        sprintf(zip_file, "%s/%s.zip", elevation_data_dir, key);
+        printf("looking for %s\n", zip_file);
+        if(access(zip_file, R_OK) == 0) {
+          keys.push_back(key);
+          zip_files.push_back(zip_file);
+        }
+      }
+    }
+  }
+
+  Elevation_Layer* elevations = NULL;
+  if (use_cache && cells_per_degree > 0) {
+    elevations = new Elevation_Layer(min_lon, min_lat, max_lon, max_lat, cells_per_degree);
+    elevations->set_source(elevation_data_dir, zip_files);
+    if (elevations->load_cache(elevation_cache_dir)) {
+      Utils::fred_print_lap_time("Places.get_elevation");
+      return elevations;
+    }
+  }
+
+  if (zip_files.empty()) {
+    return elevations;
   }
 
   char outdir[FRED_STRING_SIZE];
   sprintf(outdir, "%s/ELEV", Global::Simulation_directory);
   Utils::fred_make_directory(outdir);
   char cmd[FRED_STRING_SIZE];
-  char key[FRED_STRING_SIZE];
-  char zip_file[FRED_STRING_SIZE];
   char elevation_file[FRED_STRING_SIZE];
 
-  for(int y = miny; y <= maxy; ++y) {
-    for(int x = minw; x <= maxw; ++x) {
-      sprintf(key, "n%dw%03d", y, x);
-      sprintf(zip_file, "%s/%s.zip", elevation_data_dir, key);
-      printf("looking for %s\n", zip_file);
-      FILE* ftest = fopen(zip_file, "r");
-      if(ftest != NULL) {
-        fclose(ftest);
-        printf("process zip file %s\n", zip_file); fflush(stdout);
-        sprintf(elevation_file, "%s/%s.txt", outdir, key);
-        printf("elevation_file = |%s|\n", elevation_file); fflush(stdout);
-        sprintf(cmd, "rm -f %s", elevation_file);
-        // printf("cmd = |%s|\n", cmd); fflush(stdout);
-        system(cmd);
-        sprintf(cmd, "unzip %s/%s -d %s", elevation_data_dir, key, outdir);
-        // printf("cmd = |%s|\n", cmd); fflush(stdout);
-        system(cmd);
-        FILE* fp = Utils::fred_open_file(elevation_file);
-        if(fp != NULL) {
-          fred::geo lat, lon;
-          double elev;
-          double x, y;
-          while(fscanf(fp, "%lf %lf %lf ", &x, &y, &elev) == 3) {
-            lat = y;
-            lon = x;
-            // printf("new elevation site %f %f %f\n", y,x,elev);
-            Neighborhood_Patch* patch = Global::Neighborhoods->get_patch(lat, lon);
-            if(patch != NULL) {
-              int row = patch->get_row();
-              int col = patch->get_col();
-              for(int r = row - 1; r <= row + 1; ++r) {
-                for(int c = col -1 ; c <= col + 1; ++c) {
-                  Neighborhood_Patch* p = Global::Neighborhoods->get_patch(r,c);
-                  if(p != NULL) {
-                    // printf("add elevation site %f %f %f to patch %d %d\n", y,x,elev,r,c);
-                    p->add_elevation_site(lat, lon, elev);
-                  }
-                }
-              }
-            } else {
-              // printf("no patch found for elevation site %f %f %f\n", y,x,elev); fflush(stdout);
-            }
-          }
-          fclose(fp);
-          Utils::fred_print_lap_time("Places.get_elevation process elevation file");
+  for(int i = 0; i < static_cast<int>(zip_files.size()); ++i) {
+    printf("process zip file %s\n", zip_files[i].c_str()); fflush(stdout);
+    sprintf(elevation_file, "%s/%s.txt", outdir, keys[i].c_str());
+    printf("elevation_file = |%s|\n", elevation_file); fflush(stdout);
+    sprintf(cmd, "rm -f %s", elevation_file);
+    system(cmd);
+    sprintf(cmd, "unzip %s/%s -d %s", elevation_data_dir, keys[i].c_str(), outdir);
+    system(cmd);
+
+    if (elevations == NULL) {
+      // the first elevation file determines the raster resolution
+      if (cells_per_degree <= 0) {
+        cells_per_degree = Elevation_Layer::get_cells_per_degree_of_file(elevation_file);
+      }
+      if (cells_per_degree > 0) {
+        elevations = new Elevation_Layer(min_lon, min_lat, max_lon, max_lat, cells_per_degree);
+        elevations->set_source(elevation_data_dir, zip_files);
+        if (use_cache && elevations->load_cache(elevation_cache_dir)) {
           unlink(elevation_file);
-        } else {
-          printf("file %s could not be opened\n", elevation_file); fflush(stdout);
-          exit(0);
+          Utils::fred_print_lap_time("Places.get_elevation");
+          return elevations;
         }
       }
     }
+
+    if(elevations == NULL || elevations->read_elevation_file(elevation_file) < 0) {
+      printf("file %s could not be opened\n", elevation_file); fflush(stdout);
+      exit(0);
+    }
+    Utils::fred_print_lap_time("Places.get_elevation process elevation file");
+    unlink(elevation_file);
+  }
+
+  if (elevations != NULL) {
+    elevations->finish_elevation_sites();
+    if (use_cache) {
+      elevations->save_cache(elevation_cache_dir);
+    }
   }
   Utils::fred_print_lap_time("Places.get_elevation");
+  return elevations;
 }
 
 void Place::update_household_file(char* location_file) {
@@ -3927,50 +4092,16 @@ void Place::update_elevations() {
 
   if (Place::Update_elevation) {
 
-    // add elevation sites to the appropriate neighborhood patches
-    Place::get_elevation_data();
+    // load the elevation raster for the simulation region
+    Elevation_Layer* elevations = Place::get_elevation_data();
 
     // get elevation info for each place
-    Neighborhood_Patch* patch;
-    for(int p = 0; p < get_number_of_households(); ++p) {
-      Place* place = get_household(p);
-      fred::geo lat = place->get_latitude();
-      fred::geo lon = place->get_longitude();
-      patch = Global::Neighborhoods->get_patch(lat, lon);
-      if(patch != NULL) {
-        place->set_elevation(patch->get_elevation(lat, lon));
-      }
-      // printf("household %d %s has elevation %f\n", p, place->get_label(), place->get_elevation());
-    }
-    for(int p = 0; p < Place::get_number_of_schools(); ++p) {
-      Place* place = get_school(p);
-      fred::geo lat = place->get_latitude();
-      fred::geo lon = place->get_longitude();
-      patch = Global::Neighborhoods->get_patch(lat, lon);
-      if(patch != NULL) {
-        place->set_elevation(patch->get_elevation(lat, lon));
-      }
-      // printf("school %s has elevation %f\n", place->get_label(), place->get_elevation());
-    }
-    for(int p = 0; p < get_number_of_workplaces(); ++p) {
-      Place* place = get_workplace(p);
-      fred::geo lat = place->get_latitude();
-      fred::geo lon = place->get_longitude();
-      patch = Global::Neighborhoods->get_patch(lat, lon);
-      if(patch != NULL) {
-        place->set_elevation(patch->get_elevation(lat, lon));
-      }
-      // printf("workplace %s has elevation %f\n", place->get_label(), place->get_elevation());
-    }
-    for(int p = 0; p < Place::get_number_of_hospitals(); ++p) {
-      Place* place = get_hospital(p);
-      fred::geo lat = place->get_latitude();
-      fred::geo lon = place->get_longitude();
-      patch = Global::Neighborhoods->get_patch(lat, lon);
-      if(patch != NULL) {
-        place->set_elevation(patch->get_elevation(lat, lon));
-      }
-      // printf("hospital %s has elevation %f\n", place->get_label(), place->get_elevation());
+    if (elevations != NULL) {
+      elevations->set_elevations(Place_Type::get_household_place_type());
+      elevations->set_elevations(Place_Type::get_school_place_type());
+      elevations->set_elevations(Place_Type::get_workplace_place_type());
+      elevations->set_elevations(Place_Type::get_hospital_place_type());
+      delete elevations;
     }
 
     // update input files for each specified location
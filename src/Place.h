@@ -42,10 +42,12 @@ typedef std::map<char, std::string> TypeNameMapT;
 typedef std::map<int, int> HospitalIDCountMapT;
 
 class Block_Group;
+class Elevation_Layer;
 class Household;
 class Hospital;
 class Neighborhood_Patch;
 class Person;
+class Regional_Patch;
 class School;
 
 class Place : public Group {
@@ -330,7 +332,7 @@ class Place : public Group {
   static void verify_pop_directory(const char* loc_id);
   static void read_places(const char* loc_id);
   static void read_gq_places(const char* loc_id);
-  static void get_elevation_data();
+  static Elevation_Layer* get_elevation_data();
   static Place* add_place(char* label, int place_type_id, char subtype, fred::geo lon, fred::geo lat, double elevation, long long int census_tract);
   static void save_place(Place* place) {
     Place::place_list.push_back(place);
@@ -339,7 +341,6 @@ class Place : public Group {
   static void quality_control();
   static void reassign_workers();
   static void prepare_places();
-  static void get_elevation(Place* place);
   static void setup_group_quarters();
   static void setup_households();
   static void setup_partitions();
@@ -379,6 +380,8 @@ class Place : public Group {
    * @property check_insurance whether or not to use the agent's insurance in the matching
    */
   static Hospital* get_random_open_hospital_matching_criteria(int sim_day, Person* per, bool check_insurance);
+  static Hospital* select_hospital_in_catchment(Regional_Patch* patch, int sim_day, Person* per, bool check_insurance);
+  static void prepare_hospital_catchment(Regional_Patch* patch);
 
   /**
    * Uses a gravity model to find a random open healthcare location given the search properties.
@@ -498,6 +501,8 @@ class Place : public Group {
   static place_vector_t get_candidate_places(Place* target, int type_id);
   static void read_place_file(char* location_file, int type);
   static Hospital* get_hospital_assigned_to_household(Household* hh);
+  static void read_household_hospital_map_file();
+  static void write_household_hospital_map_file();
   static void read_household_file(char* location_file);
   static void read_workplace_file(char* location_file);
   static void read_school_file(char* location_file);
@@ -511,6 +516,7 @@ class Place : public Group {
   static void reassign_workers_to_schools();
   static void reassign_workers_to_hospitals();
   static void reassign_workers_to_group_quarters(char subtype, int fixed_staff, double resident_to_staff_ratio);
+  static void reassign_workers_from_nearby_workplaces(place_vector_t &targets, int_vector_t &staff, bool make_teachers);
   static void prepare_primary_care_assignment();
   static void select_households_for_evacuation();
   static void evacuate_household(Household* h);
@@ -584,6 +590,11 @@ class Place : public Group {
   // update elevations of all places
   static bool Update_elevation;
 
+  // elevation data, raster resolution (0 for that of the data) and cache
+  static char Elevation_data_directory[FRED_STRING_SIZE];
+  static int Elevation_cells_per_degree;
+  static char Elevation_cache_directory[FRED_STRING_SIZE];
+
   // population properties
   static char Population_directory[];
   static char Country[];
@@ -607,10 +618,13 @@ class Place : public Group {
   static double Military_resident_to_staff_ratio;
 
   // Hospital support
-  static std::map<std::string, std::string>  hh_label_hosp_label_map;
   static std::map<std::string, int>  hosp_label_hosp_id_map;
 
+  // index of the hospital assigned to each household, or -1
+  static int_vector_t household_hospital;
   static bool Household_hospital_map_file_exists;
+  static char Household_hospital_map_file[FRED_STRING_SIZE];
+  static int Hospital_catchment_size;
   static int Hospital_fixed_staff;
   static double Hospital_worker_to_bed_ratio;
   static double Hospitalization_radius;
@@ -22,6 +22,7 @@
 #include "Condition.h"
 #include "Date.h"
 #include "Expression.h"
+#include "Factor.h"
 #include "Global.h"
 #include "Household.h"
 #include "Person.h"
@@ -87,6 +88,20 @@ Predicate::Predicate(string s) {
 }
 
 
+int Predicate::get_covariates() {
+  if (this->func == NULL) {
+    if (compare_map.find(this->predicate_str)!=compare_map.end()) {
+      return this->expression1->get_covariates() | this->expression2->get_covariates();
+    }
+    if (this->predicate_str=="range") {
+      return this->expression1->get_covariates() | this->expression2->get_covariates()
+	| this->expression3->get_covariates();
+    }
+  }
+  // built-in predicates and dates depend on the agent's current situation
+  return Covariate::DYNAMIC;
+}
+
 bool Predicate::get_value(Person* person, Person* other) {
 
   bool result = false;
@@ -42,6 +42,7 @@ public:
     return this->name;
   }
   bool get_value(Person* person1, Person* person2 = NULL);
+  int get_covariates();
   bool parse();
   bool is_warning() {
     return this->warning;
@@ -25,13 +25,16 @@
 
 #include <unordered_set>
 #include "Global.h"
+#include "Demographics.h"
 #include "Expression.h"
+#include "Factor.h"
 #include "Preference.h"
 #include "Person.h"
 #include "Random.h"
 
 Preference::Preference() {
   this->expressions.clear();
+  this->other_covariates = Covariate::NONE;
 }
 
 Preference::~Preference() {
@@ -64,6 +67,7 @@ void Preference::add_preference_expressions(string expr_str) {
       }
       else {
 	this->expressions.push_back(expression);
+	this->other_covariates |= expression->get_other_covariates();
 	// printf("ADD PREF expr %s\n", expression->get_name().c_str());
       }
     }
@@ -80,47 +84,102 @@ Person* Preference::select_person(Person* person, person_vector_t &people) {
     return NULL;
   }
 
-  // create a cdf based on preference values
-  double cdf [ psize ];
-  double total = 0.0;
+  // if the preference depends on the other person only through age and
+  // sex, select a stratum first
+  if ((this->other_covariates & ~(Covariate::AGE | Covariate::SEX)) == 0) {
+    Person* other = select_person_by_stratum(person, people);
+    if (other != NULL) {
+      return other;
+    }
+  }
+
+  // weighted reservoir sampling (Efraimidis and Spirakis): each person
+  // gets the key log(u)/w for a uniform draw u, and the largest key wins.
+  Person* other = NULL;
+  double max_key = 0.0;
   for (int i = 0; i < psize; i++) {
-    cdf[i] = get_value(person, people[i]);
-    total += cdf[i];
+    double value = get_value(person, people[i]);
+    if (value <= 0.0) {
+      continue;
+    }
+    double key = log(1.0 - Random::draw_random()) / value;
+    if (other == NULL || key > max_key) {
+      other = people[i];
+      max_key = key;
+    }
+  }
+
+  // select uniformly if no one has a positive value
+  if (other == NULL) {
+    other = people[Random::draw_random_int(0, psize-1)];
   }
+  return other;
+}
+
+Person* Preference::select_person_by_stratum(Person* person, person_vector_t &people) {
 
-  // create a cumulative density distribution
+  // everyone in a stratum of age and sex has the same preference value,
+  // so the value is computed once per stratum
+  const int strata = 2 * (Demographics::MAX_AGE + 1);
+  int count [ strata ];
+  int first [ strata ];
+  double weight [ strata ];
+  for (int s = 0; s < strata; s++) {
+    count[s] = 0;
+    first[s] = -1;
+  }
+
+  int psize = people.size();
   for (int i = 0; i < psize; i++) {
-    if (total > 0) {
-      cdf[i] /= total;
+    int age = people[i]->get_age();
+    if (age < 0 || Demographics::MAX_AGE < age) {
+      return NULL;
     }
-    else {
-      cdf[i] = 1.0 / psize;
+    int s = 2 * age + (people[i]->get_sex() == 'M');
+    if (count[s] == 0) {
+      first[s] = i;
     }
-    if (i > 0) {
-      cdf[i] += cdf[i-1];
+    count[s]++;
+  }
+
+  double total = 0.0;
+  for (int s = 0; s < strata; s++) {
+    weight[s] = 0.0;
+    if (count[s] > 0) {
+      double value = get_value(person, people[first[s]]);
+      if (value > 0.0) {
+	weight[s] = count[s] * value;
+	total += weight[s];
+      }
     }
-    // printf("cdf[%d] = %f\n", i, cdf[i]);
+  }
+  if (total <= 0.0) {
+    return people[Random::draw_random_int(0, psize-1)];
   }
 
-  // select
-  double r = Random::draw_random();
-  int p;
-  for (p = 0; p < psize; p++) {
-    if (r <= cdf[p]) {
-      break;
+  // select a stratum, then a person within the stratum
+  double r = Random::draw_random() * total;
+  int stratum = -1;
+  for (int s = 0; s < strata; s++) {
+    if (weight[s] > 0.0) {
+      stratum = s;
+      if (r < weight[s]) {
+	break;
+      }
+      r -= weight[s];
     }
   }
-  if (p == psize) {
-    p = psize-1;
+  int k = Random::draw_random_int(0, count[stratum]-1);
+  for (int i = 0; i < psize; i++) {
+    int s = 2 * people[i]->get_age() + (people[i]->get_sex() == 'M');
+    if (s == stratum) {
+      if (k == 0) {
+	return people[i];
+      }
+      k--;
+    }
   }
-  Person* other = people[p];
-  /*
-  printf("SELECT person %d age %f sex %c other person %d age %f sex %c value %f\n\n", 
-	 person->get_id(), person->get_real_age(), person->get_sex(),
-	 other->get_id(), other->get_real_age(), other->get_sex(), 
-	 p ? total*(cdf[p]-cdf[p-1]) : total*cdf[p]);
-  */
-  return other;
+  return NULL;
 }
 
 double Preference::get_value(Person* person, Person* other) {
@@ -39,7 +39,9 @@ public:
 
 private:
   expression_vector_t expressions;
+  int other_covariates;
   double get_value(Person* person, Person* other);
+  Person* select_person_by_stratum(Person* person, person_vector_t &people);
   string get_name();
 };
 
@@ -95,14 +95,16 @@ void Proximity_Transmission::transmission(int day, int hour, int condition_id, G
   // take into number of hours in the time_block
   contact_rate *= time_block;
 
-  // randomize the order of processing the transmissible list
-  std::vector<int> shuffle_index;
-  shuffle_index.clear();
-  shuffle_index.reserve(number_of_transmissibles);
-  for(int i = 0; i < number_of_transmissibles; ++i) {
-    shuffle_index.push_back(i);
+  // under common random numbers, the order is keyed by the place and
+  // each source draws from a stream keyed by the source and the place
+  RNG* previous_stream = Random::get_stream();
+  if(Global::Enable_Common_Random_Numbers) {
+    use_keyed_stream(RANDOM_SITE_PROXIMITY_ORDER, place->get_id(), condition_id, day, hour, 0);
   }
-  FYShuffle<int>(shuffle_index);
+
+  // randomize the order of processing the transmissible list
+  int_vector_t &shuffle_index = Transmission::source_order;
+  get_random_order(number_of_transmissibles, &shuffle_index);
 
   for(int n = 0; n < number_of_transmissibles; ++n) {
     int source_pos = shuffle_index[n];
@@ -115,6 +117,10 @@ void Proximity_Transmission::transmission(int day, int hour, int condition_id, G
       continue;
     }
 
+    if(Global::Enable_Common_Random_Numbers) {
+      use_keyed_stream(RANDOM_SITE_PROXIMITY_SOURCE, source->get_id(), condition_id, day, hour, place->get_id());
+    }
+
     // get the actual number of contacts to attempt to infect
     double real_contacts = contact_rate * source->get_transmissibility(condition_id);
 
@@ -132,7 +138,8 @@ void Proximity_Transmission::transmission(int day, int hour, int condition_id, G
       continue;
     }
 
-    std::vector<Person*> target;
+    person_vector_t &target = Transmission::contacts;
+    target.clear();
     // get a target for each contact attempt (with replacement)
     int count = 0;
     while (count < contact_count) {
@@ -186,6 +193,7 @@ void Proximity_Transmission::transmission(int day, int hour, int condition_id, G
       }
     } // end contact loop
   } // end transmissible list loop
+  Random::use_stream(previous_stream);
 
   if (0 && new_exposures > 0) {
     FRED_VERBOSE(1, "default_transmission DAY %d PLACE %s gives %d new_exposures\n",
@@ -27,6 +27,7 @@
 #include <float.h>
 
 Thread_RNG Random::Random_Number_Generator;
+thread_local RNG* Thread_RNG::stream = NULL;
 
 Thread_RNG::Thread_RNG() {
   thread_rng = new RNG [fred::omp_get_max_threads()];
@@ -46,6 +47,34 @@ void RNG::set_seed(unsigned long seed) {
   mt_engine.seed(seed);
 }
 
+void RNG::set_key(unsigned long long key) {
+  mt_engine.seed(key);
+  // forget any normal deviate left over from the previous key
+  normal_dist.reset();
+}
+
+// splitmix64 finalizer, applied after folding in each field of a key
+static unsigned long long mix_key(unsigned long long h, long long int x) {
+  h ^= (unsigned long long) x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+void Random::set_key(RNG* rng, int site, int id, int condition, int step, int value, int index) {
+  unsigned long long h = mix_key(0, Global::Simulation_seed);
+  h = mix_key(h, site);
+  h = mix_key(h, id);
+  h = mix_key(h, condition);
+  h = mix_key(h, step);
+  h = mix_key(h, value);
+  h = mix_key(h, index);
+  rng->set_key(h);
+}
+
 int RNG::draw_from_distribution(int n, double* dist) {
   double r = random();
   int i = 0;
@@ -159,22 +188,49 @@ double binomial_coefficient(int n, int k) {
   return c;
 }
 
+// samples this small use Floyd's algorithm, which needs no scratch space
+#define FLOYD_SAMPLE_LIMIT 16
+
 void RNG::sample_range_without_replacement(int N, int s, int* result) {
-  std::vector<bool> selected(N, false);
-  for(int n = 0; n < s; ++n) {
-    int i = random_int(0, N - 1);
-    if(selected[i]) {
-      if(i < N - 1 && !(selected[i + 1])) {
-        ++i;
-      } else if(i > 0 && !(selected[i - 1])) {
-        --i;
-      } else {
-        --n;
-        continue;
+  // draw s distinct integers from [0, N) into result, in random order
+  if(s > N) {
+    s = N;
+  }
+  if(s <= FLOYD_SAMPLE_LIMIT) {
+    int n = 0;
+    for(int j = N - s; j < N; ++j) {
+      int t = random_int(0, j);
+      for(int i = 0; i < n; ++i) {
+        if(result[i] == t) {
+          t = j;
+          break;
+        }
       }
+      result[n++] = t;
+    }
+    // Floyd's sample is not in random order
+    for(int i = s - 1; i > 0; --i) {
+      int j = random_int(0, i);
+      int tmp = result[i];
+      result[i] = result[j];
+      result[j] = tmp;
+    }
+  } else {
+    // partial Fisher-Yates shuffle of a permutation of [0, N) that is kept
+    // between calls; any permutation is a valid starting point
+    if(this->sample_index.size() != N) {
+      this->sample_index.resize(N);
+      for(int i = 0; i < N; ++i) {
+        this->sample_index[i] = i;
+      }
+    }
+    for(int i = 0; i < s; ++i) {
+      int j = random_int(i, N - 1);
+      int tmp = this->sample_index[i];
+      this->sample_index[i] = this->sample_index[j];
+      this->sample_index[j] = tmp;
+      result[i] = this->sample_index[i];
     }
-    selected[i] = true;
-    result[n] = i;
   }
 }
 
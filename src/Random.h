@@ -31,10 +31,22 @@
 #include "Global.h"
 using namespace std;
 
+// decision sites that draw from keyed streams under common random numbers
+enum {
+  RANDOM_SITE_TRANSITION = 1,
+  RANDOM_SITE_PROXIMITY_ORDER,
+  RANDOM_SITE_PROXIMITY_SOURCE,
+  RANDOM_SITE_NETWORK_ORDER,
+  RANDOM_SITE_NETWORK_SOURCE,
+  RANDOM_SITE_ENVIRONMENTAL_SOURCE,
+  RANDOM_SITE_ENVIRONMENTAL_HOST
+};
+
 class RNG {
 
 public:
   void set_seed(unsigned long seed);
+  void set_key(unsigned long long key);
   double random() {
     return unif_dist(mt_engine);
   }
@@ -57,6 +69,9 @@ private:
   std::mt19937_64 mt_engine;
   std::uniform_real_distribution<double> unif_dist;
   std::normal_distribution<double> normal_dist;
+
+  // scratch permutation for sampling without replacement
+  std::vector<int> sample_index;
 };
 
 
@@ -65,42 +80,56 @@ public:
   Thread_RNG();
 
   void set_seed(unsigned long seed);
+
+  // the generator used by the calling thread: its own stream, unless the
+  // thread has selected a different one with set_stream()
+  RNG* get_rng() {
+    return Thread_RNG::stream != NULL ? Thread_RNG::stream : &thread_rng[fred::omp_get_thread_num()];
+  }
+  static void set_stream(RNG* rng) {
+    Thread_RNG::stream = rng;
+  }
+  static RNG* get_stream() {
+    return Thread_RNG::stream;
+  }
+
   double get_random() {
-    return thread_rng[fred::omp_get_thread_num()].random();
+    return get_rng()->random();
   }
   double get_random(double low, double high) {
-    return low + (high-low)*thread_rng[fred::omp_get_thread_num()].random();
+    return low + (high-low)*get_rng()->random();
   }
   int get_random_int(int low, int high) {
-    return thread_rng[fred::omp_get_thread_num()].random_int(low,high);
+    return get_rng()->random_int(low,high);
   }
   int draw_from_cdf(double *v, int size) {
-    return thread_rng[fred::omp_get_thread_num()].draw_from_cdf(v, size);
+    return get_rng()->draw_from_cdf(v, size);
   }
   int draw_from_cdf_vector(const std::vector <double>& v) {
-    return thread_rng[fred::omp_get_thread_num()].draw_from_cdf_vector(v);
+    return get_rng()->draw_from_cdf_vector(v);
   }
   int draw_from_distribution(int n, double *dist) {
-    return thread_rng[fred::omp_get_thread_num()].draw_from_distribution(n, dist);
+    return get_rng()->draw_from_distribution(n, dist);
   }
   double exponential(double lambda) {
-    return thread_rng[fred::omp_get_thread_num()].exponential(lambda);
+    return get_rng()->exponential(lambda);
   }
   double normal(double mu, double sigma) {
-    return thread_rng[fred::omp_get_thread_num()].normal(mu, sigma);
+    return get_rng()->normal(mu, sigma);
   }
   double lognormal(double mu, double sigma) {
-    return thread_rng[fred::omp_get_thread_num()].lognormal(mu, sigma);
+    return get_rng()->lognormal(mu, sigma);
   }
   int geometric(double p) {
-    return thread_rng[fred::omp_get_thread_num()].geometric(p);
+    return get_rng()->geometric(p);
   }
   void sample_range_without_replacement(int N, int s, int* result) {
-    thread_rng[fred::omp_get_thread_num()].sample_range_without_replacement(N, s, result);
+    get_rng()->sample_range_without_replacement(N, s, result);
   }
 
 private:
   RNG * thread_rng;
+  static thread_local RNG* stream;
 };
 
 class Random {
@@ -142,6 +171,24 @@ public:
     Random_Number_Generator.sample_range_without_replacement(N,s,result);
   }
 
+  // draw the calling thread's numbers from the given generator instead
+  // of its own stream; NULL restores the thread's own stream
+  static void use_stream(RNG* rng) {
+    Thread_RNG::set_stream(rng);
+  }
+
+  // the generator selected with use_stream(), or NULL
+  static RNG* get_stream() {
+    return Thread_RNG::get_stream();
+  }
+
+  // common random numbers: seed rng from the simulation seed and the key
+  // of one decision -- the site making it, the person or group it is
+  // made for, the condition, the simulation step and a site-specific
+  // value and index -- so that a decision that an intervention does not affect
+  // draws the same numbers in every scenario run with the same seed
+  static void set_key(RNG* rng, int site, int id, int condition, int step, int value = 0, int index = 0);
+
 private:
   static Thread_RNG Random_Number_Generator;
 };
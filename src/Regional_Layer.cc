@@ -53,6 +53,10 @@ Regional_Layer::Regional_Layer(fred::geo minlon, fred::geo minlat, fred::geo max
 
   // read in the patch size for this layer
   Property::get_property("regional_patch_size", &this->patch_size);
+  Property::get_property("workplace_reassignment_radius", &this->workplace_reassignment_radius);
+  this->workplace_bucket_size = 0.0;
+  this->workplace_bucket_rows = 0;
+  this->workplace_bucket_cols = 0;
 
   // find the global x,y coordinates of SW corner of grid
   this->min_x = Geo::get_x(this->min_lon);
@@ -237,62 +241,169 @@ void Regional_Layer::add_hospital(Place* place) {
   }
 }
 
-Place* Regional_Layer::get_nearby_workplace(int row, int col, double x, double y, int min_staff, int max_staff, double* min_dist) {
-  //find nearest workplace that has right number of employees
-  Place* nearby_workplace = NULL;
-  *min_dist = 1e99;
-  for(int i = row - 1; i <= row + 1; ++i) {
-    for(int j = col - 1; j <= col + 1; ++j) {
-      Regional_Patch * patch = get_patch(i, j);
-      if(patch != NULL) {
-        // printf("Looking for nearby workplace in row %d col %d\n", i, j); fflush(stdout);
-        Place* closest_workplace = patch->get_closest_workplace(x, y, min_staff, max_staff,min_dist);
-        if(closest_workplace != NULL) {
-          nearby_workplace = closest_workplace;
-        } else {
-          // printf("No nearby workplace in row %d col %d\n", i, j); fflush(stdout);
+// Workplaces are indexed in buckets of this many per patch side, so that
+// a search for a nearby workplace visits few workplaces that are too far
+#define WORKPLACE_BUCKETS_PER_PATCH 8
+
+void Regional_Layer::prepare_workplace_index() {
+  this->workplace_bucket_size = this->patch_size / WORKPLACE_BUCKETS_PER_PATCH;
+  this->workplace_bucket_rows = this->rows * WORKPLACE_BUCKETS_PER_PATCH;
+  this->workplace_bucket_cols = this->cols * WORKPLACE_BUCKETS_PER_PATCH;
+  int buckets = this->workplace_bucket_rows * this->workplace_bucket_cols;
+
+  // rank the workplaces in order of patches and of workplaces within each
+  // patch, which breaks ties between workplaces at equal distances
+  std::vector<workplace_entry_t> entry;
+  int_vector_t bucket;
+  for(int row = 0; row < this->rows; ++row) {
+    for(int col = 0; col < this->cols; ++col) {
+      const place_vector_t &workplaces = this->grid[row][col].get_workplaces();
+      for(int i = 0; i < static_cast<int>(workplaces.size()); ++i) {
+        Place* workplace = workplaces[i];
+        if(workplace->is_group_quarters()) {
+          continue;
         }
+        workplace_entry_t e;
+        e.x = Geo::get_x(workplace->get_longitude());
+        e.y = Geo::get_y(workplace->get_latitude());
+        e.rank = entry.size();
+        e.place = workplace;
+        int brow = static_cast<int>((e.y - this->min_y) / this->workplace_bucket_size);
+        int bcol = static_cast<int>((e.x - this->min_x) / this->workplace_bucket_size);
+        brow = std::max(0, std::min(brow, this->workplace_bucket_rows - 1));
+        bcol = std::max(0, std::min(bcol, this->workplace_bucket_cols - 1));
+        entry.push_back(e);
+        bucket.push_back(brow * this->workplace_bucket_cols + bcol);
       }
     }
   }
-  return nearby_workplace;
+
+  // counting sort by bucket keeps the entries of each bucket in rank order
+  int n = entry.size();
+  this->workplace_bucket_start.assign(buckets + 1, 0);
+  for(int i = 0; i < n; ++i) {
+    this->workplace_bucket_start[bucket[i] + 1]++;
+  }
+  for(int b = 0; b < buckets; ++b) {
+    this->workplace_bucket_start[b + 1] += this->workplace_bucket_start[b];
+  }
+  int_vector_t next(this->workplace_bucket_start.begin(), this->workplace_bucket_start.end() - 1);
+  this->workplace_entry.resize(n);
+  for(int i = 0; i < n; ++i) {
+    this->workplace_entry[next[bucket[i]]++] = entry[i];
+  }
+  FRED_VERBOSE(0, "workplace index: %d workplaces in %d buckets of %f km\n",
+	       n, buckets, this->workplace_bucket_size);
 }
 
-std::vector<Place*> Regional_Layer::get_nearby_hospitals(int row, int col, double x, double y, int min_found) {
-  std::vector<Place*> ret_val;
-  ret_val.clear();
-  bool done = false;
-  int search_dist = 1;
-  while(!done) {
-    for(int i = row - search_dist; i <= row + search_dist; ++i) {
-      for(int j = col - search_dist; j <= col + search_dist; ++j) {
-        Regional_Patch* patch = get_patch(i, j);
-        if(patch != NULL) {
-          vector<Place*> hospitals = patch->get_hospitals();
-          if(static_cast<int>(hospitals.size()) > 0) {
-            for(std::vector<Place*>::iterator itr = hospitals.begin(); itr != hospitals.end(); ++itr) {
-              ret_val.push_back(*itr);
-            }
+// The nearest workplace whose current size is within the range of the
+// query, closer than workplace_reassignment_radius. Rings of buckets are
+// searched outward until no unsearched bucket can hold a closer workplace.
+
+Place* Regional_Layer::get_nearest_workplace(const workplace_query_t &query) {
+  double b = this->workplace_bucket_size;
+  int row = static_cast<int>((query.y - this->min_y) / b);
+  int col = static_cast<int>((query.x - this->min_x) / b);
+  row = std::max(0, std::min(row, this->workplace_bucket_rows - 1));
+  col = std::max(0, std::min(col, this->workplace_bucket_cols - 1));
+  int max_ring = std::max(std::max(row, this->workplace_bucket_rows - 1 - row),
+			  std::max(col, this->workplace_bucket_cols - 1 - col));
+
+  const workplace_entry_t* best = NULL;
+  double min_dist = this->workplace_reassignment_radius;
+  for(int ring = 0; ring <= max_ring && (ring - 1) * b <= min_dist; ++ring) {
+    int first_row = std::max(0, row - ring);
+    int last_row = std::min(this->workplace_bucket_rows - 1, row + ring);
+    for(int i = first_row; i <= last_row; ++i) {
+      // interior rows of the ring hold only its first and last column
+      int step = (i == row - ring || i == row + ring) ? 1 : std::max(1, 2 * ring);
+      for(int j = col - ring; j <= col + ring; j += step) {
+        if(j < 0 || j >= this->workplace_bucket_cols) {
+          continue;
+        }
+        int bucket = i * this->workplace_bucket_cols + j;
+        int last = this->workplace_bucket_start[bucket + 1];
+        for(int k = this->workplace_bucket_start[bucket]; k < last; ++k) {
+          const workplace_entry_t* e = &this->workplace_entry[k];
+          int size = e->place->get_size();
+          if(size < query.min_staff || query.max_staff < size) {
+            continue;
+          }
+          double dist = sqrt((query.x - e->x) * (query.x - e->x) + (query.y - e->y) * (query.y - e->y));
+          if(dist < min_dist || (best != NULL && dist == min_dist && e->rank < best->rank)) {
+            min_dist = dist;
+            best = e;
           }
         }
       }
     }
+  }
+  return best == NULL ? NULL : best->place;
+}
 
-    //Try to expand the search if we don't have enough hospitals and we CAN
-    if(static_cast<int>(ret_val.size() < min_found)) {
-      if((row + search_dist + 1 < this->rows || col + search_dist + 1 < this->cols) ||
-         (row - search_dist - 1 >= 0 || col - search_dist - 1 >= 0)) {
-        //Expand the search
-        ret_val.clear();
-        ++search_dist;
-      } else {
-        done = true;
+void Regional_Layer::get_nearest_workplaces(const std::vector<workplace_query_t> &queries, place_vector_t* result) {
+  int n = queries.size();
+  result->assign(n, NULL);
+#pragma omp parallel for schedule(dynamic,64)
+  for(int i = 0; i < n; ++i) {
+    (*result)[i] = get_nearest_workplace(queries[i]);
+  }
+}
+
+// the k hospitals nearest to (x,y) that allow overnight stays, in order
+// of distance; clinics do not count towards k. Rings of
+// patches around (x,y) are searched outward, each ring once, until no
+// unsearched patch can hold a hospital closer than the k-th one found.
+
+static bool is_closer(const std::pair<double, Place*> &h1, const std::pair<double, Place*> &h2) {
+  return h1.first < h2.first;
+}
+
+void Regional_Layer::get_nearest_hospitals(double x, double y, int k, place_vector_t* result) {
+  result->clear();
+  if(k <= 0) {
+    return;
+  }
+  int row = get_row(y);
+  int col = get_col(x);
+  row = std::max(0, std::min(row, this->rows - 1));
+  col = std::max(0, std::min(col, this->cols - 1));
+  int max_ring = std::max(std::max(row, this->rows - 1 - row), std::max(col, this->cols - 1 - col));
+
+  std::vector<std::pair<double, Place*> > found;
+  for(int ring = 0; ring <= max_ring; ++ring) {
+    if(static_cast<int>(found.size()) >= k && found[k - 1].first < (ring - 1) * this->patch_size) {
+      break;
+    }
+    for(int i = row - ring; i <= row + ring; ++i) {
+      // interior rows of the ring hold only its first and last column
+      int step = (i == row - ring || i == row + ring) ? 1 : std::max(1, 2 * ring);
+      for(int j = col - ring; j <= col + ring; j += step) {
+        Regional_Patch* patch = get_patch(i, j);
+        if(patch == NULL) {
+          continue;
+        }
+        const place_vector_t &hospitals = patch->get_hospitals();
+        for(int h = 0; h < static_cast<int>(hospitals.size()); ++h) {
+          if(hospitals[h]->is_healthcare_clinic() || hospitals[h]->is_mobile_healthcare_clinic()) {
+            continue;
+          }
+          double dx = Geo::get_x(hospitals[h]->get_longitude()) - x;
+          double dy = Geo::get_y(hospitals[h]->get_latitude()) - y;
+          found.push_back(std::make_pair(sqrt(dx * dx + dy * dy), hospitals[h]));
+        }
       }
-    } else {
-      done = true;
     }
+    // found[k - 1] must be the k-th nearest for the test above
+    if(static_cast<int>(found.size()) >= k) {
+      std::stable_sort(found.begin(), found.end(), is_closer);
+      found.resize(k);
+    }
+  }
+  std::stable_sort(found.begin(), found.end(), is_closer);
+  for(int h = 0; h < static_cast<int>(found.size()); ++h) {
+    result->push_back(found[h].second);
   }
-  return ret_val;
 }
 
 void Regional_Layer::end_membership(fred::geo lat, fred::geo lon, Person* person) {
@@ -35,6 +35,24 @@ class Regional_Patch;
 class Person;
 class Place;
 
+// a request for the nearest workplace with a staff size in
+// [min_staff,max_staff] within the reassignment radius of (x,y)
+typedef struct {
+  double x;
+  double y;
+  int min_staff;
+  int max_staff;
+} workplace_query_t;
+
+// a workplace in the bucketed index, ranked in the order of the patches
+// and of the workplaces within each patch
+typedef struct {
+  double x;
+  double y;
+  int rank;
+  Place* place;
+} workplace_entry_t;
+
 class Regional_Layer : public Abstract_Grid {
  public:
   Regional_Layer(fred::geo minlon, fred::geo minlat, fred::geo maxlon, fred::geo maxlat);
@@ -49,8 +67,10 @@ class Regional_Layer : public Abstract_Grid {
   Regional_Patch* select_random_patch();
   void add_workplace(Place* place);
   void add_hospital(Place* place);
-  Place* get_nearby_workplace(int row, int col, double x, double y, int min_staff, int max_staff, double* min_dist);
-  vector<Place*> get_nearby_hospitals(int row, int col, double x, double y, int min_found);
+  void prepare_workplace_index();
+  Place* get_nearest_workplace(const workplace_query_t &query);
+  void get_nearest_workplaces(const std::vector<workplace_query_t> &queries, place_vector_t* result);
+  void get_nearest_hospitals(double x, double y, int k, place_vector_t* result);
   void set_population_size();
   void quality_control();
   void end_membership(fred::geo lat, fred::geo lon, Person* person);
@@ -60,6 +80,14 @@ class Regional_Layer : public Abstract_Grid {
 
  protected:
   Regional_Patch** grid;            // Rectangular array of patches
+
+  // workplaces in square buckets, stored bucket by bucket
+  double workplace_reassignment_radius;
+  double workplace_bucket_size;
+  int workplace_bucket_rows;
+  int workplace_bucket_cols;
+  int_vector_t workplace_bucket_start;
+  std::vector<workplace_entry_t> workplace_entry;
 };
 
 #endif // _FRED_REGIONAL_LAYER_H
@@ -41,6 +41,7 @@ Regional_Patch::Regional_Patch() {
   this->max_popsize = 0;
   this->pop_density = 0;
   this->id = -1;
+  this->catchment_ready = false;
 }
 
 Regional_Patch::Regional_Patch(Regional_Layer* grd, int i, int j) {
@@ -72,6 +73,9 @@ void Regional_Patch::setup(Regional_Layer* grd, int i, int j) {
   }
   this->workers.clear();
   this->hospitals.clear();
+  this->catchment_hospitals.clear();
+  this->catchment_weights.clear();
+  this->catchment_ready = false;
 }
 
 void Regional_Patch::quality_control() {
@@ -145,61 +149,6 @@ void Regional_Patch::end_membership(Person* per) {
 }
 
 
-Place* Regional_Patch::get_nearby_workplace(Place* place, int staff) {
-  // printf("get_workplace_near_place entered\n"); print(); fflush(stdout);
-  double x = Geo::get_x(place->get_longitude());
-  double y = Geo::get_y(place->get_latitude());
-
-  // allow staff size variation by 25%
-  int min_staff = (int)(0.75 * staff);
-  if(min_staff < 1) {
-    min_staff = 1;
-  }
-  int max_staff = (int)(0.5 + 1.25 * staff);
-  FRED_VERBOSE(1, " staff %d %d %d \n", min_staff, staff, max_staff);
-
-  // find nearest workplace that has right number of employees
-  double min_dist = 1e99;
-  Place* nearby_workplace = this->grid->get_nearby_workplace(this->row, this->col, x, y, min_staff,
-							     max_staff, &min_dist);
-  if(nearby_workplace == NULL) {
-    FRED_VERBOSE(1, "nearby_workplace == NULL\n");
-    return NULL;
-  }
-  assert(nearby_workplace != NULL);
-  double x2 = Geo::get_x(nearby_workplace->get_longitude());
-  double y2 = Geo::get_y(nearby_workplace->get_latitude());
-  FRED_VERBOSE(1, "nearby workplace %s %f %f size %d target %d dist %f\n", nearby_workplace->get_label(),
-	       x2, y2, nearby_workplace->get_size(), staff, min_dist);
-
-  return nearby_workplace;
-}
-
-Place* Regional_Patch::get_closest_workplace(double x, double y, int min_size, int max_size, double* min_dist) {
-  // printf("get_closest_workplace entered for patch %d %d min_size = %d max_size = %d min_dist = %f  workplaces in patch = %d\n",
-  // row, col, min_size, max_size, *min_dist, (int)(this->workplaces.size())); fflush(stdout);
-  Place* closest_workplace = NULL;
-  int number_workplaces = this->workplaces.size();
-  for(int j = 0; j < number_workplaces; j++) {
-    Place* workplace = this->workplaces[j];
-    if(workplace->is_group_quarters()) {
-      continue;
-    }
-    int size = workplace->get_size();
-    if(min_size <= size && size <= max_size) {
-      double x2 = Geo::get_x(workplace->get_longitude());
-      double y2 = Geo::get_y(workplace->get_latitude());
-      double dist = sqrt((x - x2) * (x - x2) + (y - y2) * (y - y2));
-      if(dist < 20.0 && dist < *min_dist) {
-        *min_dist = dist;
-        closest_workplace = workplace;
-        // printf("closer = %s size = %d min_dist = %f\n", closest_workplace->get_label(), size, *min_dist); fflush(stdout);
-      }
-    }
-  }
-  return closest_workplace;
-}
-
 void Regional_Patch::add_workplace(Place* workplace) {
   this->workplaces.push_back(workplace);
 }
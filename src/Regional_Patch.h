@@ -69,11 +69,28 @@ public:
   void end_membership(Person* pers);
   void add_workplace(Place* place);
   void add_hospital(Place* place);
-  place_vector_t get_hospitals() {
+  const place_vector_t &get_hospitals() {
     return this->hospitals;
   }
-  Place* get_nearby_workplace(Place* place, int staff);
-  Place* get_closest_workplace(double x, double y, int min_size, int max_size, double* min_dist);
+
+  // nearby hospitals chosen by residents of this patch, and their weights
+  bool has_hospital_catchment() {
+    return this->catchment_ready;
+  }
+  void set_hospital_catchment(const place_vector_t &hosp, const double_vector_t &weight) {
+    this->catchment_hospitals = hosp;
+    this->catchment_weights = weight;
+    this->catchment_ready = true;
+  }
+  const place_vector_t &get_catchment_hospitals() {
+    return this->catchment_hospitals;
+  }
+  const double_vector_t &get_catchment_weights() {
+    return this->catchment_weights;
+  }
+  const place_vector_t &get_workplaces() {
+    return this->workplaces;
+  }
 
   int get_id() {
     return this->id;
@@ -92,6 +109,9 @@ protected:
   static int next_patch_id;
   place_vector_t workplaces;
   place_vector_t hospitals;
+  place_vector_t catchment_hospitals;
+  double_vector_t catchment_weights;
+  bool catchment_ready;
   person_vector_t students_by_age[100];
   person_vector_t workers;
 };
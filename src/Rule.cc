@@ -22,6 +22,7 @@
 #include "Condition.h"
 #include "Clause.h"
 #include "Expression.h"
+#include "Factor.h"
 #include "Global.h"
 #include "Network.h"
 #include "Person.h"
@@ -173,6 +174,9 @@ Rule::Rule(string s) {
   this->warning = false;
   this->global = false;
   this->hidden_by = NULL;
+  this->action_step.action = Rule_Action::NONE;
+  this->action_step.network = NULL;
+  this->action_step.rule = this;
 
   this->action_rule = false;
   this->wait_rule = false;
@@ -183,6 +187,18 @@ Rule::Rule(string s) {
 }
 
 
+int Rule::get_covariates() {
+  int covariates = Covariate::NONE;
+  if (this->clause != NULL) {
+    covariates |= this->clause->get_covariates();
+  }
+  if (this->expression != NULL) {
+    covariates |= this->expression->get_covariates();
+  }
+  return covariates;
+}
+
+
 double Rule::get_value(Person* person, Person* other) {
 
   if (this->action_id == Rule_Action::SET) {
@@ -414,7 +430,11 @@ bool Rule::compile() {
 
   // ACTION RULES
   if (this->is_action_rule()) {
-    return compile_action_rule();
+    if (compile_action_rule()) {
+      lower_action_rule();
+      return true;
+    }
+    return false;
   }
 
   FRED_VERBOSE(0,"COMPILE RULE UNKNOWN TYPE: |%s|\n", this->name.c_str());
@@ -948,7 +968,7 @@ bool Rule::compile_action_rule() {
   case Rule_Action::RANDOMIZE_NETWORK :
     {
       string_vector_t args = Utils::get_top_level_parse(this->expression_str,',');
-      if (args.size() == 3) {
+      if (args.size() != 3) {
 	this->err = "Needs 3 arguments:\n  " + this->name;
 	Utils::print_error(get_err_msg().c_str());
 	return false;
@@ -1483,3 +1503,21 @@ bool Rule::compile_action_rule() {
     break;
   }
 }
+
+void Rule::lower_action_rule() {
+  action_step_t* step = &(this->action_step);
+  step->action = this->action_id;
+  step->cond_id = this->cond_id;
+  step->group_type_id = this->group_type_id;
+  step->var_id = this->action_id == Rule_Action::SET_LIST ? this->list_var_id : this->var_id;
+  step->source_cond_id = this->source_cond_id;
+  step->source_state_id = this->source_state_id;
+  step->dest_state_id = this->dest_state_id;
+  step->global = this->global;
+  step->network = this->network == "" ? NULL : Network::get_network(this->network);
+  step->network_type_id = step->network ? step->network->get_type_id() : -1;
+  step->clause = this->clause;
+  step->expr = this->expression;
+  step->expr2 = this->expression2;
+  step->rule = this;
+}
@@ -32,7 +32,9 @@ using namespace std;
 class Person;
 class Clause;
 class Expression;
+class Network;
 class Preference;
+class Rule;
 
 namespace Rule_Action {
   enum e { NONE = -1,
@@ -71,6 +73,28 @@ namespace Rule_Action {
 	   RULE_ACTIONS };
 };
 
+// An action rule lowered for execution. The group, network and variable
+// that the rule names are resolved when the rule is compiled, so running
+// the rule needs no string lookups.
+typedef struct {
+  int action;
+  int cond_id;
+  int group_type_id;
+  int network_type_id;
+  int var_id;
+  int source_cond_id;
+  int source_state_id;
+  int dest_state_id;
+  bool global;
+  Network* network;
+  Clause* clause;
+  Expression* expr;
+  Expression* expr2;
+  Rule* rule;
+} action_step_t;
+
+typedef std::vector<action_step_t> action_plan_t;
+
 class Rule {
 public:
 
@@ -259,6 +283,8 @@ public:
 
   double get_value(Person* person, Person* other = NULL);
 
+  int get_covariates();
+
   void mark_as_used() {
     this->used = true;
   }
@@ -273,6 +299,11 @@ public:
 
   bool compile();
   bool compile_action_rule();
+  void lower_action_rule();
+
+  const action_step_t& get_action_step() {
+    return this->action_step;
+  }
 
   void set_hidden_by_rule(Rule* rule);
 
@@ -357,6 +388,7 @@ private:
   bool schedule_rule;
 
   Preference* preference;
+  action_step_t action_step;
 
   Rule* hidden_by;
 };
@@ -37,6 +37,11 @@
 #include "Random.h"
 #include "Utils.h"
 
+thread_local int_vector_t Transmission::source_order;
+thread_local int_vector_t Transmission::contact_order;
+thread_local person_vector_t Transmission::contacts;
+thread_local RNG* Transmission::keyed_rng = NULL;
+
 Transmission* Transmission::get_new_transmission(char* transmission_mode) {
   
   if(strcmp(transmission_mode, "respiratory")==0 || strcmp(transmission_mode, "proximity")==0) {
@@ -103,3 +108,25 @@ bool Transmission::attempt_transmission(double transmission_prob, Person* source
   }
 }
 
+void Transmission::get_random_order(int n, int_vector_t* order) {
+  // a random permutation of [0, n), reusing the buffer's storage
+  order->resize(n);
+  for(int i = 0; i < n; ++i) {
+    (*order)[i] = i;
+  }
+  FYShuffle<int>(*order);
+}
+
+void Transmission::get_random_sample(int n, int k, int_vector_t* sample) {
+  // k distinct integers from [0, n) in random order
+  sample->resize(k);
+  Random::sample_range_without_replacement(n, k, sample->data());
+}
+
+void Transmission::use_keyed_stream(int site, int id, int condition_id, int day, int hour, int value) {
+  if(Transmission::keyed_rng == NULL) {
+    Transmission::keyed_rng = new RNG;
+  }
+  Random::set_key(Transmission::keyed_rng, site, id, condition_id, 24*day + hour, value);
+  Random::use_stream(Transmission::keyed_rng);
+}
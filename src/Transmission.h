@@ -26,10 +26,13 @@
 #ifndef _FRED_TRANSMISSION_H
 #define _FRED_TRANSMISSION_H
 
+#include "Global.h"
+
 class Condition;
 class Group;
 class Person;
 class Place;
+class RNG;
 
 
 class Transmission {
@@ -48,12 +51,26 @@ public:
 
   static Transmission* get_new_transmission(char* transmission_mode);
   virtual void setup(Condition* condition) = 0;
+  virtual void prepare() {}
   virtual void transmission(int day, int hour, int condition_id, Group* group, int time_block) = 0;
   bool attempt_transmission(double transmission_prob, Person* source, Person* host,
 			    int condition_id, int condition_to_transmit, int day, int hour, Group* group);
 
 protected:
 
+  static void get_random_order(int n, int_vector_t* order);
+  static void get_random_sample(int n, int k, int_vector_t* sample);
+
+  // under common random numbers, draw from the thread's keyed stream for
+  // the given decision (see Random::set_key); the kernel restores the
+  // previous stream when it is done
+  static void use_keyed_stream(int site, int id, int condition_id, int day, int hour, int value);
+
+  // per-thread scratch buffers reused by the transmission kernels
+  static thread_local int_vector_t source_order;
+  static thread_local int_vector_t contact_order;
+  static thread_local person_vector_t contacts;
+  static thread_local RNG* keyed_rng;
 };
 
 
@@ -23,10 +23,12 @@
 // File: Travel.cc
 //
 
+#include <climits>
 #include <vector>
 using namespace std;
 
 #include "Age_Map.h"
+#include "Date.h"
 #include "Global.h"
 #include "Events.h"
 #include "Property.h"
@@ -38,7 +40,9 @@ using namespace std;
 #include "Household.h"
 
 
-Events * Travel::return_queue = new Events;
+Events * Travel::return_queue = NULL;
+std::vector<trip_t>* Travel::hub_trips = NULL;
+RNG* Travel::hub_rng = NULL;
 
 // static variables
 char trips_per_day_file[FRED_STRING_SIZE];
@@ -56,15 +60,31 @@ int** trips_per_day;
 void Travel::get_properties() {
   Property::get_property("travel_hub_file", hub_file);
   Property::get_property("trips_per_day_file", trips_per_day_file);
+
+  // cdf of trip duration in days
+  std::vector<double> duration;
+  Property::get_property_vector((char*)"travel_duration", duration);
+  max_Travel_Duration = (int) duration.size() - 1;
+  if(max_Travel_Duration < 0 || duration[max_Travel_Duration] < 1.0) {
+    Utils::fred_abort("Help! travel_duration must be a cdf ending with 1.0\n");
+  }
+  Travel_Duration_Cdf = new double [duration.size()];
+  for(int i = 0; i < duration.size(); ++i) {
+    Travel_Duration_Cdf[i] = duration[i];
+  }
 }
 
 void Travel::setup(char* directory) {
   assert(Global::Enable_Travel);
+  // the event queue is sized by the length of the simulation
+  Travel::return_queue = new Events;
   read_hub_file();
   read_trips_per_day_file();
   setup_travelers_per_hub();
   travel_age_prob = new Age_Map();
   travel_age_prob->read_properties("travel_age_prob");
+  setup_trips();
+  setup_alias_tables();
 }
 
 void Travel::read_hub_file() {
@@ -173,6 +193,124 @@ void Travel::setup_travelers_per_hub() {
   fflush(stdout);
 }
 
+void Travel::setup_trips() {
+  // the number of trips between each pair of hubs is the same every day
+  for(int i = 0; i < num_hubs; ++i) {
+    hubs[i].dest.clear();
+    hubs[i].trips.clear();
+    if(hubs[i].users.size() == 0) {
+      continue;
+    }
+    for(int j = 0; j < num_hubs; ++j) {
+      if(hubs[j].users.size() == 0) {
+	continue;
+      }
+      int count = (trips_per_day[i][j] * hubs[i].pct + 0.5) / 100;
+      if(count > 0) {
+	hubs[i].dest.push_back(j);
+	hubs[i].trips.push_back(count);
+      }
+    }
+  }
+  Travel::hub_trips = new std::vector<trip_t> [num_hubs];
+  Travel::hub_rng = new RNG [num_hubs];
+}
+
+void Travel::setup_alias_tables() {
+  // build an alias table for each hub so that a user can be drawn with
+  // probability proportional to travel_age_prob in constant time
+#pragma omp parallel for schedule(dynamic)
+  for(int i = 0; i < num_hubs; ++i) {
+    hub_t & hub = hubs[i];
+    int n = hub.users.size();
+    hub.alias_prob.assign(n, 0.0);
+    hub.alias.assign(n, 0);
+    std::vector<double> weight(n);
+    double total = 0.0;
+    for(int k = 0; k < n; ++k) {
+      weight[k] = travel_age_prob->find_value(hub.users[k]->get_real_age());
+      total += weight[k];
+    }
+    if(total <= 0.0) {
+      hub.alias_prob.clear();
+      hub.alias.clear();
+      continue;
+    }
+    std::vector<int> small;
+    std::vector<int> large;
+    for(int k = 0; k < n; ++k) {
+      weight[k] *= n / total;
+      if(weight[k] < 1.0) {
+	small.push_back(k);
+      }
+      else {
+	large.push_back(k);
+      }
+    }
+    while(small.size() > 0 && large.size() > 0) {
+      int s = small.back();
+      small.pop_back();
+      int l = large.back();
+      hub.alias_prob[s] = weight[s];
+      hub.alias[s] = l;
+      weight[l] -= 1.0 - weight[s];
+      if(weight[l] < 1.0) {
+	large.pop_back();
+	small.push_back(l);
+      }
+    }
+    for(int k = 0; k < large.size(); ++k) {
+      hub.alias_prob[large[k]] = 1.0;
+    }
+    for(int k = 0; k < small.size(); ++k) {
+      hub.alias_prob[small[k]] = 1.0;
+    }
+  }
+}
+
+void Travel::draw_trips(int i) {
+  // draw today's trips from hub i. Travelers are drawn by age from the
+  // alias table and hosts uniformly, skipping anyone already traveling.
+  hub_t & hub = hubs[i];
+  std::vector<trip_t> & trips = Travel::hub_trips[i];
+  trips.clear();
+  if(hub.alias.size() == 0) {
+    return;
+  }
+  int n = hub.users.size();
+  for(int d = 0; d < hub.dest.size(); ++d) {
+    hub_t & dest = hubs[hub.dest[d]];
+    int m = dest.users.size();
+    for(int t = 0; t < hub.trips[d]; ++t) {
+      Person* traveler = NULL;
+      for(int attempts = 0; traveler == NULL && attempts < 100; ++attempts) {
+	int k = Random::draw_random_int(0, n - 1);
+	if(hub.alias_prob[k] < Random::draw_random()) {
+	  k = hub.alias[k];
+	}
+	traveler = hub.users[k];
+	if(traveler->get_travel_status()) {
+	  traveler = NULL;
+	}
+      }
+      Person* host = NULL;
+      for(int attempts = 0; traveler != NULL && host == NULL && attempts < 100; ++attempts) {
+	host = dest.users[Random::draw_random_int(0, m - 1)];
+	if(host->get_travel_status()) {
+	  host = NULL;
+	}
+      }
+      if(traveler != NULL && host != NULL) {
+	trip_t trip;
+	trip.traveler = traveler;
+	trip.host = host;
+	trip.duration = Random::draw_from_distribution(max_Travel_Duration, Travel_Duration_Cdf);
+	trips.push_back(trip);
+      }
+    }
+  }
+}
+
 void Travel::update_travel(int day) {
 
   if(!Global::Enable_Travel) {
@@ -184,68 +322,49 @@ void Travel::update_travel(int day) {
     fflush(Global::Statusfp);
   }
 
-  // initiate new trips
+  // travel weights depend on age, so refresh them each month
+  if(day > 0 && Date::get_day_of_month() == 1) {
+    Travel::setup_alias_tables();
+  }
+
+  // seed the stream of each hub from the main stream, so that the trips
+  // do not depend on the number of threads
   for(int i = 0; i < num_hubs; ++i) {
-    if(hubs[i].users.size() == 0) {
-      continue;
-    }
-    for(int j = 0; j < num_hubs; ++j) {
-      if(hubs[j].users.size() == 0) {
+    Travel::hub_rng[i].set_seed(Random::draw_random_int(0, INT_MAX - 1));
+  }
+
+  // draw new trips for all hubs
+#pragma omp parallel for schedule(dynamic)
+  for(int i = 0; i < num_hubs; ++i) {
+    Random::use_stream(&Travel::hub_rng[i]);
+    Travel::draw_trips(i);
+    Random::use_stream(NULL);
+  }
+
+  // initiate new trips in hub order. A trip occurs only if both traveler
+  // and host are still not traveling.
+  for(int i = 0; i < num_hubs; ++i) {
+    std::vector<trip_t> & trips = Travel::hub_trips[i];
+    int successful_trips = 0;
+    for(int t = 0; t < trips.size(); ++t) {
+      Person* traveler = trips[t].traveler;
+      Person* host = trips[t].host;
+      if(traveler->get_travel_status() || host->get_travel_status()) {
 	continue;
       }
-      int successful_trips = 0;
-      int count = (trips_per_day[i][j] * hubs[i].pct + 0.5) / 100;
-      FRED_VERBOSE(1,"TRIPCOUNT day %d i %d j %d count %d\n", day, i, j, count);
-      for(int t = 0; t < count; ++t) {
-	// select a potential traveler determined by travel_age_prob property
-	Person* traveler = NULL;
-	Person* host = NULL;
-	int attempts = 0;
-	while(traveler == NULL && attempts < 100) {
-	  // select a random member of the source hub's user group
-	  int v = Random::draw_random_int(0, static_cast<int>(hubs[i].users.size()) - 1);
-	  traveler = hubs[i].users[v];
-	  double prob_travel_by_age = travel_age_prob->find_value(traveler->get_real_age());
-	  if(prob_travel_by_age < Random::draw_random()) {
-	    traveler = NULL;
-	  }
-	  attempts++;
-	}
-	if(traveler != NULL) {
-	  // select a potential travel host determined by travel_age_prob property
-	  attempts = 0;
-	  while(host == NULL && attempts < 100) {
-	    // select a random member of the destination hub's user group
-	    int v = Random::draw_random_int(0, static_cast<int>(hubs[j].users.size()) - 1);
-	    host = hubs[j].users[v];
-
-	    //	          double prob_travel_by_age = travel_age_prob->find_value(host->get_real_age());
-	    //	          if(prob_travel_by_age < Random::draw_random()) {
-	    //	            host = NULL;
-	    //	          }
-
-	    attempts++;
-	  }
-	}
-	// travel occurs only if both traveler and host are not already traveling
-	if(traveler != NULL && (!traveler->get_travel_status()) &&
-	   host != NULL && (!host->get_travel_status())) {
-	  // put traveler in travel status
-	  traveler->start_traveling(host);
-	  if(traveler->get_travel_status()) {
-	    // put traveler on list for given number of days to travel
-	    int duration = Random::draw_from_distribution(max_Travel_Duration, Travel_Duration_Cdf);
-	    int return_sim_day = day + duration;
-	    Travel::add_return_event(return_sim_day, traveler);
-	    traveler->set_return_from_travel_sim_day(return_sim_day);
-	    FRED_STATUS(1, "RETURN_FROM_TRAVEL EVENT ADDED today %d duration %d returns %d id %d age %d\n",
-			day, duration, return_sim_day, traveler->get_id(),traveler->get_age());
-	    successful_trips++;
-	  }
-	}
+      // put traveler in travel status
+      traveler->start_traveling(host);
+      if(traveler->get_travel_status()) {
+	// put traveler on list for given number of days to travel
+	int return_sim_day = day + trips[t].duration;
+	Travel::add_return_event(return_sim_day, traveler);
+	traveler->set_return_from_travel_sim_day(return_sim_day);
+	FRED_STATUS(1, "RETURN_FROM_TRAVEL EVENT ADDED today %d duration %d returns %d id %d age %d\n",
+		    day, trips[t].duration, return_sim_day, traveler->get_id(),traveler->get_age());
+	successful_trips++;
       }
-      FRED_VERBOSE(1,"DAY %d SRC = %d DEST = %d TRIPS = %d\n", day, hubs[i].id, hubs[j].id, successful_trips);
     }
+    FRED_VERBOSE(1,"DAY %d SRC = %d TRIPS = %d\n", day, hubs[i].id, successful_trips);
   }
 
   // process travelers who are returning home
@@ -36,11 +36,25 @@ typedef struct hub_record {
   pvec users;
   int pop;
   int pct;
+  // daily trip counts to each destination hub with any trips
+  std::vector<int> dest;
+  std::vector<int> trips;
+  // alias table for drawing users weighted by travel_age_prob
+  std::vector<double> alias_prob;
+  std::vector<int> alias;
 } hub_t;
 
+// a trip drawn by a source hub, started after all hubs are drawn
+typedef struct trip_record {
+  Person* traveler;
+  Person* host;
+  int duration;
+} trip_t;
+
 
 class Events;
 class Person;
+class RNG;
 class Age_Map;
 
 
@@ -52,6 +66,9 @@ public:
   static void read_trips_per_day_file();
   static void setup_travelers_per_hub();
   static void setup_travel_lists();
+  static void setup_trips();
+  static void setup_alias_tables();
+  static void draw_trips(int hub);
   static void update_travel(int day);
   static void find_returning_travelers(int day);
   static void old_find_returning_travelers(int day);
@@ -62,6 +79,8 @@ public:
 
 private:
   static Events * return_queue;
+  static std::vector<trip_t>* hub_trips;
+  static RNG* hub_rng;
 };
 
 #endif // _FRED_TRAVEL_H
@@ -24,6 +24,7 @@
 //
 
 #include "Utils.h"
+#include "Compressed_Stream.h"
 #include "Expression.h"
 #include "Global.h"
 #include "Person.h"
@@ -189,7 +190,7 @@ void Utils::fred_open_output_files(){
   Global::Recordsfp = NULL;
   if(Global::Enable_Records > 0) {
     sprintf(filename, "%s/health_records.txt", directory);
-    Global::Recordsfp = fopen(filename, "w");
+    Global::Recordsfp = Compressed_Stream::open_for_writing(filename, Global::Health_Records_Compression);
     if(Global::Recordsfp == NULL) {
       Utils::fred_abort("Can't open %s\n", filename);
     }
@@ -373,7 +374,8 @@ FILE* Utils::fred_open_file(char* filename) {
   FILE* fp;
   get_fred_file_name(filename);
   printf("fred_open_file: opening file %s for reading\n", filename);
-  fp = fopen(filename, "r");
+  // gzip files (or filename.gz) are decompressed transparently
+  fp = Compressed_Stream::open_for_reading(filename);
   return fp;
 }
 
@@ -385,6 +387,81 @@ FILE* Utils::fred_write_file(char* filename) {
   return fp;
 }
 
+bool Utils::fred_read_file(char* filename, std::vector<char>* buffer) {
+  FILE* fp = fred_open_file(filename);
+  if(fp == NULL) {
+    return false;
+  }
+  // the contents are NUL-terminated so that they can be parsed in place
+  size_t n = 0;
+  if(fseek(fp, 0, SEEK_END) == 0) {
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buffer->resize(size + 1);
+    n = fread(buffer->data(), 1, size, fp);
+  } else {
+    // compressed streams can't seek, so their size is not known
+    const size_t block = 1 << 22;
+    size_t got = 0;
+    do {
+      buffer->resize(n + block + 1);
+      got = fread(buffer->data() + n, 1, block, fp);
+      n += got;
+    } while(got == block);
+  }
+  // a damaged compressed file stops early with an error, not at its end
+  bool failed = (ferror(fp) != 0);
+  if(fclose(fp) != 0 || failed) {
+    fred_abort("fred_read_file: error reading %s\n", filename);
+  }
+  (*buffer)[n] = '\0';
+  buffer->resize(n + 1);
+  return true;
+}
+
+void Utils::fred_split_lines(const char* text, size_t start, size_t size, size_t chunk_size, std::vector<size_t>* bounds) {
+  // each chunk ends just after a newline (or at the end of the text)
+  bounds->clear();
+  bounds->push_back(start);
+  size_t pos = start;
+  while(pos < size) {
+    pos += chunk_size;
+    if(pos >= size) {
+      pos = size;
+    } else {
+      const char* nl = (const char*) memchr(text + pos, '\n', size - pos);
+      pos = (nl == NULL) ? size : (nl - text) + 1;
+    }
+    bounds->push_back(pos);
+  }
+}
+
+int Utils::fred_get_tokens(const char* line, const char* end, const char** token, int max_tokens) {
+  int n = 0;
+  const char* p = line;
+  while(n < max_tokens) {
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      p++;
+    }
+    if(p >= end || *p == '\n' || *p == '\0') {
+      break;
+    }
+    token[n++] = p;
+    while(p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '\0') {
+      p++;
+    }
+  }
+  return n;
+}
+
+int Utils::fred_get_token_length(const char* token) {
+  const char* p = token;
+  while(*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+    p++;
+  }
+  return p - token;
+}
+
 void Utils::get_fred_file_name(char* filename) {
   string str;
   str.assign(filename);
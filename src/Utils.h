@@ -130,6 +130,10 @@ namespace Utils {
   void fred_log(const char* format, ...);
   FILE *fred_open_file(char* filename);
   FILE *fred_write_file(char* filename);
+  bool fred_read_file(char* filename, std::vector<char>* buffer);
+  void fred_split_lines(const char* text, size_t start, size_t size, size_t chunk_size, std::vector<size_t>* bounds);
+  int fred_get_tokens(const char* line, const char* end, const char** token, int max_tokens);
+  int fred_get_token_length(const char* token);
   void get_fred_file_name(char* filename);
   void fred_print_resource_usage(int day);
   double get_daily_probability(double prob, int days);